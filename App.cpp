@@ -5,21 +5,11 @@ App::App(int width, int height, const std::string& title) :
 	m_windowHeight(height),
 	m_windowTitle(title)
 {
-	// Initialize GLFW
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	// Open a new window
-	m_window = glfwCreateWindow(m_windowWidth, m_windowHeight, m_windowTitle.c_str(), NULL, NULL);
-	if (m_window == NULL)
-	{
-		glfwTerminate();
-		throw std::string("Failed to create GLFW window\n");
-		return;
-	}
-	glfwMakeContextCurrent(m_window);
+	// Open the window and load OpenGL
+	m_context.CreateWindowed(m_windowWidth, m_windowHeight, m_windowTitle);
+	m_window = m_context.GetWindow();
+	// Record GPU spans along with the CPU ones
+	Tracer::Get().EnableGpu();
 	// Associate this App instance with the window
 	glfwSetWindowUserPointer(m_window, this);
 	// Set window callback functions
@@ -30,6 +20,7 @@ App::App(int width, int height, const std::string& title) :
 
 	// Initialize the renderer class
 	m_renderer.Initialize(m_windowWidth, m_windowHeight);
+	m_renderer.profiler = &m_profiler;
 	// Set the raytracing settings
 	m_renderer.UploadRaytraceSettings();
 
@@ -45,29 +36,52 @@ App::App(int width, int height, const std::string& title) :
 App::~App()
 {
 	m_renderer.Uninitialize();
+	m_profiler.Delete();
+	Tracer::Get().DisableGpu();
 
-	glfwDestroyWindow(m_window);
-	glfwTerminate();
+	m_context.Destroy();
 }
 
 int App::Start()
 {
 	while (!glfwWindowShouldClose(m_window))
 	{
+		m_profiler.NewFrame();
+		Tracer::Get().Collect();
+		TRACE_SCOPE("Frame");
+
+		// Upload what was imported during the last frames, until then the scene kept accumulating
+		ReloadChangedFiles();
+		AddImported();
+
 		// Update the camera position based on controls
-		m_scene.camera.Inputs(m_window, m_deltaTime, m_windowWidth, m_windowHeight, m_sceneChanged);
-		m_renderer.UploadCameraView(m_scene);
+		{
+			ProfileScope scope(m_profiler, "Inputs");
+			m_scene.camera.Inputs(m_window, m_deltaTime, m_windowWidth, m_windowHeight, m_sceneChanged);
+		}
+		{
+			ProfileScope scope(m_profiler, "UploadCameraView");
+			m_renderer.UploadCameraView(m_scene);
+		}
 
 		// Start rendering/raytracing
 		m_renderer.Render(m_scene, m_sceneChanged);
 		// Update the UI
-		UpdateUI();
+		{
+			ProfileScope scope(m_profiler, "UI");
+			UpdateUI();
+		}
 
 		// Take a screenshot of the current render if the user has pressed "P"
-		if (glfwGetKey(m_window, GLFW_KEY_LEFT_CONTROL) && glfwGetKey(m_window, GLFW_KEY_P))
+		bool screenShotKeyDown = glfwGetKey(m_window, GLFW_KEY_LEFT_CONTROL) && glfwGetKey(m_window, GLFW_KEY_P);
+		if (screenShotKeyDown && !m_screenShotKeyDown)
 		{
 			ScreenShot();
 		}
+		m_screenShotKeyDown = screenShotKeyDown;
+		SaveScreenShot();
+		// Save the accumulation now and then, or continue from the one of the last session
+		UpdateCheckpoints();
 
 		// Update window
 		glfwSwapBuffers(m_window);
@@ -121,6 +135,9 @@ void App::HandleWindowResize(int newWidth, int newHeight)
 	m_renderer.blur = 1.1f / (float)m_windowHeight;
 	// Set the new viewport resolution
 	m_renderer.SetViewportResolution(newWidth, newHeight);
+	// The crop rectangle does not fit the new size, it has to be dragged again
+	m_renderer.region = glm::ivec4(0);
+	m_draggingCrop = false;
 	// Scene changed
 	m_sceneChanged = true;
 }
@@ -153,17 +170,17 @@ void App::HandleFileDragDrop(int count, const char** paths)
 
 		std::string extention = path.substr(extentionPosition);
 
-		if (extention == ".obj")
+		if (extention == ".obj" || extention == ".ply" || extention == ".stl")
 		{
-			m_scene.AddMesh(path.c_str());
-			m_renderer.UploadObjects(m_scene);
-			m_sceneChanged = true;
+			ImportMesh(path);
 		}
-		else if (extention == ".jpg")
+		else if (extention == ".json")
 		{
-			m_scene.skybox.LoadFromFile(path.c_str());
-			m_renderer.UploadObjects(m_scene);
-			m_sceneChanged = true;
+			OpenScene(path);
+		}
+		else if (extention == ".glb" || extention == ".jpg" || extention == ".jpeg" || extention == ".png" || extention == ".hdr")
+		{
+			m_importer.Import(path);
 		}
 		else
 		{
@@ -172,16 +189,236 @@ void App::HandleFileDragDrop(int count, const char** paths)
 	}
 }
 
-void App::ScreenShot()
+void App::ImportMesh(const std::string& file)
+{
+	std::shared_ptr<Geometry> geometry = m_scene.FindGeometry(file.c_str());
+	if (!geometry)
+	{
+		m_importer.Import(file);
+		return;
+	}
+
+	// Only a new instance, which is cheap enough to add right away
+	m_scene.AddMesh(geometry);
+	m_renderer.UploadObjects(m_scene);
+	m_sceneChanged = true;
+
+	std::string name = ("Mesh" + std::to_string(m_scene.meshes.size()));
+	sceneObjects.push_back({ name, ObjectType::TYPE_MESH, (int)m_scene.meshes.size() - 1 });
+}
+
+void App::AddImported()
+{
+	std::vector<ImportResult> results = m_importer.TakeFinished();
+	if (results.empty()) return;
+
+	bool uploadObjects = false;
+	for (const ImportResult& result : results)
+	{
+		if (result.image)
+		{
+			// The skybox is bound every frame, so a new texture needs no other upload
+			m_scene.skybox.Upload(*result.image);
+			if (result.file != m_skyboxFile)
+			{
+				m_fileWatcher.Unwatch(m_skyboxFile);
+				m_fileWatcher.Watch(result.file);
+				m_skyboxFile = result.file;
+			}
+		}
+		else if (result.reload && !result.meshes.empty())
+		{
+			// Only the geometry is reloaded, the meshes in the scene keep their transforms and materials
+			for (int i = 0; i < (int)result.meshes.size(); i++)
+			{
+				bool reloaded = false;
+				for (int j = 0; j < i && !reloaded; j++)
+				{
+					reloaded = result.meshes[j].geometry == result.meshes[i].geometry;
+				}
+				if (!reloaded && !m_renderer.ReloadGeometry(m_scene, result.meshes[i].geometry)) uploadObjects = true;
+			}
+		}
+		else if (result.reload)
+		{
+			if (!m_renderer.ReloadGeometry(m_scene, result.geometry)) uploadObjects = true;
+		}
+		else if (AddPendingMeshes(result))
+		{
+			m_fileWatcher.Watch(result.file);
+			uploadObjects = true;
+		}
+		else if (!result.meshes.empty())
+		{
+			for (int i = 0; i < (int)result.meshes.size(); i++)
+			{
+				m_scene.AddMesh(result.meshes[i]);
+				sceneObjects.push_back({ result.meshNames[i], ObjectType::TYPE_MESH, (int)m_scene.meshes.size() - 1 });
+			}
+			m_fileWatcher.Watch(result.file);
+			uploadObjects = true;
+		}
+		else
+		{
+			m_scene.AddMesh(result.geometry);
+			m_fileWatcher.Watch(result.file);
+			uploadObjects = true;
+
+			std::string name = ("Mesh" + std::to_string(m_scene.meshes.size()));
+			sceneObjects.push_back({ name, ObjectType::TYPE_MESH, (int)m_scene.meshes.size() - 1 });
+		}
+	}
+
+	if (uploadObjects) m_renderer.UploadObjects(m_scene);
+	m_sceneChanged = true;
+}
+
+bool App::AddPendingMeshes(const ImportResult& result)
 {
-	int texWidth, texHeight;
-	std::vector<float> rawData = m_renderer.GetCurrentFrame(texWidth, texHeight);
+	if (m_pendingMeshes.empty()) return false;
+
+	std::string importKey = Scene::GetLibraryKey(result.file.c_str());
+	bool added = false;
+	for (int i = 0; i < (int)m_pendingMeshes.size(); i++)
+	{
+		SceneMeshReference& reference = m_pendingMeshes[i];
+		if (Scene::GetLibraryKey(SceneFile::GetImportFile(reference.file).c_str()) != importKey) continue;
 
-	std::vector<unsigned char> frame(texWidth * texHeight * 3, 0);
+		reference.mesh.geometry = SceneFile::FindImportedGeometry(result, reference.file);
+		if (reference.mesh.geometry)
+		{
+			m_scene.AddMesh(reference.mesh);
+			sceneObjects.push_back({ reference.name, ObjectType::TYPE_MESH, (int)m_scene.meshes.size() - 1 });
+			added = true;
+		}
 
-	for (int i = 0; i < texWidth * texHeight * 3; i++)
+		// Either added now, or the file does not have the geometry anymore
+		if (!reference.mesh.geometry) std::cout << "Missing geometry for " << reference.name << ": " << reference.file << "\n";
+		m_pendingMeshes.erase(m_pendingMeshes.begin() + i);
+		i--;
+	}
+	return added;
+}
+
+void App::OpenScene(const std::string& file)
+{
+	SceneDocument document;
+	if (!SceneFile::Load(file, document)) return;
+
+	// A checkpoint of the scene can only be found once its meshes are there
+	m_resumeChecked = false;
+
+	// Start over, including the meshes that were still waiting for their files
+	m_scene.spheres.clear();
+	m_scene.meshes.clear();
+	m_pendingMeshes.clear();
+	sceneObjects.clear();
+	selectedIndex = -1;
+
+	m_scene.camera.position = document.cameraPosition;
+	m_scene.camera.rotation = document.cameraRotation;
+	m_renderer.maxBounces = document.maxBounces;
+	m_renderer.samplesPerPixel = document.samplesPerPixel;
+	m_renderer.perspectiveSlope = document.perspectiveSlope;
+	m_renderer.focalDistance = document.focalDistance;
+	m_renderer.focalBlur = document.focalBlur;
+	m_scene.triangleStorage = document.triangleStorage;
+
+	// The lightweight objects are there right away
+	for (const SceneSphere& sphere : document.spheres)
 	{
-		frame[i] = (unsigned char)std::max(0.0f, std::min(255.0f, rawData[i] * 255.0f));
+		m_scene.spheres.push_back(sphere.sphere);
+		sceneObjects.push_back({ sphere.name, ObjectType::TYPE_SPHERE, (int)m_scene.spheres.size() - 1 });
+	}
+
+	// Meshes of geometry that is already loaded as well, the others are added when their file has been imported
+	std::vector<std::string> imports;
+	for (SceneMeshReference& reference : document.meshes)
+	{
+		reference.mesh.geometry = m_scene.FindGeometry(reference.file.c_str());
+		if (reference.mesh.geometry)
+		{
+			m_scene.AddMesh(reference.mesh);
+			sceneObjects.push_back({ reference.name, ObjectType::TYPE_MESH, (int)m_scene.meshes.size() - 1 });
+			continue;
+		}
+
+		m_pendingMeshes.push_back(reference);
+		std::string importFile = SceneFile::GetImportFile(reference.file);
+		if (std::find(imports.begin(), imports.end(), importFile) == imports.end())
+		{
+			imports.push_back(importFile);
+			m_importer.Import(importFile);
+		}
+	}
+
+	if (!document.skybox.empty() && document.skybox != m_skyboxFile)
+	{
+		m_importer.Import(document.skybox);
+	}
+
+	m_renderer.UploadRaytraceSettings();
+	m_renderer.UploadObjects(m_scene);
+	m_sceneChanged = true;
+
+	std::cout << "Opened scene: " << file << ", " << m_pendingMeshes.size() << " meshes are still loading\n";
+}
+
+void App::SaveScene(const std::string& file)
+{
+	SceneDocument document;
+	document.cameraPosition = m_scene.camera.position;
+	document.cameraRotation = m_scene.camera.rotation;
+	document.maxBounces = m_renderer.maxBounces;
+	document.samplesPerPixel = m_renderer.samplesPerPixel;
+	document.perspectiveSlope = m_renderer.perspectiveSlope;
+	document.focalDistance = m_renderer.focalDistance;
+	document.focalBlur = m_renderer.focalBlur;
+	document.triangleStorage = m_scene.triangleStorage;
+	document.skybox = m_skyboxFile;
+
+	for (const SceneObject& object : sceneObjects)
+	{
+		if (object.type == ObjectType::TYPE_SPHERE)
+		{
+			document.spheres.push_back({ object.name, m_scene.spheres[object.index] });
+		}
+		else if (object.type == ObjectType::TYPE_MESH)
+		{
+			const Mesh& mesh = m_scene.meshes[object.index];
+			document.meshes.push_back({ object.name, mesh.geometry->file, mesh });
+		}
+	}
+	// The meshes that are still loading are part of the scene too
+	document.meshes.insert(document.meshes.end(), m_pendingMeshes.begin(), m_pendingMeshes.end());
+
+	std::filesystem::path directory = std::filesystem::path(file).parent_path();
+	if (!directory.empty()) std::filesystem::create_directories(directory);
+
+	if (SceneFile::Save(file, document))
+	{
+		std::cout << "Saved scene: " << file << "\n";
+	}
+}
+
+void App::ReloadChangedFiles()
+{
+	for (const std::string& file : m_fileWatcher.TakeChanged())
+	{
+		std::cout << "Reloading changed file: " << file << "\n";
+
+		// Lets the importer skip building the bounding boxes of a mesh whose triangles stayed the same
+		std::shared_ptr<Geometry> geometry = m_scene.FindGeometry(file.c_str());
+		m_importer.Import(file, true, geometry ? geometry->GetTopologyHash() : 0);
+	}
+}
+
+void App::ScreenShot()
+{
+	if (!m_renderer.RequestFrame())
+	{
+		std::cout << "Still saving the previous frame\n";
+		return;
 	}
 
 	// Get the current time point
@@ -191,20 +428,193 @@ void App::ScreenShot()
 	std::ostringstream oss;
 	oss << std::put_time(std::gmtime(&time), "%Y%m%d_%H%M%S") << '_' << std::setw(3) << std::setfill('0') << ms.count();
 
-	std::string fileLocation = "renders/render-" + oss.str() + ".jpg";
+	m_pendingScreenShot = "renders/render-" + oss.str() + ImageWriter::GetExtention(m_screenShotFormat);
+}
+
+void App::SaveScreenShot()
+{
+	if (m_pendingScreenShot.empty()) return;
+
+	int width, height;
+	std::vector<float> frame;
+	if (!m_renderer.GetRequestedFrame(width, height, frame)) return;
 
-	// Save the frame
-	stbi_flip_vertically_on_write(1);
-	stbi_write_jpg(fileLocation.c_str(), texWidth, texHeight, 3, frame.data(), 100);
+	// Converting and encoding happens on the image writer thread
+	m_imageWriter.Write(m_pendingScreenShot, m_screenShotFormat, width, height, std::move(frame));
+	m_pendingScreenShot.clear();
+}
+
+// 64 bit FNV-1a
+static void HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= ((const unsigned char*)data)[i];
+		hash *= 1099511628211ull;
+	}
+}
 
-	std::cout << "Saved frame: " << fileLocation << "\n";
+template<typename T>
+static void HashValue(uint64_t& hash, const T& value)
+{
+	HashBytes(hash, &value, sizeof(T));
+}
 
-	Sleep(500);
+static void HashMaterial(uint64_t& hash, const Material& material)
+{
+	// Field by field, the padding is never set
+	HashValue(hash, material.color);
+	HashValue(hash, material.roughness);
+	HashValue(hash, material.emissionColor);
+	HashValue(hash, material.emissionStrength);
+	HashValue(hash, material.absorbColor);
+	HashValue(hash, material.absorbsionStrength);
+	HashValue(hash, material.emissionScatteringIndex);
+	HashValue(hash, material.refractiveIndex);
+	HashValue(hash, material.reflectiveIndex);
+}
+
+static void HashFile(uint64_t& hash, const std::string& file)
+{
+	HashBytes(hash, file.data(), file.size());
+
+	// The contents are too big to hash, but any change to them changes the size or the time
+	std::error_code error;
+	uintmax_t size = std::filesystem::file_size(file, error);
+	if (!error) HashValue(hash, size);
+	auto time = std::filesystem::last_write_time(file, error);
+	if (!error) HashValue(hash, time.time_since_epoch().count());
+}
+
+uint64_t App::GetSceneHash() const
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	HashValue(hash, m_scene.camera.position);
+	HashValue(hash, m_scene.camera.rotation);
+	HashValue(hash, m_renderer.maxBounces);
+	HashValue(hash, m_renderer.samplesPerPixel);
+	HashValue(hash, m_renderer.perspectiveSlope);
+	HashValue(hash, m_renderer.focalDistance);
+	HashValue(hash, m_renderer.focalBlur);
+	HashValue(hash, m_renderer.blur);
+	HashValue(hash, m_windowWidth);
+	HashValue(hash, m_windowHeight);
+	HashFile(hash, m_skyboxFile);
+	// Quantized triangles hit slightly differently, so their samples must not be mixed with the others
+	HashValue(hash, m_scene.triangleStorage);
+
+	// The meshes stream in, in whichever order their files finish importing, so the order of the objects must not matter
+	uint64_t objects = 0;
+	for (const Sphere& sphere : m_scene.spheres)
+	{
+		uint64_t sphereHash = 14695981039346656037ull;
+		HashValue(sphereHash, sphere.position);
+		HashValue(sphereHash, sphere.radius);
+		HashMaterial(sphereHash, sphere.material);
+		objects += sphereHash;
+	}
+	for (const Mesh& mesh : m_scene.meshes)
+	{
+		uint64_t meshHash = 14695981039346656037ull;
+		HashValue(meshHash, mesh.position);
+		HashValue(meshHash, mesh.rotation);
+		HashValue(meshHash, mesh.scale);
+		HashMaterial(meshHash, mesh.material);
+		HashBytes(meshHash, mesh.geometry->file.data(), mesh.geometry->file.size());
+		HashFile(meshHash, SceneFile::GetImportFile(mesh.geometry->file));
+		HashValue(meshHash, mesh.geometry->vertices.size());
+		HashValue(meshHash, mesh.geometry->indices.size());
+		objects += meshHash;
+	}
+	HashValue(hash, objects);
+
+	return hash;
+}
+
+void App::UpdateCheckpoints()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	AccumulationCheckpoint checkpoint;
+	if (m_renderer.GetRequestedCheckpoint(checkpoint))
+	{
+		// Saving happens on the checkpoint writer thread
+		checkpoint.sceneHash = m_checkpointHash;
+		m_checkpointWriter.Write(std::move(checkpoint));
+	}
+
+	// Only look for a checkpoint once every mesh of the scene is there
+	if (!m_resumeChecked && !m_importer.IsBusy() && m_pendingMeshes.empty())
+	{
+		m_resumeChecked = true;
+
+		uint64_t hash = GetSceneHash();
+		std::string file = AccumulationCheckpoint::GetFile(hash);
+		AccumulationCheckpoint saved;
+		if (saved.LoadFromFile(file) && saved.sceneHash == hash)
+		{
+			unsigned int frames = saved.frame;
+			if (m_renderer.ResumeAccumulation(std::move(saved)))
+			{
+				std::cout << "Resuming from checkpoint: " << file << " at " << frames << " frames\n";
+
+				// It was saved in render mode, so that is how it continues
+				m_renderer.renderMode = true;
+				glfwSwapInterval(0);
+				m_lastCheckpoint = now;
+			}
+		}
+	}
+
+	// A crop region leaves a mix of old and new pixels in the accumulation, nothing to continue from
+	if (!m_renderer.renderMode || m_checkpointInterval <= 0.0f || m_renderer.GetAccumulatedFrames() == 0 || m_cropping)
+	{
+		m_lastCheckpoint = now;
+		return;
+	}
+
+	if (std::chrono::duration<float>(now - m_lastCheckpoint).count() >= m_checkpointInterval && m_renderer.RequestCheckpoint())
+	{
+		m_checkpointHash = GetSceneHash();
+		m_lastCheckpoint = now;
+	}
+}
+
+void App::SaveTrace()
+{
+	auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	std::ostringstream oss;
+	oss << std::put_time(std::gmtime(&time), "%Y%m%d_%H%M%S");
+
+	std::filesystem::create_directories("traces");
+	std::string file = "traces/trace-" + oss.str() + ".json";
+
+	if (Tracer::Get().WriteJSON(file))
+	{
+		std::cout << "Saved trace: " << file << "\n";
+	}
+	else
+	{
+		std::cout << "Failed to save trace: " << file << "\n";
+	}
 }
 
 void App::LoadScene()
 {
-	m_scene.skybox.LoadFromFile("skyboxes/Powder blue sky.jpg");
+	// The default scene, when there is one
+	if (std::filesystem::exists(m_sceneFile))
+	{
+		m_skyboxFile = "skyboxes/Powder blue sky.jpg";
+		m_scene.skybox.LoadFromFile(m_skyboxFile.c_str());
+		m_fileWatcher.Watch(m_skyboxFile);
+		OpenScene(m_sceneFile);
+		return;
+	}
+
+	m_skyboxFile = "skyboxes/Powder blue sky.jpg";
+	m_scene.skybox.LoadFromFile(m_skyboxFile.c_str());
+	m_fileWatcher.Watch(m_skyboxFile);
 	m_scene.camera.position = { 0.0f,5.0f,-10.0f };
 	m_scene.camera.rotation = { 0.6f,0.0f,0.0f };
 
@@ -244,13 +654,60 @@ void App::UpdateUI()
 	UpdateSettingsUI();
 	UpdateAddObjectUI();
 	UpdateObjectEditor();
+	if (m_isProfilerWindowOpen) m_profiler.DrawUI();
+	UpdateImportUI();
+	UpdateCrop();
 
 	// Rendering
 	ImGui::Render();
 	int display_w, display_h;
 	glfwGetFramebufferSize(m_window, &display_w, &display_h);
 	glViewport(0, 0, display_w, display_h);
+	m_profiler.BeginGPU("ImGui");
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	m_profiler.EndGPU("ImGui");
+}
+
+void App::UpdateCrop()
+{
+	if (!m_cropping) return;
+
+	if (!m_draggingCrop && ImGui::IsMouseClicked(ImGuiMouseButton_Left) && !m_io->WantCaptureMouse)
+	{
+		m_draggingCrop = true;
+		m_cropStart = m_io->MousePos;
+	}
+
+	if (m_draggingCrop)
+	{
+		m_cropEnd = m_io->MousePos;
+
+		if (!ImGui::IsMouseDown(ImGuiMouseButton_Left))
+		{
+			m_draggingCrop = false;
+
+			// Dear ImGui counts from the top left in window coordinates, the renderer from the bottom left in pixels
+			ImVec2 scale = m_io->DisplayFramebufferScale;
+			int left = std::clamp((int)(std::min(m_cropStart.x, m_cropEnd.x) * scale.x), 0, (int)m_windowWidth);
+			int right = std::clamp((int)std::ceil(std::max(m_cropStart.x, m_cropEnd.x) * scale.x), 0, (int)m_windowWidth);
+			int top = std::clamp((int)(std::min(m_cropStart.y, m_cropEnd.y) * scale.y), 0, (int)m_windowHeight);
+			int bottom = std::clamp((int)std::ceil(std::max(m_cropStart.y, m_cropEnd.y) * scale.y), 0, (int)m_windowHeight);
+
+			// A click without dragging goes back to the whole frame
+			if (right - left < 4 || bottom - top < 4) m_renderer.region = glm::ivec4(0);
+			else m_renderer.region = glm::ivec4(left, (int)m_windowHeight - bottom, right - left, bottom - top);
+
+			// The pixels of the new rectangle start over, whatever was frozen in them belongs to the old one
+			m_sceneChanged = true;
+		}
+	}
+
+	if (m_draggingCrop || m_renderer.region.z > 0)
+	{
+		ImVec2 min(std::min(m_cropStart.x, m_cropEnd.x), std::min(m_cropStart.y, m_cropEnd.y));
+		ImVec2 max(std::max(m_cropStart.x, m_cropEnd.x), std::max(m_cropStart.y, m_cropEnd.y));
+		ImGui::GetForegroundDrawList()->AddRect(min, max, IM_COL32(255, 200, 0, 255));
+	}
 }
 
 void App::UpdateObjectsHierarchyUI()
@@ -262,7 +719,18 @@ void App::UpdateObjectsHierarchyUI()
 		m_isAddObjectWindowOpen = true;
 	}
 
-	for (int i = 0; i < sceneObjects.size(); i++)
+	ImGui::InputText("scene file", m_sceneFile, sizeof(m_sceneFile));
+	if (ImGui::Button("Open"))
+	{
+		OpenScene(m_sceneFile);
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Save"))
+	{
+		SaveScene(m_sceneFile);
+	}
+
+	for (int i = 0; i < (int)sceneObjects.size(); i++)
 	{
 		SceneObject& object = sceneObjects[i];
 
@@ -293,6 +761,81 @@ void App::UpdateSettingsUI()
 		settingsChanged = true;
 	}
 
+	ImGui::InputFloat("checkpoint interval (s)", &m_checkpointInterval);
+	if (ImGui::IsItemHovered())
+	{
+		ImGui::SetTooltip("How often the render mode accumulation is saved, 0 turns it off");
+	}
+
+	if (ImGui::Checkbox("crop region", &m_cropping) && !m_cropping)
+	{
+		// The pixels outside of the rectangle were frozen, so everything starts over
+		m_renderer.region = glm::ivec4(0);
+		m_draggingCrop = false;
+		m_sceneChanged = true;
+	}
+	if (ImGui::IsItemHovered())
+	{
+		ImGui::SetTooltip("Only traces the rectangle dragged over the viewport with the left mouse button, the rest of the frame stays as it is");
+	}
+
+	ImGui::Checkbox("hybrid CPU rendering", &m_renderer.hybridRendering);
+	if (ImGui::IsItemHovered())
+	{
+		ImGui::SetTooltip("Traces extra samples on the CPU in render mode and adds them to the accumulation");
+	}
+	if (m_renderer.hybridRendering && m_renderer.renderMode)
+	{
+		const CpuTracer& cpuTracer = m_renderer.GetCpuTracer();
+		double samplesPerSecond = std::max(cpuTracer.GetCpuSamplesPerSecond() + cpuTracer.GetGpuSamplesPerSecond(), 1.0);
+		ImGui::Text("%d/%d CPU threads, %.1f%% of the samples", cpuTracer.GetActiveThreadCount(), cpuTracer.GetThreadCount(), cpuTracer.GetCpuSamplesPerSecond() / samplesPerSecond * 100.0);
+	}
+
+	ImGui::Checkbox("profiler", &m_isProfilerWindowOpen);
+	if (ImGui::Button("save trace"))
+	{
+		SaveTrace();
+	}
+
+	if (ImGui::Checkbox("specialize shaders", &m_renderer.specializeShaders)) m_sceneChanged = true;
+	if (ImGui::IsItemHovered())
+	{
+		ImGui::SetTooltip("%d variants compiled, active:\n%s", m_renderer.GetRaytraceVariantCount(), m_renderer.GetRaytraceVariant().c_str());
+	}
+	if (m_renderer.IsCompilingShaders())
+	{
+		ImGui::SameLine();
+		ImGui::Text("compiling...");
+	}
+
+	bool instrumentation = m_renderer.GetInstrumentation();
+	if (ImGui::Checkbox("instrumentation", &instrumentation))
+	{
+		m_renderer.SetInstrumentation(instrumentation, m_scene);
+		m_sceneChanged = true;
+	}
+	if (instrumentation)
+	{
+		if (ImGui::Combo("debug view", (int*)&m_renderer.debugView, "shaded\0box tests\0triangle tests\0stack depth\0bounces\0")) settingsChanged = true;
+		if (ImGui::InputFloat("heatmap scale", &m_renderer.heatmapScale)) settingsChanged = true;
+
+		const TraversalStatistics& statistics = m_renderer.GetStatistics();
+		float rays = (float)std::max<uint64_t>(statistics.rays, 1);
+		ImGui::Text("%.2f Mrays/s", statistics.mraysPerSecond);
+		ImGui::Text("%.1f box tests per ray", statistics.boxTests / rays);
+		ImGui::Text("%.1f triangle tests per ray", statistics.triangleTests / rays);
+		ImGui::Text("%.2f bounces per path", statistics.bounces / (float)std::max<uint64_t>(statistics.paths, 1));
+		ImGui::Text("%u max stack depth", statistics.maxStackDepth);
+	}
+
+	ImGui::Combo("screenshot format", (int*)&m_screenShotFormat, "jpg\0png 16 bit\0pfm\0exr\0");
+
+	if (ImGui::Combo("triangle storage", (int*)&m_scene.triangleStorage, "indexed\0quantized\0precomputed\0"))
+	{
+		m_scene.UpdateSSBO(m_renderer.GetRenderShaderID());
+		m_sceneChanged = true;
+	}
+
 	if (settingsChanged)
 	{
 		m_renderer.UploadRaytraceSettings();
@@ -327,14 +870,38 @@ void App::UpdateAddObjectUI()
 	{
 		std::string filename = entry.path().filename().string();
 
+		// Only the files that can be imported
+		std::string extention = entry.path().extension().string();
+		if (extention != ".obj" && extention != ".ply" && extention != ".stl" && extention != ".glb") continue;
+
 		if (ImGui::Button(filename.c_str(), { 220, 20 }))
 		{
-			m_scene.AddMesh((location + "/" + filename).c_str());
-			m_scene.UpdateSSBO(m_renderer.GetRenderShaderID());
+			ImportMesh(location + "/" + filename);
 			m_isAddObjectWindowOpen = false;
+		}
+	}
 
-			std::string name = ("Mesh" + std::to_string(m_scene.meshes.size()));
-			sceneObjects.push_back({ name, ObjectType::TYPE_MESH, (int)m_scene.meshes.size() - 1 });
+	ImGui::End();
+}
+
+void App::UpdateImportUI()
+{
+	std::vector<ImportProgress> imports = m_importer.GetProgress();
+	if (imports.empty()) return;
+
+	ImGui::Begin("Imports");
+
+	for (const ImportProgress& import : imports)
+	{
+		std::string name = std::filesystem::path(import.file).filename().string();
+		ImGui::Text("%s (%.1fs)", name.c_str(), import.seconds);
+
+		switch (import.stage)
+		{
+		case IMPORT_QUEUED: ImGui::ProgressBar(0.0f, { -1.0f, 0.0f }, "queued"); break;
+		case IMPORT_READING: ImGui::ProgressBar(import.readProgress, { -1.0f, 0.0f }, "reading"); break;
+		case IMPORT_BUILDING: ImGui::ProgressBar(1.0f, { -1.0f, 0.0f }, "building bounding boxes"); break;
+		default: ImGui::ProgressBar(1.0f, { -1.0f, 0.0f }, "uploading"); break;
 		}
 	}
 
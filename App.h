@@ -6,12 +6,20 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
-#include <Windows.h>
 #include <chrono>
 #include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include "Checkpoint.h"
+#include "Context.h"
+#include "FileWatcher.h"
 #include "GUI.h"
+#include "ImageWriter.h"
+#include "Importer.h"
+#include "Profiler.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "SceneFile.h"
 
 class App
 {
@@ -25,6 +33,7 @@ private:
 	/* GLFW */
 	unsigned int m_windowWidth, m_windowHeight;
 	std::string m_windowTitle;
+	Context m_context;
 	GLFWwindow* m_window;
 
 	double m_prevTime = 0.0, m_crntTime, m_deltaTime = 0.0, m_fTheta = 0.0;
@@ -41,8 +50,32 @@ private:
 
 	/* RENDERER */
 	Renderer m_renderer;
-	// Save the current render
+	// Times the render passes and the CPU side of every frame
+	Profiler m_profiler;
+	// Saves the screenshots in the background
+	ImageWriter m_imageWriter;
+	ImageFormat m_screenShotFormat = FORMAT_JPG;
+	// The file the requested frame will be saved to, empty if no screenshot is being taken
+	std::string m_pendingScreenShot;
+	bool m_screenShotKeyDown = false;
+	// Request a copy of the current render
 	void ScreenShot();
+	// Hand the requested frame to the image writer once it has been copied
+	void SaveScreenShot();
+	// Write the recorded trace as a chrome://tracing / Perfetto JSON file
+	void SaveTrace();
+	// Saves the accumulation of render mode in the background every interval, so a long render can continue after a restart
+	CheckpointWriter m_checkpointWriter;
+	float m_checkpointInterval = 300.0f;
+	std::chrono::steady_clock::time_point m_lastCheckpoint = std::chrono::steady_clock::now();
+	// The scene the checkpoint that is being copied belongs to
+	uint64_t m_checkpointHash = 0;
+	// Set once the checkpoint of the loaded scene has been looked for
+	bool m_resumeChecked = false;
+	// Identifies everything that changes the render, independent of the order the objects were added in
+	uint64_t GetSceneHash() const;
+	// Saves a checkpoint when it is time, and continues from the checkpoint of the scene once it has been loaded
+	void UpdateCheckpoints();
 
 
 	/* SCENE */
@@ -51,6 +84,26 @@ private:
 	bool m_sceneChanged = false;
 	// Load the spheres, triangles and calculate the bounding boxes
 	void LoadScene();
+	// Parses the meshes and builds their bounding boxes, or decodes the skyboxes, in the background
+	Importer m_importer;
+	// Reloads the files of the meshes and skybox when they change on disk
+	FileWatcher m_fileWatcher;
+	std::string m_skyboxFile;
+	// Adds a mesh right away when its file is already loaded, otherwise it is imported in the background
+	void ImportMesh(const std::string& file);
+	// Adds the meshes and skyboxes that finished importing and uploads them, only called between frames
+	void AddImported();
+	// Imports the watched files that changed again
+	void ReloadChangedFiles();
+	// The scene file the UI opens and saves
+	char m_sceneFile[260] = "scenes/default.json";
+	// Meshes of an opened scene that wait for their file to be imported
+	std::vector<SceneMeshReference> m_pendingMeshes;
+	// Adds the waiting meshes that use the imported file, returns false when none of them do
+	bool AddPendingMeshes(const ImportResult& result);
+	// Replaces the scene with the one in the file, the meshes stream in as their files are imported
+	void OpenScene(const std::string& file);
+	void SaveScene(const std::string& file);
 
 
 	/* DEAR IMGUI */
@@ -58,6 +111,7 @@ private:
 
 	// Window states
 	bool m_isAddObjectWindowOpen = false;
+	bool m_isProfilerWindowOpen = false;
 	std::vector<SceneObject> sceneObjects;
 	int selectedIndex = -1;
 
@@ -69,6 +123,15 @@ private:
 	void UpdateSettingsUI();
 	void UpdateAddObjectUI();
 	void UpdateObjectEditor();
+	void UpdateImportUI();
+
+	// While cropping only the rectangle dragged over the viewport with the left mouse button is traced, the rest of the frame stays frozen
+	bool m_cropping = false;
+	bool m_draggingCrop = false;
+	// The corners of the rectangle in the coordinates of Dear ImGui
+	ImVec2 m_cropStart, m_cropEnd;
+	// Drags and draws the rectangle, and hands it to the renderer once it is let go
+	void UpdateCrop();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,590 @@
+#include "Benchmark.h"
+#include "Json.h"
+
+// The materials every scene is built from
+static Material Diffuse(glm::vec3 color) { return Material(color, 1.0f, 0.0f, 1.0f, 0.0f, 1.5f, 1.0f); }
+static Material Glass(glm::vec3 color, float roughness) { return Material(color, roughness, 0.0f, 1.0f, 0.5f, 1.5f, 0.0f); }
+static Material Light(glm::vec3 color, float strength) { return Material(color, 1.0f, strength, 1.0f, 0.0f, 1.5f, 1.0f); }
+
+Benchmark::Benchmark(int width, int height, bool headless) :
+	m_width(width),
+	m_height(height)
+{
+	if (headless)
+	{
+		m_context.CreateHeadless();
+	}
+	else
+	{
+		m_context.CreateWindowed(m_width, m_height, "Ray Tracing benchmark");
+	}
+
+	m_renderer.Initialize(m_width, m_height, headless);
+	// Always accumulate, so a window and a headless context do the same work
+	m_renderer.renderMode = true;
+
+	m_scene.Initialize();
+	m_scene.skybox.LoadFromFile("skyboxes/Powder blue sky.jpg");
+	m_scene.skybox.UploadToShader("skybox", m_renderer.GetRenderShaderID(), 0);
+
+	m_dataDirectory = std::filesystem::temp_directory_path() / "raytracing-benchmark";
+	std::filesystem::create_directories(m_dataDirectory);
+}
+
+Benchmark::~Benchmark()
+{
+	m_renderer.Uninitialize();
+	m_scene.Uninitialize();
+
+	m_context.Destroy();
+}
+
+const std::vector<Benchmark::SceneSetup>& Benchmark::GetScenes()
+{
+	static const std::vector<SceneSetup> scenes = {
+		{ "cornell_box", &Benchmark::SetupCornellBox },
+		{ "many_spheres", &Benchmark::SetupManySpheres },
+		{ "large_mesh", &Benchmark::SetupLargeMesh },
+		{ "glass", &Benchmark::SetupGlass } };
+	return scenes;
+}
+
+void Benchmark::WriteJSON(const std::string& json, const std::string& file) const
+{
+	std::cout << json;
+
+	if (file.empty()) return;
+
+	std::ofstream out(file, std::ios::binary);
+	out << json;
+	if (!out.good())
+	{
+		throw std::string("Failed to write " + file + "\n");
+	}
+}
+
+int Benchmark::Run(int frames, const std::string& file)
+{
+	std::vector<BenchmarkResult> results;
+	for (const SceneSetup& scene : GetScenes())
+	{
+		if (!sceneFilter.empty() && sceneFilter != scene.name) continue;
+		results.push_back(RunScene(scene.name, scene.setup, frames));
+	}
+
+	std::string renderer = (const char*)glGetString(GL_RENDERER);
+	WriteJSON(ToJSON(results, renderer, m_width, m_height, frames), file);
+
+	return 0;
+}
+
+int Benchmark::RunConvergence(double seconds, double interval, int referenceFrames, const std::string& referenceDirectory, const std::string& file)
+{
+	std::filesystem::create_directories(referenceDirectory);
+
+	std::ostringstream json;
+	json << std::fixed << std::setprecision(6);
+	json << "{\n";
+	json << "\t\"renderer\": " << JsonValue::Quote((const char*)glGetString(GL_RENDERER)) << ",\n";
+	json << "\t\"width\": " << m_width << ",\n";
+	json << "\t\"height\": " << m_height << ",\n";
+	json << "\t\"seconds\": " << seconds << ",\n";
+	json << "\t\"interval\": " << interval << ",\n";
+	json << "\t\"scenes\": [";
+
+	bool firstScene = true;
+	for (const SceneSetup& scene : GetScenes())
+	{
+		if (!sceneFilter.empty() && sceneFilter != scene.name) continue;
+		std::cout << "Converging " << scene.name << "\n";
+
+		ClearScene();
+		(this->*scene.setup)();
+		m_renderer.UploadObjects(m_scene);
+		m_renderer.UploadCameraView(m_scene);
+
+		// The settings of the scene itself are the first configuration, the others are compared against it
+		std::vector<ConvergenceConfiguration> configurations(3);
+		configurations[0] = { "default", m_renderer.maxBounces, m_renderer.samplesPerPixel, {}, {} };
+		configurations[1] = { "half_bounces", std::max(m_renderer.maxBounces / 2, 1), m_renderer.samplesPerPixel, {}, {} };
+		configurations[2] = { "4_samples_per_pixel", m_renderer.maxBounces, m_renderer.samplesPerPixel * 4, {}, {} };
+
+		// Load the reference, or render it with the default configuration if there is none at this resolution yet
+		std::filesystem::path referenceFile = std::filesystem::path(referenceDirectory) / (std::string(scene.name) + ".pfm");
+		int referenceWidth = 0, referenceHeight = 0;
+		std::vector<float> reference;
+		if (!LoadPFM(referenceFile, referenceWidth, referenceHeight, reference) || referenceWidth != m_width || referenceHeight != m_height)
+		{
+			std::cout << "Rendering the reference with " << referenceFrames << " frames\n";
+
+			// Samples the progressive renders never use, otherwise they would match the reference better than they should
+			m_renderer.sampleStream = 1;
+			m_renderer.UploadRaytraceSettings();
+			bool sceneChanged = true;
+			for (int i = 0; i < referenceFrames; i++)
+			{
+				m_renderer.Render(m_scene, sceneChanged);
+				// Do not queue up more work than the driver can handle
+				if (i % 16 == 15) glFinish();
+			}
+			reference = m_renderer.GetCurrentFrame(referenceWidth, referenceHeight);
+			m_renderer.sampleStream = 0;
+			m_imageWriter.Write(referenceFile.string(), FORMAT_PFM, referenceWidth, referenceHeight, std::vector<float>(reference));
+		}
+
+		for (ConvergenceConfiguration& configuration : configurations)
+		{
+			Converge(configuration, reference, seconds, interval);
+		}
+		UpdateEqualQualityTimes(configurations);
+
+		json << (firstScene ? "\n" : ",\n");
+		firstScene = false;
+		json << "\t\t{\n";
+		json << "\t\t\t\"name\": \"" << scene.name << "\",\n";
+		json << "\t\t\t\"configurations\": [\n";
+		for (int c = 0; c < (int)configurations.size(); c++)
+		{
+			const ConvergenceConfiguration& configuration = configurations[c];
+			json << "\t\t\t\t{\n";
+			json << "\t\t\t\t\t\"name\": \"" << configuration.name << "\",\n";
+			json << "\t\t\t\t\t\"max_bounces\": " << configuration.maxBounces << ",\n";
+			json << "\t\t\t\t\t\"samples_per_pixel\": " << configuration.samplesPerPixel << ",\n";
+			json << "\t\t\t\t\t\"curve\": [";
+			for (int i = 0; i < (int)configuration.curve.size(); i++)
+			{
+				const ConvergencePoint& point = configuration.curve[i];
+				json << (i == 0 ? "" : ", ") << "{ \"seconds\": " << point.seconds << ", \"frames\": " << point.frames << ", \"rmse\": " << point.rmse << ", \"relmse\": " << point.relMSE << " }";
+			}
+			json << "],\n";
+			json << "\t\t\t\t\t\"equal_quality_seconds\": [";
+			for (int i = 0; i < (int)configuration.equalQualitySeconds.size(); i++)
+			{
+				double time = configuration.equalQualitySeconds[i];
+				json << (i == 0 ? "" : ", ");
+				if (time < 0.0) json << "null";
+				else json << time;
+			}
+			json << "]\n";
+			json << "\t\t\t\t}" << (c + 1 < (int)configurations.size() ? "," : "") << "\n";
+		}
+		json << "\t\t\t]\n";
+		json << "\t\t}";
+	}
+	json << "\n\t]\n";
+	json << "}\n";
+
+	WriteJSON(json.str(), file);
+	return 0;
+}
+
+void Benchmark::Converge(ConvergenceConfiguration& configuration, const std::vector<float>& reference, double seconds, double interval)
+{
+	m_renderer.maxBounces = configuration.maxBounces;
+	m_renderer.samplesPerPixel = configuration.samplesPerPixel;
+	m_renderer.UploadRaytraceSettings();
+
+	bool sceneChanged = true;
+	int frames = 0;
+	// Only the time spent rendering counts, not the time spent measuring the error
+	double elapsed = 0.0;
+	double nextCheckpoint = interval;
+
+	glFinish();
+	while (elapsed < seconds)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		m_renderer.Render(m_scene, sceneChanged);
+		glFinish();
+		elapsed += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		frames++;
+
+		if (elapsed < nextCheckpoint && elapsed < seconds) continue;
+		while (nextCheckpoint <= elapsed) nextCheckpoint += interval;
+
+		int width, height;
+		std::vector<float> image = m_renderer.GetCurrentFrame(width, height);
+
+		ConvergencePoint point;
+		point.seconds = elapsed;
+		point.frames = frames;
+		for (int i = 0; i < (int)image.size(); i++)
+		{
+			double error = (double)image[i] - reference[i];
+			point.rmse += error * error;
+			point.relMSE += error * error / ((double)reference[i] * reference[i] + 0.01);
+		}
+		point.rmse = std::sqrt(point.rmse / image.size());
+		point.relMSE /= image.size();
+
+		configuration.curve.push_back(point);
+	}
+}
+
+void Benchmark::UpdateEqualQualityTimes(std::vector<ConvergenceConfiguration>& configurations)
+{
+	const std::vector<ConvergencePoint>& baseline = configurations[0].curve;
+
+	for (ConvergenceConfiguration& configuration : configurations)
+	{
+		const std::vector<ConvergencePoint>& curve = configuration.curve;
+		configuration.equalQualitySeconds.clear();
+
+		for (const ConvergencePoint& target : baseline)
+		{
+			// Find the first point that is at least as good, and interpolate between it and the point before it
+			double time = -1.0;
+			for (int i = 0; i < (int)curve.size(); i++)
+			{
+				if (curve[i].relMSE > target.relMSE) continue;
+
+				time = curve[i].seconds;
+				if (i > 0)
+				{
+					const ConvergencePoint& previous = curve[i - 1];
+					double t = (previous.relMSE - target.relMSE) / (previous.relMSE - curve[i].relMSE);
+					time = previous.seconds + (curve[i].seconds - previous.seconds) * t;
+				}
+				break;
+			}
+
+			configuration.equalQualitySeconds.push_back(time);
+		}
+	}
+}
+
+bool Benchmark::LoadPFM(const std::filesystem::path& file, int& width, int& height, std::vector<float>& data)
+{
+	std::ifstream in(file, std::ios::binary);
+	if (!in.is_open()) return false;
+
+	// Only color images written by ImageWriter, little endian and bottom row first
+	std::string type;
+	float scale;
+	in >> type >> width >> height >> scale;
+	in.get();
+	if (type != "PF" || scale >= 0.0f) return false;
+
+	data.resize(width * height * 3);
+	in.read((char*)data.data(), data.size() * sizeof(float));
+	return in.good();
+}
+
+BenchmarkResult Benchmark::RunScene(const char* name, void (Benchmark::*setup)(), int frames)
+{
+	std::cout << "Running " << name << "\n";
+
+	BenchmarkResult result;
+	result.name = name;
+
+	ClearScene();
+	(this->*setup)();
+
+	result.nSpheres = (int)m_scene.spheres.size();
+	result.nMeshes = (int)m_scene.meshes.size();
+	for (const Mesh& mesh : m_scene.meshes)
+	{
+		result.nTriangles += (int)mesh.geometry->indices.size();
+	}
+	result.samplesPerPixel = m_renderer.samplesPerPixel;
+	result.maxBounces = m_renderer.maxBounces;
+	result.objParseMs = m_objParseMs;
+	result.bvhBuildMs = m_bvhBuildMs;
+
+	// Upload the scene and wait for the GPU to have it
+	glFinish();
+	auto start = std::chrono::high_resolution_clock::now();
+	m_renderer.UploadObjects(m_scene);
+	glFinish();
+	result.ssboUploadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	m_renderer.UploadRaytraceSettings();
+	m_renderer.UploadCameraView(m_scene);
+
+	// A couple of frames first, some drivers only finish compiling the shader on its first use
+	bool sceneChanged = true;
+	for (int i = 0; i < 2; i++)
+	{
+		m_renderer.Render(m_scene, sceneChanged);
+	}
+
+	// Start over so every run uses the same seeds. Every frame is waited on, timer queries are not reliable on software implementations
+	sceneChanged = true;
+	double totalMs = 0.0;
+	result.traceMsMin = std::numeric_limits<double>::infinity();
+	for (int i = 0; i < frames; i++)
+	{
+		auto frameStart = std::chrono::high_resolution_clock::now();
+		m_renderer.Render(m_scene, sceneChanged);
+		glFinish();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count();
+
+		totalMs += ms;
+		result.traceMsMin = std::min(result.traceMsMin, ms);
+	}
+
+	result.traceMsPerFrame = totalMs / frames;
+	double raysPerFrame = (double)m_width * m_height * m_renderer.samplesPerPixel;
+	result.mraysPerSecond = raysPerFrame / (result.traceMsPerFrame / 1000.0) / 1000000.0;
+
+	return result;
+}
+
+void Benchmark::ClearScene()
+{
+	m_scene.spheres.clear();
+	m_scene.meshes.clear();
+	m_objParseMs = 0.0;
+	m_bvhBuildMs = 0.0;
+
+	m_renderer.maxBounces = 8;
+	m_renderer.samplesPerPixel = 1;
+	m_renderer.perspectiveSlope = 1.2f;
+	m_renderer.focalDistance = 1.0f;
+	m_renderer.focalBlur = 0.0f;
+	m_renderer.blur = 1.1f / (float)m_height;
+}
+
+Mesh& Benchmark::AddMesh(const std::filesystem::path& file)
+{
+	// Every mesh gets its own geometry, so every mesh counts towards the parse and build times
+	std::shared_ptr<Geometry> geometry = std::make_shared<Geometry>();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	geometry->LoadFromObjectFile(file.string().c_str());
+	auto parsed = std::chrono::high_resolution_clock::now();
+	geometry->UpdateBoundingBoxes();
+	auto built = std::chrono::high_resolution_clock::now();
+
+	m_objParseMs += std::chrono::duration<double, std::milli>(parsed - start).count();
+	m_bvhBuildMs += std::chrono::duration<double, std::milli>(built - parsed).count();
+
+	m_scene.meshes.push_back(Mesh());
+	m_scene.meshes.back().geometry = geometry;
+	return m_scene.meshes.back();
+}
+
+void Benchmark::WriteObjectFile(const std::filesystem::path& file, const std::vector<glm::vec3>& vertices, const std::vector<glm::uvec3>& indices)
+{
+	std::ofstream out(file, std::ios::binary);
+
+	for (const glm::vec3& vertex : vertices)
+	{
+		out << "v " << vertex.x << " " << vertex.y << " " << vertex.z << "\n";
+	}
+	for (const glm::uvec3& triangle : indices)
+	{
+		out << "f " << triangle.x + 1 << " " << triangle.y + 1 << " " << triangle.z + 1 << "\n";
+	}
+}
+
+std::filesystem::path Benchmark::GetCubeFile()
+{
+	std::filesystem::path file = m_dataDirectory / "cube.obj";
+	if (std::filesystem::exists(file)) return file;
+
+	// A unit cube around the origin
+	std::vector<glm::vec3> vertices;
+	for (int i = 0; i < 8; i++)
+	{
+		vertices.push_back(glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f));
+	}
+	std::vector<glm::uvec3> indices = {
+		{ 0, 2, 3 }, { 0, 3, 1 }, { 4, 5, 7 }, { 4, 7, 6 },
+		{ 0, 1, 5 }, { 0, 5, 4 }, { 2, 6, 7 }, { 2, 7, 3 },
+		{ 0, 4, 6 }, { 0, 6, 2 }, { 1, 3, 7 }, { 1, 7, 5 } };
+
+	WriteObjectFile(file, vertices, indices);
+	return file;
+}
+
+std::filesystem::path Benchmark::GetScanFile()
+{
+	const int rings = 384;
+	const int segments = 768;
+
+	std::filesystem::path file = m_dataDirectory / ("scan-" + std::to_string(rings) + "x" + std::to_string(segments) + ".obj");
+	if (std::filesystem::exists(file)) return file;
+
+	// A bumpy sphere with roughly the triangle count and detail of a scanned object
+	std::vector<glm::vec3> vertices;
+	for (int i = 0; i <= rings; i++)
+	{
+		float theta = glm::pi<float>() * i / rings;
+		for (int j = 0; j < segments; j++)
+		{
+			float phi = glm::two_pi<float>() * j / segments;
+			float radius = 1.0f + 0.05f * std::sin(7.0f * theta) * std::cos(11.0f * phi) + 0.02f * std::sin(23.0f * theta + 5.0f * phi);
+			vertices.push_back(radius * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+		}
+	}
+
+	std::vector<glm::uvec3> indices;
+	for (int i = 0; i < rings; i++)
+	{
+		for (int j = 0; j < segments; j++)
+		{
+			unsigned int a = i * segments + j;
+			unsigned int b = i * segments + (j + 1) % segments;
+			unsigned int c = a + segments;
+			unsigned int d = b + segments;
+
+			// The first and last ring meet in a single point, so one of their triangles would have no area
+			if (i != 0) indices.push_back(glm::uvec3(a, b, d));
+			if (i != rings - 1) indices.push_back(glm::uvec3(a, d, c));
+		}
+	}
+
+	WriteObjectFile(file, vertices, indices);
+	return file;
+}
+
+void Benchmark::SetupCornellBox()
+{
+	std::filesystem::path cube = GetCubeFile();
+
+	// The floor, ceiling, back and side walls of a 10 by 10 by 10 box with an open front
+	const glm::vec3 positions[] = { { 0.0f, -0.25f, 0.0f }, { 0.0f, 10.25f, 0.0f }, { 0.0f, 5.0f, 5.25f }, { -5.25f, 5.0f, 0.0f }, { 5.25f, 5.0f, 0.0f } };
+	const glm::vec3 scales[] = { { 10.0f, 0.5f, 10.0f }, { 10.0f, 0.5f, 10.0f }, { 10.0f, 10.0f, 0.5f }, { 0.5f, 10.0f, 10.0f }, { 0.5f, 10.0f, 10.0f } };
+	const glm::vec3 colors[] = { { 0.75f, 0.75f, 0.75f }, { 0.75f, 0.75f, 0.75f }, { 0.75f, 0.75f, 0.75f }, { 0.75f, 0.1f, 0.1f }, { 0.1f, 0.75f, 0.1f } };
+	for (int i = 0; i < 5; i++)
+	{
+		Mesh& wall = AddMesh(cube);
+		wall.position = positions[i];
+		wall.scale = scales[i];
+		wall.material = Diffuse(colors[i]);
+		wall.UpdateTransformMatrix();
+	}
+
+	Mesh& light = AddMesh(cube);
+	light.position = { 0.0f, 9.95f, 0.0f };
+	light.scale = { 3.0f, 0.1f, 3.0f };
+	light.material = Light({ 1.0f, 0.9f, 0.8f }, 10.0f);
+	light.UpdateTransformMatrix();
+
+	Mesh& tallBlock = AddMesh(cube);
+	tallBlock.position = { -1.8f, 3.0f, 1.5f };
+	tallBlock.rotation = { 0.0f, 0.3f, 0.0f };
+	tallBlock.scale = { 3.0f, 6.0f, 3.0f };
+	tallBlock.material = Diffuse({ 0.75f, 0.75f, 0.75f });
+	tallBlock.UpdateTransformMatrix();
+
+	Mesh& shortBlock = AddMesh(cube);
+	shortBlock.position = { 2.0f, 1.5f, -1.5f };
+	shortBlock.rotation = { 0.0f, -0.3f, 0.0f };
+	shortBlock.scale = { 3.0f, 3.0f, 3.0f };
+	shortBlock.material = Diffuse({ 0.75f, 0.75f, 0.75f });
+	shortBlock.UpdateTransformMatrix();
+
+	m_scene.camera.position = { 0.0f, 5.0f, -13.0f };
+	m_scene.camera.rotation = { 0.0f, 0.0f, 0.0f };
+	m_renderer.maxBounces = 8;
+}
+
+void Benchmark::SetupManySpheres()
+{
+	// The ground
+	m_scene.spheres.push_back({ { 0.0f, -1000.0f, 0.0f }, 1000.0f, Diffuse({ 0.5f, 0.5f, 0.5f }) });
+
+	// A fixed seed, so every run gets the same spheres
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	for (int x = 0; x < 16; x++)
+	{
+		for (int z = 0; z < 16; z++)
+		{
+			Sphere sphere;
+			sphere.position = { (x - 7.5f) * 1.2f + (unit(random) - 0.5f) * 0.4f, 0.4f, (z - 7.5f) * 1.2f + (unit(random) - 0.5f) * 0.4f };
+			sphere.radius = 0.4f;
+
+			glm::vec3 color(unit(random), unit(random), unit(random));
+			float kind = unit(random);
+			if (kind < 0.1f) sphere.material = Light(color, 4.0f);
+			else if (kind < 0.3f) sphere.material = Glass(color, unit(random) * 0.2f);
+			else sphere.material = Material(color, unit(random), 0.0f, 1.0f, 0.0f, 1.5f, 1.0f);
+
+			m_scene.spheres.push_back(sphere);
+		}
+	}
+
+	m_scene.camera.position = { 0.0f, 6.0f, -14.0f };
+	m_scene.camera.rotation = { 0.35f, 0.0f, 0.0f };
+	m_renderer.maxBounces = 8;
+}
+
+void Benchmark::SetupLargeMesh()
+{
+	m_scene.spheres.push_back({ { 0.0f, -1000.0f, 0.0f }, 1000.0f, Diffuse({ 0.5f, 0.5f, 0.5f }) });
+
+	Mesh& scan = AddMesh(GetScanFile());
+	scan.position = { 0.0f, 3.0f, 0.0f };
+	scan.scale = { 3.0f, 3.0f, 3.0f };
+	scan.material = Material({ 0.8f, 0.6f, 0.4f }, 0.6f, 0.0f, 1.0f, 0.0f, 1.5f, 1.0f);
+	scan.UpdateTransformMatrix();
+
+	m_scene.camera.position = { 0.0f, 4.0f, -9.0f };
+	m_scene.camera.rotation = { 0.15f, 0.0f, 0.0f };
+	m_renderer.maxBounces = 4;
+}
+
+void Benchmark::SetupGlass()
+{
+	m_scene.spheres.push_back({ { 0.0f, -1000.0f, 0.0f }, 1000.0f, Diffuse({ 0.5f, 0.5f, 0.5f }) });
+
+	// Glass spheres from clear to frosted
+	for (int i = 0; i < 5; i++)
+	{
+		m_scene.spheres.push_back({ { (i - 2) * 2.2f, 1.0f, 0.0f }, 1.0f, Glass({ 0.9f, 0.95f, 1.0f }, i * 0.05f) });
+	}
+
+	// Glass blocks behind them, so rays pass through several objects
+	std::filesystem::path cube = GetCubeFile();
+	for (int i = 0; i < 3; i++)
+	{
+		Mesh& block = AddMesh(cube);
+		block.position = { (i - 1) * 3.5f, 1.5f, 3.0f };
+		block.rotation = { 0.0f, 0.4f * (i - 1), 0.0f };
+		block.scale = { 2.0f, 3.0f, 2.0f };
+		block.material = Glass({ 0.8f, 0.9f, 0.8f }, 0.0f);
+		block.UpdateTransformMatrix();
+	}
+
+	m_scene.camera.position = { 0.0f, 3.0f, -8.0f };
+	m_scene.camera.rotation = { 0.2f, 0.0f, 0.0f };
+	m_renderer.maxBounces = 24;
+}
+
+std::string Benchmark::ToJSON(const std::vector<BenchmarkResult>& results, const std::string& renderer, int width, int height, int frames)
+{
+	std::ostringstream json;
+	json << std::fixed << std::setprecision(3);
+	json << "{\n";
+	json << "\t\"renderer\": " << JsonValue::Quote(renderer) << ",\n";
+	json << "\t\"width\": " << width << ",\n";
+	json << "\t\"height\": " << height << ",\n";
+	json << "\t\"frames\": " << frames << ",\n";
+	json << "\t\"scenes\": [\n";
+	for (int i = 0; i < (int)results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		json << "\t\t{\n";
+		json << "\t\t\t\"name\": \"" << result.name << "\",\n";
+		json << "\t\t\t\"spheres\": " << result.nSpheres << ",\n";
+		json << "\t\t\t\"meshes\": " << result.nMeshes << ",\n";
+		json << "\t\t\t\"triangles\": " << result.nTriangles << ",\n";
+		json << "\t\t\t\"samples_per_pixel\": " << result.samplesPerPixel << ",\n";
+		json << "\t\t\t\"max_bounces\": " << result.maxBounces << ",\n";
+		json << "\t\t\t\"obj_parse_ms\": " << result.objParseMs << ",\n";
+		json << "\t\t\t\"bvh_build_ms\": " << result.bvhBuildMs << ",\n";
+		json << "\t\t\t\"ssbo_upload_ms\": " << result.ssboUploadMs << ",\n";
+		json << "\t\t\t\"trace_ms_per_frame\": " << result.traceMsPerFrame << ",\n";
+		json << "\t\t\t\"trace_ms_min\": " << result.traceMsMin << ",\n";
+		json << "\t\t\t\"mrays_per_second\": " << result.mraysPerSecond << "\n";
+		json << "\t\t}" << (i + 1 < (int)results.size() ? "," : "") << "\n";
+	}
+	json << "\t]\n";
+	json << "}\n";
+
+	return json.str();
+}
\ No newline at end of file
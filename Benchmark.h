@@ -0,0 +1,118 @@
+#pragma once
+#ifndef BENCHMARK_CLASS_H
+#define BENCHMARK_CLASS_H
+
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include "Context.h"
+#include "ImageWriter.h"
+#include "Renderer.h"
+#include "Scene.h"
+
+// The timings of a single benchmark scene, in milliseconds
+struct BenchmarkResult
+{
+	std::string name;
+	int nSpheres = 0;
+	int nMeshes = 0;
+	int nTriangles = 0;
+	int samplesPerPixel = 0;
+	int maxBounces = 0;
+
+	double objParseMs = 0.0;
+	double bvhBuildMs = 0.0;
+	double ssboUploadMs = 0.0;
+	double traceMsPerFrame = 0.0;
+	double traceMsMin = 0.0;
+	// Million camera rays per second, the bounces of every ray are not counted
+	double mraysPerSecond = 0.0;
+};
+
+// The error of a progressive render against the reference after some amount of render time
+struct ConvergencePoint
+{
+	double seconds = 0.0;
+	int frames = 0;
+	double rmse = 0.0;
+	// The squared error relative to the squared reference value, so dark and bright parts count equally
+	double relMSE = 0.0;
+};
+
+// The settings a scene is rendered with while converging, and how fast that went
+struct ConvergenceConfiguration
+{
+	std::string name;
+	int maxBounces = 0;
+	int samplesPerPixel = 0;
+
+	std::vector<ConvergencePoint> curve;
+	// The seconds it took to reach the relMSE of every point of the first configuration's curve, negative if it never got there
+	std::vector<double> equalQualitySeconds;
+};
+
+// Renders a fixed set of scenes with fixed cameras, seeds and settings, and reports how long every phase took as JSON
+class Benchmark
+{
+public:
+	// Uses a headless context when asked to, otherwise a window
+	Benchmark(int width, int height, bool headless);
+	~Benchmark();
+
+	// Only run the scene with this name, every scene when empty
+	std::string sceneFilter;
+
+	// Runs every scene for the given amount of frames, prints the JSON and writes it to the file
+	int Run(int frames, const std::string& file);
+	// Renders every scene progressively with a couple of configurations for the given time, measures the error against
+	// a reference image every interval, and prints and writes the curves as JSON.
+	// References are read from the directory as <scene>.pfm, or rendered with the given amount of frames if they are missing
+	int RunConvergence(double seconds, double interval, int referenceFrames, const std::string& referenceDirectory, const std::string& file);
+
+private:
+	int m_width, m_height;
+	Context m_context;
+	Renderer m_renderer;
+	Scene m_scene;
+	ImageWriter m_imageWriter;
+
+	// Where the generated object files are written to
+	std::filesystem::path m_dataDirectory;
+	// The time spent loading the meshes of the current scene
+	double m_objParseMs = 0.0, m_bvhBuildMs = 0.0;
+
+	// Removes every object and resets the settings to the benchmark defaults
+	void ClearScene();
+	// Loads an object file as a new mesh, and adds the time it took to parse and build to the current scene
+	Mesh& AddMesh(const std::filesystem::path& file);
+	static void WriteObjectFile(const std::filesystem::path& file, const std::vector<glm::vec3>& vertices, const std::vector<glm::uvec3>& indices);
+
+	// Generated geometry, only written the first time
+	std::filesystem::path GetCubeFile();
+	std::filesystem::path GetScanFile();
+
+	void SetupCornellBox();
+	void SetupManySpheres();
+	void SetupLargeMesh();
+	void SetupGlass();
+
+	// Every benchmark scene with the function that sets it up
+	struct SceneSetup
+	{
+		const char* name;
+		void (Benchmark::*setup)();
+	};
+	static const std::vector<SceneSetup>& GetScenes();
+
+	BenchmarkResult RunScene(const char* name, void (Benchmark::*setup)(), int frames);
+	static std::string ToJSON(const std::vector<BenchmarkResult>& results, const std::string& renderer, int width, int height, int frames);
+
+	// Renders the current scene progressively and measures the error every interval
+	void Converge(ConvergenceConfiguration& configuration, const std::vector<float>& reference, double seconds, double interval);
+	// Fill in how long every configuration took to reach the quality of the first one
+	static void UpdateEqualQualityTimes(std::vector<ConvergenceConfiguration>& configurations);
+	static bool LoadPFM(const std::filesystem::path& file, int& width, int& height, std::vector<float>& data);
+	void WriteJSON(const std::string& json, const std::string& file) const;
+};
+
+#endif
\ No newline at end of file
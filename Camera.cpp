@@ -10,6 +10,7 @@ Camera::Camera(glm::vec3 position, glm::vec3 rotation) :
 	rotation(rotation)
 {}
 
+#ifndef CONTEXT_NO_WINDOW
 void Camera::Inputs(GLFWwindow* window, const float& deltaTime, const unsigned int& width, const unsigned int& height, bool& changed)
 {
 	glm::vec3 forward = glm::rotateY(WORLD_FORWARD, rotation.y);
@@ -104,4 +105,5 @@ void Camera::Inputs(GLFWwindow* window, const float& deltaTime, const unsigned i
 		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 		firstClick = true;
 	}
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -3,7 +3,9 @@
 #define CAMERA_CLASS_H
 
 #include <glad/glad.h>
+#ifndef CONTEXT_NO_WINDOW
 #include <GLFW/glfw3.h>
+#endif
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -32,8 +34,10 @@ public:
 	Camera();
 	Camera(glm::vec3 position, glm::vec3 rotation);
 
+#ifndef CONTEXT_NO_WINDOW
 	// Updates the camera position and rotation based on the user inputs
 	void Inputs(GLFWwindow* window, const float& deltaTime, const unsigned int& width, const unsigned int& height, bool& changed);
+#endif
 };
 
 #endif
\ No newline at end of file
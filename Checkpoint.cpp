@@ -0,0 +1,142 @@
+#include "Checkpoint.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cstring>
+#include "Trace.h"
+
+// In front of the samples in a checkpoint file
+struct CheckpointHeader
+{
+	char magic[4] = { 'R', 'T', 'C', 'K' };
+	uint32_t version = 1;
+	uint64_t sceneHash = 0;
+	int32_t width = 0, height = 0;
+	uint32_t frame = 0;
+	uint32_t sampleOffset = 0;
+};
+
+std::string AccumulationCheckpoint::GetFile(uint64_t sceneHash)
+{
+	std::ostringstream file;
+	file << "checkpoints/" << std::hex << std::setw(16) << std::setfill('0') << sceneHash << ".ckpt";
+	return file.str();
+}
+
+bool AccumulationCheckpoint::LoadFromFile(const std::string& file)
+{
+	TRACE_SCOPE("AccumulationCheckpoint::LoadFromFile", file);
+
+	std::ifstream in(file, std::ios::binary);
+	if (!in.is_open()) return false;
+
+	CheckpointHeader header, expected;
+	in.read((char*)&header, sizeof(header));
+	if (!in.good() || std::memcmp(header.magic, expected.magic, 4) != 0 || header.version != expected.version) return false;
+	if (header.width <= 0 || header.height <= 0 || header.width > 65536 || header.height > 65536) return false;
+
+	sums.resize((size_t)header.width * header.height * 4);
+	in.read((char*)sums.data(), sums.size() * sizeof(float));
+	if (!in.good())
+	{
+		sums.clear();
+		return false;
+	}
+
+	sceneHash = header.sceneHash;
+	width = header.width;
+	height = header.height;
+	frame = header.frame;
+	sampleOffset = header.sampleOffset;
+	return true;
+}
+
+bool AccumulationCheckpoint::SaveToFile(const std::string& file) const
+{
+	TRACE_SCOPE("AccumulationCheckpoint::SaveToFile", file);
+
+	CheckpointHeader header;
+	header.sceneHash = sceneHash;
+	header.width = width;
+	header.height = height;
+	header.frame = frame;
+	header.sampleOffset = sampleOffset;
+
+	std::error_code error;
+	std::filesystem::path path(file);
+	if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), error);
+
+	// Written next to it first, so a crash while saving keeps the previous checkpoint
+	std::string temporaryFile = file + ".tmp";
+	{
+		std::ofstream out(temporaryFile, std::ios::binary);
+		if (!out.is_open()) return false;
+
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)sums.data(), sums.size() * sizeof(float));
+		if (!out.good()) return false;
+	}
+
+	std::filesystem::rename(temporaryFile, file, error);
+	return !error;
+}
+
+CheckpointWriter::CheckpointWriter() :
+	m_thread(&CheckpointWriter::WorkerLoop, this)
+{}
+
+CheckpointWriter::~CheckpointWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	m_thread.join();
+}
+
+void CheckpointWriter::Write(AccumulationCheckpoint&& checkpoint)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// An older checkpoint of the same scene that is still waiting has nothing the new one does not have
+		for (int i = 0; i < (int)m_checkpoints.size(); i++)
+		{
+			if (m_checkpoints[i].sceneHash != checkpoint.sceneHash) continue;
+			m_checkpoints.erase(m_checkpoints.begin() + i);
+			i--;
+		}
+		m_checkpoints.push_back(std::move(checkpoint));
+	}
+	m_condition.notify_one();
+}
+
+void CheckpointWriter::WorkerLoop()
+{
+	while (true)
+	{
+		AccumulationCheckpoint checkpoint;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return m_stop || !m_checkpoints.empty(); });
+
+			// Only stop once every queued checkpoint is saved
+			if (m_checkpoints.empty()) return;
+
+			checkpoint = std::move(m_checkpoints.front());
+			m_checkpoints.pop_front();
+		}
+
+		std::string file = AccumulationCheckpoint::GetFile(checkpoint.sceneHash);
+		if (checkpoint.SaveToFile(file))
+		{
+			std::cout << "Saved checkpoint: " << file << " at " << checkpoint.frame << " frames\n";
+		}
+		else
+		{
+			std::cout << "Failed to save checkpoint: " << file << "\n";
+		}
+	}
+}
\ No newline at end of file
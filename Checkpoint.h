@@ -0,0 +1,53 @@
+#pragma once
+#ifndef CHECKPOINT_CLASS_H
+#define CHECKPOINT_CLASS_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// The accumulated samples of a render, with everything needed to continue it later
+struct AccumulationCheckpoint
+{
+	// Identifies the scene and settings the samples belong to
+	uint64_t sceneHash = 0;
+	int width = 0, height = 0;
+	// The frame count and offset the random seeds continue from
+	unsigned int frame = 0;
+	unsigned int sampleOffset = 0;
+	// The sum of the samples in rgb and the sample count in alpha, like the accumulation image
+	std::vector<float> sums;
+
+	// Where the checkpoint of a scene is saved
+	static std::string GetFile(uint64_t sceneHash);
+
+	bool LoadFromFile(const std::string& file);
+	bool SaveToFile(const std::string& file) const;
+};
+
+// Saves checkpoints on a background thread, when a newer one comes in before the last one was saved only the newer one is saved
+class CheckpointWriter
+{
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<AccumulationCheckpoint> m_checkpoints;
+	bool m_stop = false;
+	// Declared last so it starts after everything it uses has been constructed
+	std::thread m_thread;
+
+	void WorkerLoop();
+
+public:
+	CheckpointWriter();
+	// Finishes the queued checkpoint before returning
+	~CheckpointWriter();
+
+	// Queues a checkpoint to be saved to its file, takes ownership of the samples
+	void Write(AccumulationCheckpoint&& checkpoint);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "Context.h"
+
+#if defined(CONTEXT_EGL)
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#elif defined(CONTEXT_OSMESA)
+#include <GL/osmesa.h>
+#endif
+
+void Context::CreateWindowed(int width, int height, const std::string& title)
+{
+#ifdef CONTEXT_NO_WINDOW
+	(void)width; (void)height; (void)title;
+	throw std::string("This build has no windows, only headless contexts\n");
+#else
+	// Initialize GLFW
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	// Open a new window
+	m_window = glfwCreateWindow(width, height, title.c_str(), NULL, NULL);
+	if (m_window == NULL)
+	{
+		glfwTerminate();
+		throw std::string("Failed to create GLFW window\n");
+	}
+	glfwMakeContextCurrent(m_window);
+
+	// Load OpenGL
+	if (!gladLoadGL())
+	{
+		throw std::string("Failed to load OpenGL\n");
+	}
+#endif
+}
+
+void Context::CreateHeadless()
+{
+#if defined(CONTEXT_EGL)
+	EGLDisplay display = EGL_NO_DISPLAY;
+
+	// Prefer the surfaceless platform, it does not need a display server at all
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+	{
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if (display == EGL_NO_DISPLAY)
+	{
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		throw std::string("Failed to initialize EGL\n");
+	}
+	eglBindAPI(EGL_OPENGL_API);
+
+	const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint nConfigs = 0;
+	eglChooseConfig(display, configAttributes, &config, 1, &nConfigs);
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE };
+	EGLContext context = eglCreateContext(display, nConfigs > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT)
+	{
+		eglTerminate(display);
+		throw std::string("Failed to create an OpenGL 4.5 EGL context\n");
+	}
+
+	// Without a surface everything has to be drawn into framebuffer objects
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		eglDestroyContext(display, context);
+		eglTerminate(display);
+		throw std::string("Failed to make the EGL context current, EGL_KHR_surfaceless_context is needed\n");
+	}
+
+	m_headlessDisplay = display;
+	m_headlessContext = context;
+
+	// Load OpenGL
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+	{
+		throw std::string("Failed to load OpenGL\n");
+	}
+#elif defined(CONTEXT_OSMESA)
+	const int attributes[] = {
+		OSMESA_FORMAT, OSMESA_RGBA,
+		OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 4,
+		OSMESA_CONTEXT_MINOR_VERSION, 5,
+		0 };
+	OSMesaContext context = OSMesaCreateContextAttribs(attributes, NULL);
+	if (!context)
+	{
+		throw std::string("Failed to create an OpenGL 4.5 OSMesa context\n");
+	}
+
+	m_osmesaBuffer.resize(4);
+	if (!OSMesaMakeCurrent(context, m_osmesaBuffer.data(), GL_UNSIGNED_BYTE, 1, 1))
+	{
+		OSMesaDestroyContext(context);
+		throw std::string("Failed to make the OSMesa context current\n");
+	}
+
+	m_headlessContext = context;
+
+	// Load OpenGL
+	if (!gladLoadGLLoader((GLADloadproc)OSMesaGetProcAddress))
+	{
+		throw std::string("Failed to load OpenGL\n");
+	}
+#else
+	throw std::string("Headless rendering needs a build with CONTEXT_EGL or CONTEXT_OSMESA defined\n");
+#endif
+}
+
+void Context::Destroy()
+{
+#ifndef CONTEXT_NO_WINDOW
+	if (m_window)
+	{
+		glfwDestroyWindow(m_window);
+		glfwTerminate();
+		m_window = nullptr;
+	}
+#endif
+
+#if defined(CONTEXT_EGL)
+	if (m_headlessContext)
+	{
+		eglMakeCurrent((EGLDisplay)m_headlessDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext((EGLDisplay)m_headlessDisplay, (EGLContext)m_headlessContext);
+		eglTerminate((EGLDisplay)m_headlessDisplay);
+	}
+#elif defined(CONTEXT_OSMESA)
+	if (m_headlessContext)
+	{
+		OSMesaDestroyContext((OSMesaContext)m_headlessContext);
+	}
+#endif
+	m_headlessDisplay = nullptr;
+	m_headlessContext = nullptr;
+}
+
+GLFWwindow* Context::GetWindow() const
+{
+	return m_window;
+}
+
+bool Context::IsHeadless() const
+{
+	return m_window == nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#ifndef CONTEXT_CLASS_H
+#define CONTEXT_CLASS_H
+
+#include <glad/glad.h>
+#ifndef CONTEXT_NO_WINDOW
+#include <GLFW/glfw3.h>
+#else
+typedef struct GLFWwindow GLFWwindow;
+#endif
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Owns the OpenGL context, either a GLFW window or a headless context without any window or surface.
+// Headless contexts need the build to define CONTEXT_EGL (surfaceless EGL, link with libEGL)
+// or CONTEXT_OSMESA (OSMesa, also works on llvmpipe without a GPU, link with libOSMesa).
+// Defining CONTEXT_NO_WINDOW leaves out GLFW, then only headless contexts can be created
+class Context
+{
+	GLFWwindow* m_window = nullptr;
+
+	// The EGL display and context, or the OSMesa context
+	void* m_headlessDisplay = nullptr;
+	void* m_headlessContext = nullptr;
+	// OSMesa always needs a color buffer to make its context current, even though nothing is drawn into it
+	std::vector<unsigned char> m_osmesaBuffer;
+
+public:
+	// Opens a window with an OpenGL 4.6 core context, makes it current and loads the OpenGL functions
+	void CreateWindowed(int width, int height, const std::string& title);
+	// Creates an OpenGL 4.5 core context without a window, makes it current and loads the OpenGL functions
+	void CreateHeadless();
+	void Destroy();
+
+	// The window, null for a headless context
+	GLFWwindow* GetWindow() const;
+	bool IsHeadless() const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,793 @@
+#include "CpuTracer.h"
+#include <algorithm>
+#include <cmath>
+#include "Trace.h"
+
+// Flipped in the sample stream of the scene, so the CPU passes never share a random sequence with the GPU frames
+static const unsigned int CPU_SAMPLE_STREAM = 0x80000000u;
+// The most finished tiles that wait for the GPU, the workers pause when it is not taking them
+static const size_t MAX_FINISHED_TILES = 256;
+// The balances the thread count stays the same for before another amount is tried
+static const int BALANCES_BETWEEN_PROBES = 5;
+
+static const float infinity = std::numeric_limits<float>::infinity();
+
+// The ray and hit of the raytrace shader, everything below follows raytrace.frag so the CPU samples match the GPU samples
+struct CpuRay
+{
+	glm::vec3 origin;
+	glm::vec3 normal;
+
+	// The dot product between the normal of the surface the ray is resting on and the ray normal
+	float surfaceNormalDot;
+};
+
+struct CpuHitInfo
+{
+	int didHit = 0;
+	float distance = 0.0f;
+	glm::vec3 point = glm::vec3(0.0f);
+	glm::vec3 normal = glm::vec3(0.0f);
+	glm::vec3 flippedNormal = glm::vec3(0.0f);
+
+	Material material;
+};
+
+static unsigned int Hash(unsigned int value)
+{
+	unsigned int state = value * 747796405u + 2891336453u;
+	unsigned int word = ((state >> ((state >> 28) + 4)) ^ state) * 277803737u;
+	return (word >> 22) ^ word;
+}
+
+static float Random(unsigned int& seed)
+{
+	seed = seed * 747796405u + 2891336453u;
+	unsigned int result = ((seed >> ((seed >> 28) + 4)) ^ seed) * 277803737u;
+	result = (result >> 22) ^ result;
+	return (float)result / 4294967295.0f;
+}
+
+static float NormalDistribution(unsigned int& seed)
+{
+	float theta = 2.0f * 3.14159265359f * Random(seed);
+	float rho = std::sqrt(-2.0f * std::log(Random(seed)));
+	return rho * std::cos(theta);
+}
+
+static glm::vec3 RandomHemisphereNormal(unsigned int& seed, const glm::vec3& normal)
+{
+	// The arguments of a constructor have no defined order in C++, unlike GLSL
+	float x = NormalDistribution(seed);
+	float y = NormalDistribution(seed);
+	float z = NormalDistribution(seed);
+	glm::vec3 randomNormal = glm::normalize(glm::vec3(x, y, z));
+
+	if (glm::dot(randomNormal, normal) < 0.0f)
+	{
+		randomNormal = -randomNormal;
+	}
+
+	return randomNormal;
+}
+
+static glm::vec2 RandomPointInCircle(unsigned int& seed)
+{
+	float angle = Random(seed) * 2 * 3.1415926f;
+	glm::vec2 pointInCircle = glm::vec2(std::cos(angle), std::sin(angle));
+	return pointInCircle * std::sqrt(Random(seed));
+}
+
+static glm::vec3 Reflect(const glm::vec3& v, const glm::vec3& normal)
+{
+	return (v - (normal * glm::dot(v, normal) * 2.0f));
+}
+
+static glm::vec3 Refract(const glm::vec3& I, const glm::vec3& N, float ior)
+{
+	// Clamps -1 instead of the dot product, just like the shader
+	float cosi = glm::clamp(-1.0f, 1.0f, glm::dot(I, N));
+	float etai = 1, etat = ior;
+	glm::vec3 n = N;
+	if (cosi < 0)
+	{
+		cosi = -cosi;
+	}
+	else
+	{
+		std::swap(etai, etat);
+		n = -N;
+	}
+	float eta = etai / etat;
+	float k = 1 - eta * eta * (1 - cosi * cosi);
+
+	if (k < 0)
+	{
+		return glm::vec3(0.0f);
+	}
+
+	return glm::normalize(eta * I + (eta * cosi - std::sqrt(k)) * n);
+}
+
+static float FresnelReflectAmount(const glm::vec3& normal, const glm::vec3& incident, float n1, float n2, float objReflect)
+{
+	// Schlick aproximation
+	float r0 = (n1 - n2) / (n1 + n2);
+	r0 *= r0;
+	float cosX = -glm::dot(normal, incident);
+	if (n1 > n2)
+	{
+		float n = n1 / n2;
+		float sinT2 = n * n * (1.0f - cosX * cosX);
+
+		// Total internal reflection
+		if (sinT2 > 1.0f)
+		{
+			return 1.0f;
+		}
+
+		cosX = std::sqrt(1.0f - sinT2);
+	}
+	float x = 1.0f - cosX;
+	float ret = r0 + (1.0f - r0) * x * x * x * x * x;
+
+	// Adjust reflect multiplier for object reflectivity
+	return objReflect + (1.0f - objReflect) * ret;
+}
+
+static void ReflectRay(CpuRay& ray, const CpuHitInfo& hitInfo, unsigned int& seed)
+{
+	glm::vec3 reflectedNormal = Reflect(ray.normal, hitInfo.normal);
+	glm::vec3 randomNormal = RandomHemisphereNormal(seed, hitInfo.normal);
+
+	ray.normal = glm::normalize(reflectedNormal * (1.0f - hitInfo.material.roughness) + randomNormal * hitInfo.material.roughness);
+	ray.origin = hitInfo.point;
+	ray.surfaceNormalDot = glm::dot(hitInfo.normal, reflectedNormal);
+}
+
+static void RefractRay(CpuRay& ray, const CpuHitInfo& hitInfo, unsigned int& seed)
+{
+	glm::vec3 refractedNormal = Refract(ray.normal, hitInfo.normal, hitInfo.material.refractiveIndex);
+	glm::vec3 randomNormal = RandomHemisphereNormal(seed, hitInfo.flippedNormal);
+
+	ray.normal = glm::normalize(refractedNormal * (1.0f - hitInfo.material.roughness) + randomNormal * hitInfo.material.roughness);
+	ray.origin = hitInfo.point;
+	ray.surfaceNormalDot = glm::dot(hitInfo.normal, refractedNormal);
+}
+
+static CpuHitInfo HitSphere(const CpuRay& ray, const Sphere& sphere)
+{
+	glm::vec3 offsetRayOrigin = ray.origin - sphere.position;
+	float b = 2.0f * glm::dot(offsetRayOrigin, ray.normal);
+
+	float discriminant = b * b - 4.0f * (glm::dot(offsetRayOrigin, offsetRayOrigin) - sphere.radius * sphere.radius);
+	if (discriminant <= 0.0f)
+	{
+		return CpuHitInfo();
+	}
+
+	float distance = 0.5f * (-b - std::sqrt(discriminant));
+	if (distance < 0.0f || (ray.surfaceNormalDot < 0.0f && ray.surfaceNormalDot < 2))
+	{
+		distance = 0.5f * (-b + std::sqrt(discriminant));
+		if (distance < 0.0f || (ray.surfaceNormalDot > 0.0f && ray.surfaceNormalDot < 2))
+		{
+			return CpuHitInfo();
+		}
+	}
+
+	CpuHitInfo hit;
+	hit.didHit = 1;
+	hit.distance = distance;
+	hit.point = ray.origin + ray.normal * distance;
+	hit.normal = glm::normalize(hit.point - sphere.position);
+	hit.flippedNormal = glm::dot(ray.normal, hit.normal) > 0.0f ? -hit.normal : hit.normal;
+	hit.material = sphere.material;
+	return hit;
+}
+
+static void GetTriangleEdges(const Geometry& geometry, int triangleIndex, glm::vec3& a, glm::vec3& edgeAB, glm::vec3& edgeAC, glm::vec3& normal)
+{
+	// Always the full float positions, like the indexed storage
+	Triangle triangle = geometry.GetTriangle(triangleIndex);
+	a = triangle.p[0];
+	edgeAB = triangle.p[1] - triangle.p[0];
+	edgeAC = triangle.p[2] - triangle.p[0];
+	normal = glm::cross(edgeAB, edgeAC);
+}
+
+static float IntersectTriangle(const CpuRay& ray, const Geometry& geometry, int triangleIndex)
+{
+	glm::vec3 a, edgeAB, edgeAC, normal;
+	GetTriangleEdges(geometry, triangleIndex, a, edgeAB, edgeAC, normal);
+
+	float determinant = -glm::dot(ray.normal, normal);
+
+	if (determinant == 0.0f || (determinant < 0.0f && ray.surfaceNormalDot > 0.0f) || (determinant > 0.0f && ray.surfaceNormalDot < 0.0f))
+	{
+		return infinity;
+	}
+
+	glm::vec3 ao = ray.origin - a;
+
+	float invDet = 1.0f / determinant;
+
+	float distance = glm::dot(ao, normal) * invDet;
+	if (distance <= 0.0f)
+	{
+		return infinity;
+	}
+
+	glm::vec3 dao = glm::cross(ao, ray.normal);
+
+	float u = glm::dot(edgeAC, dao) * invDet;
+	float v = -glm::dot(edgeAB, dao) * invDet;
+
+	if (u < 0 || v < 0 || 1.0f - u - v < 0) return infinity;
+
+	return distance;
+}
+
+static CpuHitInfo TriangleHitInfo(const CpuRay& ray, const CpuRay& transformedRay, const CpuScene::Instance& mesh, int triangleIndex, float distance)
+{
+	glm::vec3 a, edgeAB, edgeAC, normal;
+	GetTriangleEdges(*mesh.geometry, triangleIndex, a, edgeAB, edgeAC, normal);
+
+	float determinant = -glm::dot(transformedRay.normal, normal);
+
+	CpuHitInfo hit;
+	hit.didHit = 1;
+	hit.distance = distance;
+	// The transformed ray has the same distances as the world space ray
+	hit.point = ray.origin + ray.normal * distance;
+	hit.normal = glm::normalize(normal);
+	hit.flippedNormal = determinant < 0.0f ? -hit.normal : hit.normal;
+	hit.material = mesh.material;
+	return hit;
+}
+
+static float HitBoundingBox(const CpuRay& ray, const BoundingBox& boundingBox)
+{
+	glm::vec3 invDirection = glm::vec3(1.0f) / ray.normal;
+	glm::vec3 tMin = (boundingBox.min - ray.origin) * invDirection;
+	glm::vec3 tMax = (boundingBox.max - ray.origin) * invDirection;
+
+	glm::vec3 t1 = glm::min(tMin, tMax);
+	glm::vec3 t2 = glm::max(tMin, tMax);
+
+	float dstFar = std::min(std::min(t2.x, t2.y), t2.z);
+	float dstNear = std::max(std::max(t1.x, t1.y), t1.z);
+
+	if (dstFar >= dstNear && dstFar > 0.0f)
+	{
+		return dstNear;
+	}
+	return infinity;
+}
+
+static void CheckSphereCollitions(const CpuScene& scene, const CpuRay& ray, CpuHitInfo& closestHit)
+{
+	for (const Sphere& sphere : scene.spheres)
+	{
+		CpuHitInfo hit = HitSphere(ray, sphere);
+
+		if (hit.didHit == 0) continue;
+		if (closestHit.distance >= hit.distance || closestHit.didHit == 0)
+		{
+			closestHit = hit;
+		}
+	}
+}
+
+static void CheckTriangleCollitions(const CpuScene& scene, const CpuRay& ray, CpuHitInfo& closestHit)
+{
+	// The closest triangle so far
+	int closestMeshIndex = -1;
+	int closestTriangleIndex = -1;
+	CpuRay closestTransformedRay = ray;
+
+	for (int meshIndex = 0; meshIndex < (int)scene.meshes.size(); meshIndex++)
+	{
+		const CpuScene::Instance& mesh = scene.meshes[meshIndex];
+		const std::vector<BoundingBox>& boundingBoxes = mesh.geometry->boundingBoxes;
+		if (boundingBoxes.empty()) continue;
+
+		CpuRay transformedRay = ray;
+		transformedRay.origin = glm::vec3(mesh.worldToLocalMatrix * glm::vec4(ray.origin, 1.0f));
+		transformedRay.normal = glm::vec3(mesh.worldToLocalMatrix * glm::vec4(ray.normal, 0.0f));
+
+		// The boxes are relative to the geometry here, so the root is always the first one
+		int currentBoxIndex = 0;
+
+		// The boxes to check stack, a box that does not fit anymore is skipped just like on the GPU
+		const int STACK_SIZE = 32;
+		int boxesToCheck[STACK_SIZE];
+		float closestIntersection[STACK_SIZE];
+		int nBoxesToCheck = 0;
+		bool needsNewBox = false;
+
+		closestIntersection[0] = HitBoundingBox(transformedRay, boundingBoxes[currentBoxIndex]);
+		if (closestIntersection[0] == infinity)
+		{
+			continue;
+		}
+
+		while (!needsNewBox || nBoxesToCheck != 0)
+		{
+			if (needsNewBox)
+			{
+				nBoxesToCheck--;
+				currentBoxIndex = boxesToCheck[nBoxesToCheck];
+
+				// Check if the box is even worth checking
+				if (closestIntersection[nBoxesToCheck] >= closestHit.distance && closestHit.didHit == 1)
+				{
+					continue;
+				}
+
+				needsNewBox = false;
+			}
+
+			const BoundingBox& currentBox = boundingBoxes[currentBoxIndex];
+
+			int boxIndexA = currentBox.boundingBoxAIndex;
+			int boxIndexB = currentBox.boundingBoxBIndex;
+
+			// Check if node is a leaf node
+			if (boxIndexA == -1 || boxIndexB == -1)
+			{
+				if (currentBox.triangleIndex != -1)
+				{
+					float distance = IntersectTriangle(transformedRay, *mesh.geometry, currentBox.triangleIndex);
+
+					if (distance != infinity && (closestHit.didHit == 0 || closestHit.distance >= distance))
+					{
+						closestHit.didHit = 1;
+						closestHit.distance = distance;
+						closestMeshIndex = meshIndex;
+						closestTriangleIndex = currentBox.triangleIndex;
+						closestTransformedRay = transformedRay;
+					}
+				}
+
+				needsNewBox = true;
+				continue;
+			}
+
+			float distanceA = HitBoundingBox(transformedRay, boundingBoxes[boxIndexA]);
+			float distanceB = HitBoundingBox(transformedRay, boundingBoxes[boxIndexB]);
+
+			// If the distance is more than the closest hit, there is no need to check any further
+			if (distanceA >= closestHit.distance && closestHit.didHit == 1) distanceA = infinity;
+			if (distanceB >= closestHit.distance && closestHit.didHit == 1) distanceB = infinity;
+
+			if (distanceA != infinity && distanceB != infinity)
+			{
+				// Check the closer box first and push the other one
+				int nearIndex = distanceA < distanceB ? boxIndexA : boxIndexB;
+				int farIndex = distanceA < distanceB ? boxIndexB : boxIndexA;
+				if (nBoxesToCheck < STACK_SIZE)
+				{
+					boxesToCheck[nBoxesToCheck] = farIndex;
+					closestIntersection[nBoxesToCheck] = std::max(distanceA, distanceB);
+					nBoxesToCheck++;
+				}
+				currentBoxIndex = nearIndex;
+			}
+			else if (distanceA != infinity)
+			{
+				currentBoxIndex = boxIndexA;
+			}
+			else if (distanceB != infinity)
+			{
+				currentBoxIndex = boxIndexB;
+			}
+			else
+			{
+				needsNewBox = true;
+			}
+		}
+	}
+
+	if (closestMeshIndex != -1)
+	{
+		closestHit = TriangleHitInfo(ray, closestTransformedRay, scene.meshes[closestMeshIndex], closestTriangleIndex, closestHit.distance);
+	}
+}
+
+static CpuHitInfo RayCollition(const CpuScene& scene, const CpuRay& ray)
+{
+	CpuHitInfo closestHit;
+
+	CheckSphereCollitions(scene, ray, closestHit);
+	CheckTriangleCollitions(scene, ray, closestHit);
+
+	return closestHit;
+}
+
+static glm::vec3 SkyColor(const CpuScene& scene, const glm::vec3& normal)
+{
+	if (!scene.skybox || scene.skyboxWidth == 0 || scene.skyboxHeight == 0) return glm::vec3(0.0f);
+
+	// The pitch and yaw of sky.glsl, in degrees
+	glm::vec3 dir = glm::normalize(normal);
+	float pitch = glm::degrees(std::asin(dir.y));
+	float yaw = 0.0f;
+	if (dir.x > 0)
+	{
+		yaw = glm::degrees(std::atan(dir.z / dir.x));
+	}
+	else if (dir.x < 0)
+	{
+		yaw = glm::degrees(std::atan(dir.z / dir.x)) + 180.0f;
+	}
+	else
+	{
+		yaw = (dir.z >= 0) ? 90.0f : -90.0f;
+	}
+
+	// Bilinear at the full resolution with a repeating wrap, like textureLod with the default sampler settings
+	float u = yaw / 360.0f * scene.skyboxWidth - 0.5f;
+	float v = (1.0f - (pitch + 90.0f) / 180.0f) * scene.skyboxHeight - 0.5f;
+	if (!std::isfinite(u) || !std::isfinite(v)) return glm::vec3(0.0f);
+
+	float x0 = std::floor(u), y0 = std::floor(v);
+	float fx = u - x0, fy = v - y0;
+
+	const std::vector<float>& pixels = *scene.skybox;
+	auto texel = [&](float x, float y)
+	{
+		int ix = (int)(x - std::floor(x / scene.skyboxWidth) * scene.skyboxWidth) % scene.skyboxWidth;
+		int iy = (int)(y - std::floor(y / scene.skyboxHeight) * scene.skyboxHeight) % scene.skyboxHeight;
+		const float* pixel = &pixels[((size_t)iy * scene.skyboxWidth + ix) * 3];
+		return glm::vec3(pixel[0], pixel[1], pixel[2]);
+	};
+
+	glm::vec3 top = glm::mix(texel(x0, y0), texel(x0 + 1.0f, y0), fx);
+	glm::vec3 bottom = glm::mix(texel(x0, y0 + 1.0f), texel(x0 + 1.0f, y0 + 1.0f), fx);
+	return glm::mix(top, bottom, fy);
+}
+
+static glm::vec3 TracePath(const CpuScene& scene, CpuRay ray, unsigned int& seed)
+{
+	glm::vec3 incomingLight = glm::vec3(0.0f);
+	glm::vec3 rayColor = glm::vec3(1.0f);
+	float currentRefractiveIndex = 1.0f;
+	int isInsideObject = 0;
+
+	for (int i = 0; i <= scene.maxBounces; i++)
+	{
+		CpuHitInfo hitInfo = RayCollition(scene, ray);
+
+		float surfaceNormalDot = glm::dot(hitInfo.normal, ray.normal);
+
+		if (i == 0)
+		{
+			// Check what starting refractive index the ray has
+			currentRefractiveIndex = surfaceNormalDot > 0.0f ? hitInfo.material.refractiveIndex : 1.0f;
+		}
+
+		if (hitInfo.didHit == 0)
+		{
+			// Ray shooting off to sky, so we add the sky color
+			incomingLight += SkyColor(scene, ray.normal) * rayColor;
+			break;
+		}
+
+		// Check if the ray is inside of an object and adjust the current IOR accordingly
+		float nextRefractiveIndex = 0.0f;
+		if (surfaceNormalDot > 0.0f)
+		{
+			isInsideObject = 1;
+			nextRefractiveIndex = 1.0f;
+		}
+		else
+		{
+			isInsideObject = 0;
+			nextRefractiveIndex = hitInfo.material.refractiveIndex;
+		}
+
+		float fresnelReflectIndex = FresnelReflectAmount(hitInfo.flippedNormal, ray.normal, currentRefractiveIndex, nextRefractiveIndex, hitInfo.material.reflectiveIndex);
+
+		if (Random(seed) <= fresnelReflectIndex)
+		{
+			ReflectRay(ray, hitInfo, seed);
+			rayColor = rayColor * hitInfo.material.color;
+		}
+		else
+		{
+			RefractRay(ray, hitInfo, seed);
+			// If we refract and we are not inside of an object we know that we just passed through an object
+			if (isInsideObject == 1)
+			{
+				rayColor *= glm::exp(-hitInfo.material.absorbColor * hitInfo.material.absorbsionStrength * hitInfo.distance);
+			}
+
+			currentRefractiveIndex = nextRefractiveIndex;
+		}
+
+		// Only add emission if the ray is as parallell as specified if the material
+		if (surfaceNormalDot < -1.0f + hitInfo.material.emissionScatteringIndex)
+		{
+			incomingLight += hitInfo.material.emissionColor * hitInfo.material.emissionStrength * rayColor;
+		}
+	}
+
+	return incomingLight;
+}
+
+static glm::vec3 TracePixel(const CpuScene& scene, int x, int y, unsigned int frame, unsigned int stream)
+{
+	// The coordinate the fragment shader gets at the center of the pixel
+	glm::vec2 coordinate = glm::vec2((x + 0.5f) / scene.width, (y + 0.5f) / scene.height) * 2.0f - 1.0f;
+	float aspectRatio = (float)scene.height / (float)scene.width;
+
+	unsigned int seed = Hash((unsigned int)x + Hash((unsigned int)y + Hash(frame + Hash(stream))));
+
+	glm::vec3 averageColor = glm::vec3(0.0f);
+
+	for (int s = 0; s < scene.samplesPerPixel; s++)
+	{
+		// The shader skips drawing these random numbers when the blur is baked in as zero
+		glm::vec2 randomBlurPoint = scene.blur != 0.0f ? RandomPointInCircle(seed) * scene.blur : glm::vec2(0.0f);
+		glm::vec2 randomFocalBlurPoint = scene.focalBlur != 0.0f ? RandomPointInCircle(seed) * scene.focalBlur : glm::vec2(0.0f);
+
+		glm::vec3 gridPoint = glm::vec3(coordinate.x * scene.focalDistance * scene.perspectiveSlope, coordinate.y * scene.focalDistance * scene.perspectiveSlope * aspectRatio, scene.focalDistance);
+		gridPoint += glm::vec3(randomBlurPoint, 0.0f) * scene.focalDistance;
+
+		CpuRay ray;
+		ray.origin = glm::vec3(scene.cameraRotation * glm::vec4(randomFocalBlurPoint, 0.0f, 0.0f)) + scene.cameraPosition;
+		ray.normal = glm::vec3(scene.cameraRotation * glm::vec4(glm::normalize(gridPoint - glm::vec3(randomFocalBlurPoint, 0.0f)), 0.0f));
+		ray.surfaceNormalDot = 0.0f;
+
+		averageColor += TracePath(scene, ray, seed);
+	}
+
+	return averageColor / (float)scene.samplesPerPixel;
+}
+
+CpuTracer::~CpuTracer()
+{
+	Uninitialize();
+}
+
+void CpuTracer::Initialize()
+{
+	int nThreads = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+	m_activeThreads = nThreads;
+	m_stop = false;
+
+	for (int i = 0; i < nThreads; i++)
+	{
+		m_threads.emplace_back(&CpuTracer::WorkerLoop, this, i);
+	}
+}
+
+void CpuTracer::Uninitialize()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_generation++;
+	}
+	m_condition.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+	m_threads.clear();
+}
+
+void CpuTracer::Start(std::shared_ptr<const CpuScene> scene)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_generation++;
+		m_finishedTiles.clear();
+
+		// Nothing to trace in an empty viewport
+		m_scene = scene->width > 0 && scene->height > 0 ? scene : nullptr;
+		if (!m_scene) return;
+
+		m_nextTile = 0;
+
+		// Size the tiles so a single one takes about the set time, going by the samples traced so far
+		double secondsPerSample = m_secondsPerSample;
+		int tileSize = 32;
+		if (secondsPerSample > 0.0)
+		{
+			tileSize = (int)std::sqrt(tileSeconds / (secondsPerSample * std::max(scene->samplesPerPixel, 1)));
+			tileSize = std::max(8, std::min(256, tileSize / 8 * 8));
+		}
+		m_tileSize = tileSize;
+		m_nTilesX = (scene->width + tileSize - 1) / tileSize;
+		m_nTilesY = (scene->height + tileSize - 1) / tileSize;
+	}
+	m_condition.notify_all();
+}
+
+void CpuTracer::Stop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_scene = nullptr;
+	m_generation++;
+	m_finishedTiles.clear();
+
+	// The workers check the generation every row, so this does not take long
+	m_condition.wait(lock, [this] { return m_busyThreads == 0; });
+}
+
+bool CpuTracer::IsRunning()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_scene != nullptr;
+}
+
+bool CpuTracer::TakeTile(CpuTile& tile)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_finishedTiles.empty()) return false;
+
+		tile = std::move(m_finishedTiles.front());
+		m_finishedTiles.pop_front();
+	}
+
+	// A worker might be waiting for room
+	m_condition.notify_all();
+	return true;
+}
+
+void CpuTracer::Balance(uint64_t gpuSamples)
+{
+	m_gpuSamples += gpuSamples;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - m_balanceTime).count();
+	if (seconds < balanceSeconds) return;
+
+	m_cpuSamplesPerSecond = m_cpuSamples.exchange(0) / seconds;
+	m_gpuSamplesPerSecond = m_gpuSamples / seconds;
+	m_gpuSamples = 0;
+	m_balanceTime = now;
+
+	// The CPU threads compete with the thread that feeds the GPU, so more of them is not always faster.
+	// A step is kept while the total goes up, a step down is also kept when it stays about the same since it frees a core
+	double samplesPerSecond = m_cpuSamplesPerSecond + m_gpuSamplesPerSecond;
+	int nThreads = (int)m_threads.size();
+	int activeThreads = m_activeThreads;
+	if (m_balanceDirection != 0)
+	{
+		bool better = m_balanceDirection > 0 ? samplesPerSecond > m_previousSamplesPerSecond * 1.02 : samplesPerSecond > m_previousSamplesPerSecond * 0.98;
+		if (!better)
+		{
+			activeThreads -= m_balanceDirection;
+			m_balanceDirection = 0;
+		}
+		else if (activeThreads + m_balanceDirection < 0 || activeThreads + m_balanceDirection > nThreads)
+		{
+			m_balanceDirection = 0;
+		}
+		else
+		{
+			activeThreads += m_balanceDirection;
+		}
+		m_balancesSinceStep = 0;
+	}
+	else if (++m_balancesSinceStep >= BALANCES_BETWEEN_PROBES && nThreads > 0)
+	{
+		// Try a step now and then, the scene or the load on the machine changes the best amount
+		m_probeUp = !m_probeUp;
+		m_balanceDirection = (m_probeUp && activeThreads < nThreads) || activeThreads == 0 ? 1 : -1;
+		activeThreads += m_balanceDirection;
+		m_balancesSinceStep = 0;
+	}
+	m_previousSamplesPerSecond = samplesPerSecond;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_activeThreads = activeThreads;
+	}
+	m_condition.notify_all();
+}
+
+int CpuTracer::GetThreadCount() const
+{
+	return (int)m_threads.size();
+}
+
+int CpuTracer::GetActiveThreadCount() const
+{
+	return m_activeThreads;
+}
+
+double CpuTracer::GetCpuSamplesPerSecond() const
+{
+	return m_cpuSamplesPerSecond;
+}
+
+double CpuTracer::GetGpuSamplesPerSecond() const
+{
+	return m_gpuSamplesPerSecond;
+}
+
+void CpuTracer::WorkerLoop(int index)
+{
+	while (true)
+	{
+		std::shared_ptr<const CpuScene> scene;
+		unsigned int generation, pass;
+		glm::ivec4 region;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this, index] { return m_stop || (m_scene && index < m_activeThreads && m_finishedTiles.size() < MAX_FINISHED_TILES); });
+			if (m_stop) return;
+
+			scene = m_scene;
+			generation = m_generation;
+
+			// Pass after pass over every tile, so the samples spread evenly over the viewport
+			unsigned int tileNumber = m_nextTile++;
+			unsigned int nTiles = m_nTilesX * m_nTilesY;
+			int tileIndex = tileNumber % nTiles;
+			pass = tileNumber / nTiles;
+
+			int x = tileIndex % m_nTilesX * m_tileSize;
+			int y = tileIndex / m_nTilesX * m_tileSize;
+			region = glm::ivec4(x, y, std::min(m_tileSize, scene->width - x), std::min(m_tileSize, scene->height - y));
+			m_busyThreads++;
+		}
+
+		CpuTile tile;
+		tile.region = region;
+		bool finished = TraceTile(*scene, generation, pass, tile);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busyThreads--;
+			if (finished && generation == m_generation) m_finishedTiles.push_back(std::move(tile));
+		}
+		// Stop might be waiting for this worker
+		m_condition.notify_all();
+	}
+}
+
+bool CpuTracer::TraceTile(const CpuScene& scene, unsigned int generation, unsigned int pass, CpuTile& tile)
+{
+	TRACE_SCOPE("CpuTracer::TraceTile");
+
+	int x = tile.region.x, y = tile.region.y;
+	tile.sums.resize((size_t)tile.region.z * tile.region.w * 4);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	// Every start gets its own frames too, a tracer that was stopped while uploading continues with new samples
+	unsigned int frame = generation * 0x10000u + pass;
+	unsigned int stream = scene.sampleStream ^ CPU_SAMPLE_STREAM;
+
+	for (int row = 0; row < tile.region.w; row++)
+	{
+		if (m_generation != generation) return false;
+
+		for (int column = 0; column < tile.region.z; column++)
+		{
+			glm::vec3 color = TracePixel(scene, x + column, y + row, frame, stream);
+
+			float* sum = &tile.sums[((size_t)row * tile.region.z + column) * 4];
+			sum[0] = color.r;
+			sum[1] = color.g;
+			sum[2] = color.b;
+			sum[3] = 1.0f;
+		}
+	}
+
+	uint64_t samples = (uint64_t)tile.region.z * tile.region.w * std::max(scene.samplesPerPixel, 1);
+	m_cpuSamples += samples;
+
+	// Smoothed, a single tile can be all sky or all geometry
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double secondsPerSample = m_secondsPerSample;
+	m_secondsPerSample = secondsPerSample == 0.0 ? seconds / samples : secondsPerSample * 0.9 + seconds / samples * 0.1;
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+#ifndef CPU_TRACER_CLASS_H
+#define CPU_TRACER_CLASS_H
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Objects.h"
+
+// A copy of everything the raytrace shader reads, so the CPU can trace it while the scene keeps changing.
+// The geometries are shared instead of copied, the scene swaps them for new ones instead of changing them
+struct CpuScene
+{
+	struct Instance
+	{
+		glm::mat4 worldToLocalMatrix;
+		Material material;
+		std::shared_ptr<const Geometry> geometry;
+	};
+
+	std::vector<Sphere> spheres;
+	std::vector<Instance> meshes;
+
+	// The skybox as RGB floats, top row first like it was uploaded
+	std::shared_ptr<const std::vector<float>> skybox;
+	int skyboxWidth = 0, skyboxHeight = 0;
+
+	glm::mat4 cameraRotation = glm::mat4(1.0f);
+	glm::vec3 cameraPosition = glm::vec3(0.0f);
+
+	// The viewport and raytracing settings, the same uniforms the shader gets
+	int width = 0, height = 0;
+	int maxBounces = 0;
+	int samplesPerPixel = 1;
+	float perspectiveSlope = 0.0f;
+	float focalDistance = 0.0f;
+	float focalBlur = 0.0f;
+	float blur = 0.0f;
+	unsigned int sampleStream = 0;
+};
+
+// One traced pass over a tile, in the layout of the accumulation image
+struct CpuTile
+{
+	// x, y, width and height from the bottom left
+	glm::ivec4 region = glm::ivec4(0);
+	// The average of the samples of the pass in rgb and 1 in alpha for every pixel, bottom row first
+	std::vector<float> sums;
+};
+
+// Traces the raytrace shader on a pool of CPU threads, pass after pass over the tiles of the viewport, while the GPU renders the frames.
+// The amount of threads that trace is balanced by the measured samples per second of the CPU and GPU together
+class CpuTracer
+{
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop = false;
+
+	// The scene that is being traced, nullptr while stopped
+	std::shared_ptr<const CpuScene> m_scene;
+	// Goes up on every start and stop, a tile of an older generation is thrown away
+	std::atomic<unsigned int> m_generation = 0;
+	// The next tile to trace, the tiles are handed out in passes over the viewport
+	std::atomic<unsigned int> m_nextTile = 0;
+	int m_tileSize = 32;
+	int m_nTilesX = 0, m_nTilesY = 0;
+	// Workers with an index from here on wait
+	std::atomic<int> m_activeThreads = 0;
+	// Workers that are in the middle of a tile
+	int m_busyThreads = 0;
+
+	std::deque<CpuTile> m_finishedTiles;
+
+	// Counted since the last balance
+	std::atomic<uint64_t> m_cpuSamples = 0;
+	uint64_t m_gpuSamples = 0;
+	std::chrono::steady_clock::time_point m_balanceTime = std::chrono::steady_clock::now();
+	// What the last balance measured, and which way it moved the thread count or 0 when it kept it
+	double m_cpuSamplesPerSecond = 0.0;
+	double m_gpuSamplesPerSecond = 0.0;
+	double m_previousSamplesPerSecond = 0.0;
+	int m_balanceDirection = 0;
+	int m_balancesSinceStep = 0;
+	bool m_probeUp = false;
+	// The seconds a single sample of a pixel took on one thread, used to size the tiles
+	std::atomic<double> m_secondsPerSample = 0.0;
+
+	void WorkerLoop(int index);
+	// Traces one pass over the region of the tile, returns false when a newer generation started in the meantime
+	bool TraceTile(const CpuScene& scene, unsigned int generation, unsigned int pass, CpuTile& tile);
+
+public:
+	// How long one tile should take, long enough to keep the overhead low and short enough to stop quickly
+	float tileSeconds = 0.05f;
+	// How often the thread count is balanced
+	float balanceSeconds = 2.0f;
+
+	// Stops the workers if that did not happen yet
+	~CpuTracer();
+
+	// Starts the workers, one per core except the one that feeds the GPU
+	void Initialize();
+	void Uninitialize();
+
+	// Starts tracing a new accumulation, the tiles of the previous one are thrown away
+	void Start(std::shared_ptr<const CpuScene> scene);
+	// Stops tracing and waits for the tiles in progress, so the scene can be changed safely afterwards
+	void Stop();
+	bool IsRunning();
+
+	// Gets a finished tile of the current accumulation, returns false when there is none
+	bool TakeTile(CpuTile& tile);
+	// Counts the samples the GPU added, and moves the thread count towards the most samples per second of both together
+	void Balance(uint64_t gpuSamples);
+
+	int GetThreadCount() const;
+	int GetActiveThreadCount() const;
+	double GetCpuSamplesPerSecond() const;
+	double GetGpuSamplesPerSecond() const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "DistributedRender.h"
+#include "HeadlessApp.h"
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+// Every message starts with this header, and every value is little endian
+const uint32_t MESSAGE_MAGIC = 0x52445452;
+const uint32_t PROTOCOL_VERSION = 1;
+// The largest scene document a worker accepts, the same as a request to the render server
+const size_t MAX_DOCUMENT_SIZE = 16 << 20;
+const size_t MAX_ERROR_SIZE = 4096;
+
+enum MessageType : uint32_t
+{
+	// Both sides send the protocol version first
+	MESSAGE_HELLO,
+	// A JobHeader followed by the scene document
+	MESSAGE_JOB,
+	// The JobHeader of the job followed by the sums and sample counts of its region
+	MESSAGE_RESULT,
+	// Text of what went wrong with a job
+	MESSAGE_ERROR
+};
+
+struct MessageHeader
+{
+	uint32_t magic = MESSAGE_MAGIC;
+	uint32_t type = MESSAGE_HELLO;
+	uint64_t size = 0;
+};
+
+struct JobHeader
+{
+	int32_t width, height;
+	int32_t region[4];
+	uint32_t sampleOffset;
+	int32_t frames;
+};
+
+static bool SendRenderMessage(Socket& socket, MessageType type, const void* data, size_t size, const void* extraData = nullptr, size_t extraSize = 0)
+{
+	MessageHeader header;
+	header.type = type;
+	header.size = size + extraSize;
+	return socket.SendAll(&header, sizeof(header)) && socket.SendAll(data, size) && socket.SendAll(extraData, extraSize);
+}
+
+// Messages bigger than what the receiver expects are refused before anything is allocated for them
+static bool ReceiveRenderMessage(Socket& socket, MessageType& type, std::vector<char>& data, size_t maxSize)
+{
+	MessageHeader header;
+	if (!socket.ReceiveAll(&header, sizeof(header)) || header.magic != MESSAGE_MAGIC) return false;
+	if (header.size > maxSize) return false;
+
+	type = (MessageType)header.type;
+	data.resize((size_t)header.size);
+	return socket.ReceiveAll(data.data(), data.size());
+}
+
+static bool Handshake(Socket& socket)
+{
+	MessageType type;
+	std::vector<char> data;
+	if (!SendRenderMessage(socket, MESSAGE_HELLO, &PROTOCOL_VERSION, sizeof(PROTOCOL_VERSION)) || !ReceiveRenderMessage(socket, type, data, sizeof(PROTOCOL_VERSION))) return false;
+
+	uint32_t version = 0;
+	if (type != MESSAGE_HELLO || data.size() != sizeof(version)) return false;
+	std::memcpy(&version, data.data(), sizeof(version));
+	return version == PROTOCOL_VERSION;
+}
+
+int RenderCoordinator::Render(const std::string& sceneFile, int width, int height, int frames, const std::string& output)
+{
+	TRACE_SCOPE("RenderCoordinator::Render", sceneFile);
+
+	// The workers get the document itself, only the files of the meshes and skybox have to be reachable for them
+	std::ifstream in(sceneFile, std::ios::binary);
+	if (!in.is_open())
+	{
+		std::cout << "Failed to open scene: " << sceneFile << "\n";
+		return 1;
+	}
+	m_document.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	if (workers.empty())
+	{
+		std::cout << "No workers to render on\n";
+		return 1;
+	}
+	// The workers refuse anything bigger, the same as the render server
+	if (width <= 0 || height <= 0 || width > 16384 || height > 16384)
+	{
+		std::cout << "The size has to be 1 to 16384 pixels: " << width << "x" << height << "\n";
+		return 1;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_sums.assign((size_t)width * height * 4, 0.0f);
+
+	if (tileSize > 0)
+	{
+		for (int y = 0; y < height; y += tileSize)
+		{
+			for (int x = 0; x < width; x += tileSize)
+			{
+				m_units.push_back({ glm::ivec4(x, y, std::min(tileSize, width - x), std::min(tileSize, height - y)), 0, frames });
+			}
+		}
+	}
+	else
+	{
+		// A few ranges per worker, so the faster ones end up taking more of them
+		int rangeCount = std::max(1, std::min(frames, (int)workers.size() * 4));
+		for (int i = 0; i < rangeCount; i++)
+		{
+			int first = frames * i / rangeCount;
+			int last = frames * (i + 1) / rangeCount;
+			m_units.push_back({ glm::ivec4(0, 0, width, height), (unsigned int)first, last - first });
+		}
+	}
+	m_unitsLeft = (int)m_units.size();
+	m_workersAlive = (int)workers.size();
+
+	std::cout << "Rendering " << m_units.size() << " units on " << workers.size() << " workers\n";
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::thread> threads;
+	for (const std::string& worker : workers)
+	{
+		threads.emplace_back(&RenderCoordinator::WorkerLoop, this, worker);
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	if (m_unitsLeft > 0)
+	{
+		std::cout << "Every worker failed with " << m_unitsLeft << " units left\n";
+		return 1;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "Rendered " << frames << " frames in " << seconds << "s\n";
+
+	std::vector<float> frame;
+	Renderer::ResolveAccumulation(m_sums.data(), width, height, frame);
+	if (!ImageWriter::WriteNow(output, ImageWriter::GetFormat(output), width, height, std::move(frame)))
+	{
+		std::cout << "Failed to save: " << output << "\n";
+		return 1;
+	}
+	std::cout << "Saved frame: " << output << "\n";
+	return 0;
+}
+
+bool RenderCoordinator::TakeUnit(RenderUnit& unit)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_condition.wait(lock, [this] { return m_unitsLeft == 0 || !m_units.empty(); });
+
+	if (m_units.empty()) return false;
+
+	unit = m_units.front();
+	m_units.pop_front();
+	return true;
+}
+
+void RenderCoordinator::FinishUnit(const RenderUnit& unit, const std::vector<float>& sums)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Both the sums and the sample counts add up, whether the units split the pixels or the samples
+	for (int y = 0; y < unit.region.w; y++)
+	{
+		const float* source = &sums[(size_t)y * unit.region.z * 4];
+		float* destination = &m_sums[((size_t)(unit.region.y + y) * m_width + unit.region.x) * 4];
+		for (int i = 0; i < unit.region.z * 4; i++)
+		{
+			destination[i] += source[i];
+		}
+	}
+
+	m_unitsLeft--;
+	if (m_unitsLeft == 0) m_condition.notify_all();
+}
+
+void RenderCoordinator::WorkerLoop(const std::string& address)
+{
+	Socket socket;
+	bool connected = socket.Connect(address);
+	if (connected)
+	{
+		socket.SetTimeout(timeout);
+		connected = Handshake(socket);
+	}
+	if (!connected) std::cout << "Failed to connect to worker: " << address << "\n";
+
+	RenderUnit unit;
+	while (connected && TakeUnit(unit))
+	{
+		JobHeader job = { m_width, m_height, { unit.region.x, unit.region.y, unit.region.z, unit.region.w }, unit.sampleOffset, unit.frames };
+
+		// The result holds the sums of the unit's region and nothing else
+		size_t sumsSize = (size_t)unit.region.z * unit.region.w * 4 * sizeof(float);
+		MessageType type;
+		std::vector<char> data;
+		bool rendered = SendRenderMessage(socket, MESSAGE_JOB, &job, sizeof(job), m_document.data(), m_document.size()) &&
+			ReceiveRenderMessage(socket, type, data, std::max(sizeof(JobHeader) + sumsSize, MAX_ERROR_SIZE));
+
+		if (rendered && type == MESSAGE_RESULT && data.size() == sizeof(JobHeader) + sumsSize)
+		{
+			std::vector<float> sums((size_t)unit.region.z * unit.region.w * 4);
+			std::memcpy(sums.data(), data.data() + sizeof(JobHeader), sumsSize);
+			FinishUnit(unit, sums);
+			continue;
+		}
+
+		if (rendered && type == MESSAGE_ERROR) std::cout << "Worker " << address << " failed: " << std::string(data.begin(), data.end()) << "\n";
+		else std::cout << "Lost worker: " << address << "\n";
+
+		// Someone else has to do it
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_units.push_back(unit);
+		m_condition.notify_all();
+		connected = false;
+	}
+
+	// Without any workers left the units that are still queued will never be done
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_workersAlive--;
+	if (m_workersAlive == 0 && m_unitsLeft > 0)
+	{
+		m_units.clear();
+		m_condition.notify_all();
+	}
+}
+
+int RenderWorker::Serve(int port)
+{
+	Socket listener;
+	if (!listener.Listen(port, !remoteAccess))
+	{
+		std::cout << "Failed to listen on port " << port << "\n";
+		return 1;
+	}
+	std::cout << "Waiting for a coordinator on port " << port << "\n";
+
+	// The scene stays loaded between coordinators, as long as they send the same document
+	HeadlessApp app(64, 64);
+	std::string document;
+
+	while (true)
+	{
+		Socket socket = listener.Accept();
+		if (!socket.IsOpen() || !Handshake(socket)) continue;
+		std::cout << "Coordinator connected\n";
+
+		MessageType type;
+		std::vector<char> data;
+		while (ReceiveRenderMessage(socket, type, data, sizeof(JobHeader) + MAX_DOCUMENT_SIZE))
+		{
+			if (type != MESSAGE_JOB || data.size() < sizeof(JobHeader)) break;
+
+			JobHeader job;
+			std::memcpy(&job, data.data(), sizeof(job));
+			glm::ivec4 region(job.region[0], job.region[1], job.region[2], job.region[3]);
+
+			std::string error;
+			if (job.width <= 0 || job.height <= 0 || job.width > 16384 || job.height > 16384 || job.frames < 0 || region.x < 0 || region.y < 0 || region.z <= 0 || region.w <= 0 ||
+				region.x + region.z > job.width || region.y + region.w > job.height)
+			{
+				error = "invalid job";
+			}
+
+			std::string jobDocument(data.begin() + sizeof(JobHeader), data.end());
+			if (error.empty() && jobDocument != document)
+			{
+				// The coordinator may be on another machine, so it only gets to load files below the working directory
+				SceneDocument scene;
+				document.clear();
+				if (!SceneFile::Parse(jobDocument, scene, "scene")) error = "the scene could not be read";
+				else if (SceneFile::HasSafePaths(scene, error))
+				{
+					if (app.LoadSceneDocument(scene)) document = jobDocument;
+					else error = "the scene could not be loaded";
+				}
+			}
+
+			if (!error.empty())
+			{
+				SendRenderMessage(socket, MESSAGE_ERROR, error.data(), error.size());
+				continue;
+			}
+
+			std::vector<float> sums;
+			app.RenderRegion(job.width, job.height, region, job.sampleOffset, job.frames, sums);
+			std::cout << "Rendered " << job.frames << " frames of " << region.z << "x" << region.w << " at " << region.x << ", " << region.y << "\n";
+
+			if (!SendRenderMessage(socket, MESSAGE_RESULT, &job, sizeof(job), sums.data(), sums.size() * sizeof(float))) break;
+		}
+
+		std::cout << "Coordinator disconnected\n";
+	}
+}
\ No newline at end of file
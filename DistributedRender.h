@@ -0,0 +1,65 @@
+#pragma once
+#ifndef DISTRIBUTED_RENDER_CLASS_H
+#define DISTRIBUTED_RENDER_CLASS_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <glm/glm.hpp>
+#include "Socket.h"
+
+// A part of a frame: the pixels of a region, and the range of samples to take in it
+struct RenderUnit
+{
+	glm::ivec4 region;
+	unsigned int sampleOffset;
+	int frames;
+};
+
+// Splits a frame into units and renders them on worker processes over TCP, the sums and sample counts they send back are merged into the image.
+// A worker that disconnects, times out or fails is dropped, and its unit goes to another worker
+class RenderCoordinator
+{
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<RenderUnit> m_units;
+	// Units that have not been merged yet, including the ones being rendered
+	int m_unitsLeft = 0;
+	int m_workersAlive = 0;
+
+	std::string m_document;
+	int m_width = 0, m_height = 0;
+	// The merged sums and sample counts of the whole frame
+	std::vector<float> m_sums;
+
+	void WorkerLoop(const std::string& address);
+	// Takes the next unit, waits while other workers still have some that could come back. Returns false when every unit is done
+	bool TakeUnit(RenderUnit& unit);
+	void FinishUnit(const RenderUnit& unit, const std::vector<float>& sums);
+
+public:
+	// Where the workers listen, as "host:port"
+	std::vector<std::string> workers;
+	// Split the frame into square tiles of this size that take every sample, or into ranges of samples over the whole frame when it is 0
+	int tileSize = 0;
+	// How long a worker may take for a unit before it counts as dead
+	double timeout = 600.0;
+
+	// Renders the scene file on the workers and saves the merged image, the format follows the file extention
+	int Render(const std::string& sceneFile, int width, int height, int frames, const std::string& output);
+};
+
+// Serves a coordinator with the headless renderer, one connection at a time
+class RenderWorker
+{
+public:
+	// Only coordinators on this machine can connect unless set
+	bool remoteAccess = false;
+
+	// Only returns when the port can not be listened on
+	int Serve(int port);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "FileWatcher.h"
+#include <algorithm>
+
+FileWatcher::FileWatcher(int intervalMilliseconds) :
+	m_interval(intervalMilliseconds),
+	m_thread(&FileWatcher::WatchLoop, this)
+{}
+
+FileWatcher::~FileWatcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	m_thread.join();
+}
+
+void FileWatcher::Watch(const std::string& file)
+{
+	std::error_code error;
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(file, error);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = std::find_if(m_files.begin(), m_files.end(), [&](const WatchedFile& watched) { return watched.file == file; });
+	if (it != m_files.end()) return;
+
+	WatchedFile watched;
+	watched.file = file;
+	watched.writeTime = writeTime;
+	m_files.push_back(watched);
+}
+
+void FileWatcher::Unwatch(const std::string& file)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_files.erase(std::remove_if(m_files.begin(), m_files.end(), [&](const WatchedFile& watched) { return watched.file == file; }), m_files.end());
+}
+
+std::vector<std::string> FileWatcher::TakeChanged()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<std::string> changed;
+	changed.swap(m_changed);
+	return changed;
+}
+
+void FileWatcher::WatchLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_condition.wait_for(lock, m_interval, [this] { return m_stop; }))
+	{
+		for (WatchedFile& watched : m_files)
+		{
+			// A file that is being replaced might not exist for a moment, it is checked again next time
+			std::error_code error;
+			std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(watched.file, error);
+			if (error) continue;
+
+			if (!watched.changing)
+			{
+				if (writeTime == watched.writeTime) continue;
+
+				watched.changing = true;
+				watched.changingWriteTime = writeTime;
+				continue;
+			}
+
+			if (writeTime != watched.changingWriteTime)
+			{
+				// Still being written
+				watched.changingWriteTime = writeTime;
+				continue;
+			}
+
+			watched.changing = false;
+			watched.writeTime = writeTime;
+			if (std::find(m_changed.begin(), m_changed.end(), watched.file) == m_changed.end())
+			{
+				m_changed.push_back(watched.file);
+			}
+		}
+	}
+}
\ No newline at end of file
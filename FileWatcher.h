@@ -0,0 +1,48 @@
+#pragma once
+#ifndef FILE_WATCHER_CLASS_H
+#define FILE_WATCHER_CLASS_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Checks the modification times of files on a background thread and reports the ones that changed
+class FileWatcher
+{
+	struct WatchedFile
+	{
+		std::string file;
+		std::filesystem::file_time_type writeTime;
+		// Set when a new write time has been seen, it is only reported once it stayed the same for a whole interval.
+		// Exporters often write a file in several steps, this keeps a half written file from being loaded
+		bool changing = false;
+		std::filesystem::file_time_type changingWriteTime;
+	};
+
+	std::chrono::milliseconds m_interval;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<WatchedFile> m_files;
+	std::vector<std::string> m_changed;
+	bool m_stop = false;
+	// Declared last so it starts after everything it uses has been constructed
+	std::thread m_thread;
+
+	void WatchLoop();
+
+public:
+	FileWatcher(int intervalMilliseconds = 500);
+	~FileWatcher();
+
+	// Starts watching a file, does nothing if it is already watched
+	void Watch(const std::string& file);
+	void Unwatch(const std::string& file);
+	// The files that changed since the last call
+	std::vector<std::string> TakeChanged();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,458 @@
+#include "GltfLoader.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+#include <glm/gtx/euler_angles.hpp>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+
+// The accessor component types
+const int COMPONENT_UNSIGNED_BYTE = 5121;
+const int COMPONENT_UNSIGNED_SHORT = 5123;
+const int COMPONENT_UNSIGNED_INT = 5125;
+const int COMPONENT_FLOAT = 5126;
+
+// The primitive modes that are made of triangles
+const int MODE_TRIANGLES = 4;
+const int MODE_TRIANGLE_STRIP = 5;
+const int MODE_TRIANGLE_FAN = 6;
+
+static uint32_t ReadUint32(const unsigned char* data)
+{
+	// glTF is always little endian
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static size_t GetComponentSize(int componentType)
+{
+	switch (componentType)
+	{
+	case COMPONENT_UNSIGNED_BYTE: return 1;
+	case COMPONENT_UNSIGNED_SHORT: return 2;
+	case COMPONENT_UNSIGNED_INT: return 4;
+	case COMPONENT_FLOAT: return 4;
+	default: return 0;
+	}
+}
+
+// Reads a count, offset or length, which has to be a whole number that is not negative. A missing one is the fallback
+static bool ReadSize(const JsonValue& value, size_t fallback, size_t& size)
+{
+	if (value.IsNull())
+	{
+		size = fallback;
+		return true;
+	}
+
+	double number = value.AsNumber(-1.0);
+	if (!value.IsNumber() || number < 0.0 || number != std::floor(number) || number >= 9007199254740992.0) return false;
+
+	size = (size_t)number;
+	return true;
+}
+
+bool GltfLoader::Load(const char* file, std::vector<Mesh>& meshes, std::vector<std::string>& names)
+{
+	TRACE_SCOPE("GltfLoader::Load", file);
+
+	m_file = file;
+	m_geometries.clear();
+
+	if (!m_mappedFile.Open(file))
+	{
+		std::cout << "Failed to open: " << file << "\n";
+		return false;
+	}
+
+	try
+	{
+		if (!LoadChunks()) return false;
+	}
+	catch (const std::string& error)
+	{
+		std::cout << file << ": " << error << "\n";
+		return false;
+	}
+
+	// Compressed or quantized geometry can not be read straight from the file
+	for (const JsonValue& extension : m_document["extensionsRequired"].array)
+	{
+		std::cout << file << ": unsupported required extension " << extension.AsString() << "\n";
+		return false;
+	}
+
+	// Load every primitive once, the nodes only reference them
+	const JsonValue& gltfMeshes = m_document["meshes"];
+	m_geometries.resize(gltfMeshes.Size());
+	for (int meshIndex = 0; meshIndex < (int)gltfMeshes.Size(); meshIndex++)
+	{
+		const JsonValue& primitives = gltfMeshes[meshIndex]["primitives"];
+		for (int primitiveIndex = 0; primitiveIndex < (int)primitives.Size(); primitiveIndex++)
+		{
+			m_geometries[meshIndex].push_back(LoadPrimitive(primitives[primitiveIndex], meshIndex, primitiveIndex));
+		}
+	}
+
+	// Walk the node tree of the default scene, or every root node when the file has no scenes
+	const JsonValue& scene = m_document["scenes"][m_document["scene"].AsInt(0)];
+	if (!scene.IsNull())
+	{
+		for (const JsonValue& node : scene["nodes"].array)
+		{
+			LoadNode(node.AsInt(-1), glm::mat4(1.0f), 0, meshes, names);
+		}
+	}
+	else
+	{
+		std::vector<bool> isChild(m_document["nodes"].Size(), false);
+		for (const JsonValue& node : m_document["nodes"].array)
+		{
+			for (const JsonValue& child : node["children"].array)
+			{
+				int childIndex = child.AsInt(-1);
+				if (childIndex >= 0 && childIndex < (int)isChild.size()) isChild[childIndex] = true;
+			}
+		}
+
+		for (int i = 0; i < (int)isChild.size(); i++)
+		{
+			if (!isChild[i]) LoadNode(i, glm::mat4(1.0f), 0, meshes, names);
+		}
+	}
+
+	m_mappedFile.Close();
+	m_binary = nullptr;
+	m_binarySize = 0;
+
+	if (meshes.empty())
+	{
+		std::cout << file << ": no triangle meshes\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool GltfLoader::LoadChunks()
+{
+	const unsigned char* data = m_mappedFile.GetData();
+	size_t size = m_mappedFile.GetSize();
+
+	// The header is the magic, version and total length, followed by the JSON chunk
+	if (size < 20 || std::memcmp(data, "glTF", 4) != 0)
+	{
+		std::cout << m_file << ": not a binary glTF file\n";
+		return false;
+	}
+	if (ReadUint32(data + 4) != 2)
+	{
+		std::cout << m_file << ": only glTF 2.0 is supported\n";
+		return false;
+	}
+	size = std::min(size, (size_t)ReadUint32(data + 8));
+
+	size_t offset = 12;
+	bool hasJSON = false;
+	while (offset + 8 <= size)
+	{
+		size_t chunkSize = ReadUint32(data + offset);
+		uint32_t chunkType = ReadUint32(data + offset + 4);
+		offset += 8;
+
+		if (chunkSize > size - offset)
+		{
+			std::cout << m_file << ": chunk is larger than the file\n";
+			return false;
+		}
+
+		// "JSON" and "BIN\0"
+		if (chunkType == 0x4E4F534A && !hasJSON)
+		{
+			m_document = JsonValue::Parse((const char*)data + offset, chunkSize);
+			hasJSON = true;
+		}
+		else if (chunkType == 0x004E4942 && !m_binary)
+		{
+			m_binary = data + offset;
+			m_binarySize = chunkSize;
+		}
+
+		// Chunks are padded to 4 bytes
+		offset += (chunkSize + 3) & ~(size_t)3;
+	}
+
+	if (!hasJSON)
+	{
+		std::cout << m_file << ": no JSON chunk\n";
+		return false;
+	}
+	return true;
+}
+
+bool GltfLoader::GetAccessor(int index, const char* type, const unsigned char*& data, size_t& stride, size_t& count, int& componentType) const
+{
+	const JsonValue& accessor = m_document["accessors"][index];
+	if (accessor.IsNull() || accessor["type"].AsString() != type) return false;
+	if (!accessor["sparse"].IsNull()) return false;
+
+	const JsonValue& bufferView = m_document["bufferViews"][accessor["bufferView"].AsInt(-1)];
+	if (bufferView.IsNull()) return false;
+
+	// Only the binary chunk of the file itself, external and embedded buffers are not supported
+	int bufferIndex = bufferView["buffer"].AsInt(-1);
+	if (bufferIndex != 0 || !m_document["buffers"][0]["uri"].IsNull() || !m_binary) return false;
+
+	componentType = accessor["componentType"].AsInt();
+	size_t components = std::strcmp(type, "VEC3") == 0 ? 3 : 1;
+	size_t elementSize = GetComponentSize(componentType) * components;
+	if (elementSize == 0) return false;
+
+	// The numbers come straight from the file, so none of them can be trusted to be sensible
+	size_t viewOffset, viewLength, accessorOffset;
+	if (!ReadSize(accessor["count"], 0, count) || accessor["count"].IsNull()) return false;
+	if (!ReadSize(bufferView["byteStride"], elementSize, stride) || stride < elementSize) return false;
+	if (!ReadSize(bufferView["byteOffset"], 0, viewOffset) || !ReadSize(bufferView["byteLength"], 0, viewLength) || !ReadSize(accessor["byteOffset"], 0, accessorOffset)) return false;
+	if (viewOffset > m_binarySize || viewLength > m_binarySize - viewOffset) return false;
+
+	// The last element has to end inside of the buffer view, divided instead of multiplied so a huge count can not overflow
+	if (count > 0)
+	{
+		if (accessorOffset > viewLength || elementSize > viewLength - accessorOffset) return false;
+		if (count - 1 > (viewLength - accessorOffset - elementSize) / stride) return false;
+	}
+
+	data = m_binary + viewOffset + accessorOffset;
+	return true;
+}
+
+std::shared_ptr<Geometry> GltfLoader::LoadPrimitive(const JsonValue& primitive, int meshIndex, int primitiveIndex) const
+{
+	int mode = primitive["mode"].AsInt(MODE_TRIANGLES);
+	if (mode != MODE_TRIANGLES && mode != MODE_TRIANGLE_STRIP && mode != MODE_TRIANGLE_FAN) return nullptr;
+
+	const unsigned char* positions;
+	size_t positionStride, vertexCount;
+	int positionType;
+	if (!GetAccessor(primitive["attributes"]["POSITION"].AsInt(-1), "VEC3", positions, positionStride, vertexCount, positionType) || positionType != COMPONENT_FLOAT)
+	{
+		std::cout << m_file << ": mesh " << meshIndex << " has positions that can not be read\n";
+		return nullptr;
+	}
+
+	std::shared_ptr<Geometry> geometry = std::make_shared<Geometry>();
+	// Every primitive is its own geometry in the library
+	geometry->file = m_file + "#" + std::to_string(meshIndex) + "." + std::to_string(primitiveIndex);
+
+	// Straight from the mapped file into the vertices, in one go when they are tightly packed
+	geometry->vertices.resize(vertexCount);
+	if (positionStride == sizeof(glm::vec3))
+	{
+		std::memcpy(geometry->vertices.data(), positions, vertexCount * sizeof(glm::vec3));
+	}
+	else
+	{
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			std::memcpy(&geometry->vertices[i], positions + i * positionStride, sizeof(glm::vec3));
+		}
+	}
+
+	// The vertex index of every corner, without an index accessor the vertices are used in order
+	std::vector<uint32_t> corners;
+	const unsigned char* indexData = nullptr;
+	size_t indexStride = 0, indexCount = vertexCount;
+	int indexType = COMPONENT_UNSIGNED_INT;
+	if (!primitive["indices"].IsNull())
+	{
+		if (!GetAccessor(primitive["indices"].AsInt(-1), "SCALAR", indexData, indexStride, indexCount, indexType) || indexType == COMPONENT_FLOAT)
+		{
+			std::cout << m_file << ": mesh " << meshIndex << " has indices that can not be read\n";
+			return nullptr;
+		}
+	}
+
+	auto getCorner = [&](size_t i) -> uint32_t
+	{
+		if (!indexData) return (uint32_t)i;
+
+		const unsigned char* index = indexData + i * indexStride;
+		switch (indexType)
+		{
+		case COMPONENT_UNSIGNED_BYTE: return *index;
+		case COMPONENT_UNSIGNED_SHORT: return (uint32_t)index[0] | ((uint32_t)index[1] << 8);
+		default: return ReadUint32(index);
+		}
+	};
+
+	if (mode == MODE_TRIANGLES)
+	{
+		size_t triangleCount = indexCount / 3;
+		geometry->indices.resize(triangleCount);
+
+		if (indexData && indexType == COMPONENT_UNSIGNED_INT && indexStride == sizeof(uint32_t))
+		{
+			// Already in the layout of the indices
+			std::memcpy(geometry->indices.data(), indexData, triangleCount * sizeof(glm::uvec3));
+		}
+		else
+		{
+			for (size_t i = 0; i < triangleCount; i++)
+			{
+				geometry->indices[i] = glm::uvec3(getCorner(i * 3), getCorner(i * 3 + 1), getCorner(i * 3 + 2));
+			}
+		}
+	}
+	else
+	{
+		for (size_t i = 2; i < indexCount; i++)
+		{
+			if (mode == MODE_TRIANGLE_FAN)
+			{
+				geometry->indices.push_back(glm::uvec3(getCorner(0), getCorner(i - 1), getCorner(i)));
+			}
+			else
+			{
+				// Every other triangle of a strip is flipped to keep the winding the same
+				if (i % 2 == 0) geometry->indices.push_back(glm::uvec3(getCorner(i - 2), getCorner(i - 1), getCorner(i)));
+				else geometry->indices.push_back(glm::uvec3(getCorner(i - 1), getCorner(i - 2), getCorner(i)));
+			}
+		}
+	}
+
+	// An index outside of the vertices would read outside of the buffers on the GPU
+	for (const glm::uvec3& triangle : geometry->indices)
+	{
+		if (triangle.x >= vertexCount || triangle.y >= vertexCount || triangle.z >= vertexCount)
+		{
+			std::cout << m_file << ": mesh " << meshIndex << " has indices outside of its vertices\n";
+			return nullptr;
+		}
+	}
+
+	if (geometry->indices.empty()) return nullptr;
+	return geometry;
+}
+
+Material GltfLoader::LoadMaterial(int index) const
+{
+	// The same material as a mesh from an .obj file gets, for primitives without one
+	Material material({ 0.9f, 0.9f, 0.9f }, 0.8f, 0.0f, 0.5f, 1.0f, 1.5f, 1.0f);
+
+	const JsonValue& gltfMaterial = m_document["materials"][index];
+	if (gltfMaterial.IsNull()) return material;
+
+	const JsonValue& pbr = gltfMaterial["pbrMetallicRoughness"];
+	const JsonValue& extensions = gltfMaterial["extensions"];
+
+	const JsonValue& baseColor = pbr["baseColorFactor"];
+	glm::vec3 color((float)baseColor[0].AsNumber(1.0), (float)baseColor[1].AsNumber(1.0), (float)baseColor[2].AsNumber(1.0));
+	float metallic = (float)pbr["metallicFactor"].AsNumber(1.0);
+	float roughness = (float)pbr["roughnessFactor"].AsNumber(1.0);
+	float transmission = (float)extensions["KHR_materials_transmission"]["transmissionFactor"].AsNumber(0.0);
+	float ior = (float)extensions["KHR_materials_ior"]["ior"].AsNumber(1.5);
+
+	// Every reflection is tinted by the color here, which only metals do. Without a diffuse and specular layer the closest
+	// match for a dielectric is a diffuse surface, so the less metallic a surface is the rougher it gets, unless light goes through it
+	float reflectedRoughness = metallic * roughness + (1.0f - metallic);
+	roughness = transmission * roughness + (1.0f - transmission) * reflectedRoughness;
+
+	material = Material(color, roughness, 0.0f, 0.5f, 1.0f, ior, 1.0f - transmission);
+
+	// The absorption over a distance, stored so that exp(-absorbColor * absorbsionStrength * distance) gives the attenuation color at the attenuation distance
+	const JsonValue& volume = extensions["KHR_materials_volume"];
+	if (!volume.IsNull())
+	{
+		const JsonValue& attenuation = volume["attenuationColor"];
+		float distance = (float)volume["attenuationDistance"].AsNumber(0.0);
+		for (int i = 0; i < 3; i++)
+		{
+			material.absorbColor[i] = -std::log(std::max((float)attenuation[i].AsNumber(1.0), 0.0001f));
+		}
+		material.absorbsionStrength = distance > 0.0f ? 1.0f / distance : 0.0f;
+	}
+
+	const JsonValue& emissive = gltfMaterial["emissiveFactor"];
+	glm::vec3 emissionColor((float)emissive[0].AsNumber(0.0), (float)emissive[1].AsNumber(0.0), (float)emissive[2].AsNumber(0.0));
+	if (emissionColor != glm::vec3(0.0f))
+	{
+		material.emissionColor = emissionColor;
+		material.emissionStrength = (float)extensions["KHR_materials_emissive_strength"]["emissiveStrength"].AsNumber(1.0);
+		// Emit from the whole front side
+		material.emissionScatteringIndex = 1.0f;
+	}
+
+	return material;
+}
+
+void GltfLoader::LoadNode(int index, const glm::mat4& parentMatrix, int depth, std::vector<Mesh>& meshes, std::vector<std::string>& names) const
+{
+	const JsonValue& node = m_document["nodes"][index];
+	// A cycle in the tree would never end
+	if (node.IsNull() || depth > 256) return;
+
+	glm::mat4 localMatrix(1.0f);
+	const JsonValue& matrix = node["matrix"];
+	if (matrix.Size() == 16)
+	{
+		// Column major, just like glm
+		for (int i = 0; i < 16; i++)
+		{
+			glm::value_ptr(localMatrix)[i] = (float)matrix[i].AsNumber();
+		}
+	}
+	else
+	{
+		const JsonValue& translation = node["translation"];
+		const JsonValue& rotation = node["rotation"];
+		const JsonValue& scale = node["scale"];
+
+		glm::vec3 position((float)translation[0].AsNumber(0.0), (float)translation[1].AsNumber(0.0), (float)translation[2].AsNumber(0.0));
+		// Stored as x, y, z, w
+		glm::quat orientation((float)rotation[3].AsNumber(1.0), (float)rotation[0].AsNumber(0.0), (float)rotation[1].AsNumber(0.0), (float)rotation[2].AsNumber(0.0));
+		glm::vec3 size((float)scale[0].AsNumber(1.0), (float)scale[1].AsNumber(1.0), (float)scale[2].AsNumber(1.0));
+
+		localMatrix = glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(orientation) * glm::scale(glm::mat4(1.0f), size);
+	}
+	glm::mat4 worldMatrix = parentMatrix * localMatrix;
+
+	int meshIndex = node["mesh"].AsInt(-1);
+	if (meshIndex >= 0 && meshIndex < (int)m_geometries.size())
+	{
+		// A mesh only has a position, rotation and scale, so any shear of the node tree is lost
+		glm::vec3 scale, position, skew;
+		glm::quat orientation;
+		glm::vec4 perspective;
+		glm::decompose(worldMatrix, scale, orientation, position, skew, perspective);
+
+		// The mesh rotation is yaw around y, then pitch around x, then roll around z
+		float yaw, pitch, roll;
+		glm::extractEulerAngleYXZ(glm::mat4_cast(orientation), yaw, pitch, roll);
+
+		const JsonValue& primitives = m_document["meshes"][meshIndex]["primitives"];
+		std::string name = node["name"].AsString();
+		if (name.empty()) name = m_document["meshes"][meshIndex]["name"].AsString();
+		if (name.empty()) name = "Mesh";
+
+		for (int i = 0; i < (int)m_geometries[meshIndex].size(); i++)
+		{
+			if (!m_geometries[meshIndex][i]) continue;
+
+			Mesh mesh;
+			mesh.geometry = m_geometries[meshIndex][i];
+			mesh.position = position;
+			mesh.rotation = glm::vec3(pitch, yaw, roll);
+			mesh.scale = scale;
+			mesh.material = LoadMaterial(primitives[i]["material"].AsInt(-1));
+			mesh.UpdateTransformMatrix();
+
+			meshes.push_back(mesh);
+			names.push_back(m_geometries[meshIndex].size() > 1 ? name + "." + std::to_string(i) : name);
+		}
+	}
+
+	for (const JsonValue& child : node["children"].array)
+	{
+		LoadNode(child.AsInt(-1), worldMatrix, depth + 1, meshes, names);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef GLTF_LOADER_CLASS_H
+#define GLTF_LOADER_CLASS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "Json.h"
+#include "MappedFile.h"
+#include "Objects.h"
+
+// Loads the meshes of a binary glTF 2.0 (.glb) file with their node transforms and materials.
+// The file is memory mapped and the positions and indices are read from it straight into the geometry
+class GltfLoader
+{
+	std::string m_file;
+	MappedFile m_mappedFile;
+	JsonValue m_document;
+	// The binary chunk of the file
+	const unsigned char* m_binary = nullptr;
+	size_t m_binarySize = 0;
+
+	// The geometry of every primitive by mesh and primitive index, shared by every node that uses the mesh
+	std::vector<std::vector<std::shared_ptr<Geometry>>> m_geometries;
+
+	bool LoadChunks();
+	// Finds the data of an accessor in the binary chunk, returns false when it does not fit in there or is stored in a way that is not supported
+	bool GetAccessor(int index, const char* type, const unsigned char*& data, size_t& stride, size_t& count, int& componentType) const;
+	std::shared_ptr<Geometry> LoadPrimitive(const JsonValue& primitive, int meshIndex, int primitiveIndex) const;
+	Material LoadMaterial(int index) const;
+	void LoadNode(int index, const glm::mat4& parentMatrix, int depth, std::vector<Mesh>& meshes, std::vector<std::string>& names) const;
+
+public:
+	// Every primitive of every node with a mesh becomes a Mesh, named after its node
+	bool Load(const char* file, std::vector<Mesh>& meshes, std::vector<std::string>& names);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "HeadlessApp.h"
+
+HeadlessApp::HeadlessApp(int width, int height) :
+	m_width(width),
+	m_height(height)
+{
+	// Create a context without a window and load OpenGL
+	m_context.CreateHeadless();
+	std::cout << "OpenGL " << glGetString(GL_VERSION) << " on " << glGetString(GL_RENDERER) << "\n";
+
+	// Initialize the renderer class
+	m_renderer.Initialize(m_width, m_height, true);
+	// The same anti-aliasing as the window uses
+	m_renderer.blur = 1.1f / (float)m_height;
+	// Set the raytracing settings
+	m_renderer.UploadRaytraceSettings();
+
+	// Initialize the scene class
+	m_scene.Initialize();
+	// Load the scene
+	LoadScene();
+}
+
+HeadlessApp::~HeadlessApp()
+{
+	m_renderer.Uninitialize();
+	m_scene.Uninitialize();
+
+	m_context.Destroy();
+}
+
+void HeadlessApp::LoadScene()
+{
+	m_skyboxFile = "skyboxes/Powder blue sky.jpg";
+	m_scene.skybox.LoadFromFile(m_skyboxFile.c_str());
+	m_scene.camera.position = { 0.0f,5.0f,-10.0f };
+	m_scene.camera.rotation = { 0.6f,0.0f,0.0f };
+
+	// Upload the objects to the shader
+	m_renderer.UploadObjects(m_scene);
+}
+
+bool HeadlessApp::LoadSceneFile(const std::string& file)
+{
+	SceneDocument document;
+	return SceneFile::Load(file, document) && LoadSceneDocument(document);
+}
+
+bool HeadlessApp::LoadSceneDocument(const SceneDocument& document)
+{
+	TRACE_SCOPE("HeadlessApp::LoadSceneDocument");
+
+	m_scene.spheres.clear();
+	m_scene.meshes.clear();
+
+	m_scene.camera.position = document.cameraPosition;
+	m_scene.camera.rotation = document.cameraRotation;
+	m_renderer.maxBounces = document.maxBounces;
+	m_renderer.samplesPerPixel = document.samplesPerPixel;
+	m_renderer.perspectiveSlope = document.perspectiveSlope;
+	m_renderer.focalDistance = document.focalDistance;
+	m_renderer.focalBlur = document.focalBlur;
+	m_scene.triangleStorage = document.triangleStorage;
+
+	for (const SceneSphere& sphere : document.spheres)
+	{
+		m_scene.spheres.push_back(sphere.sphere);
+	}
+	if (!document.skybox.empty() && document.skybox != m_skyboxFile)
+	{
+		m_skyboxFile = document.skybox;
+		m_scene.skybox.LoadFromFile(m_skyboxFile.c_str());
+	}
+
+	// Nothing to show in the meantime, but the files still import in parallel
+	Importer importer;
+	std::vector<std::string> imports;
+	std::vector<SceneMeshReference> pending;
+	for (const SceneMeshReference& reference : document.meshes)
+	{
+		pending.push_back(reference);
+		pending.back().mesh.geometry = m_scene.FindGeometry(reference.file.c_str());
+		if (pending.back().mesh.geometry) continue;
+
+		std::string importFile = SceneFile::GetImportFile(reference.file);
+		if (std::find(imports.begin(), imports.end(), importFile) == imports.end())
+		{
+			imports.push_back(importFile);
+			importer.Import(importFile);
+		}
+	}
+
+	while (importer.IsBusy())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		for (const ImportResult& result : importer.TakeFinished())
+		{
+			for (SceneMeshReference& reference : pending)
+			{
+				if (!reference.mesh.geometry) reference.mesh.geometry = SceneFile::FindImportedGeometry(result, reference.file);
+			}
+		}
+	}
+
+	// Keep the order of the document, so every render node ends up with the same scene
+	bool complete = true;
+	for (const SceneMeshReference& reference : pending)
+	{
+		if (!reference.mesh.geometry)
+		{
+			std::cout << "Missing geometry for " << reference.name << ": " << reference.file << "\n";
+			complete = false;
+			continue;
+		}
+		m_scene.AddMesh(reference.mesh);
+	}
+
+	m_renderer.UploadRaytraceSettings();
+	m_renderer.UploadObjects(m_scene);
+	return complete;
+}
+
+void HeadlessApp::RenderRegion(int width, int height, const glm::ivec4& region, unsigned int sampleOffset, int frames, std::vector<float>& sums)
+{
+	TRACE_SCOPE("HeadlessApp::RenderRegion");
+
+	SetResolution(width, height);
+
+	m_renderer.region = region;
+	m_renderer.sampleOffset = sampleOffset;
+
+	// Start over, the frames of the last region are not part of this one
+	bool sceneChanged = true;
+	m_renderer.UploadCameraView(m_scene);
+	for (int i = 0; i < frames; i++)
+	{
+		m_renderer.Render(m_scene, sceneChanged);
+	}
+
+	m_renderer.GetAccumulatedSums(region.x, region.y, region.z, region.w, sums);
+	m_renderer.region = glm::ivec4(0);
+}
+
+void HeadlessApp::SetResolution(int width, int height)
+{
+	if (width == m_width && height == m_height) return;
+
+	m_width = width;
+	m_height = height;
+	m_renderer.SetViewportResolution(m_width, m_height);
+	m_renderer.blur = 1.1f / (float)m_height;
+	m_renderer.UploadRaytraceSettings();
+}
+
+void HeadlessApp::SetCamera(const glm::vec3& position, const glm::vec3& rotation)
+{
+	m_scene.camera.position = position;
+	m_scene.camera.rotation = rotation;
+}
+
+void HeadlessApp::RenderFrames(int frames, bool restart)
+{
+	TRACE_SCOPE("HeadlessApp::RenderFrames");
+
+	bool sceneChanged = restart;
+	if (restart)
+	{
+		// Whatever a region render left behind does not belong to the whole image
+		m_renderer.region = glm::ivec4(0);
+		m_renderer.sampleOffset = 0;
+		m_renderer.UploadCameraView(m_scene);
+	}
+
+	for (int i = 0; i < frames; i++)
+	{
+		m_renderer.Render(m_scene, sceneChanged);
+	}
+	glFinish();
+}
+
+std::vector<float> HeadlessApp::GetFrame(int& width, int& height)
+{
+	return m_renderer.GetCurrentFrame(width, height);
+}
+
+int HeadlessApp::Render(int frames, const std::string& file)
+{
+	ImageFormat format = ImageWriter::GetFormat(file);
+
+	bool sceneChanged = true;
+	m_renderer.UploadCameraView(m_scene);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (int i = 0; i < frames; i++)
+	{
+		m_renderer.Render(m_scene, sceneChanged);
+	}
+	glFinish();
+
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "Rendered " << frames << " frames in " << seconds << "s, " << seconds / frames * 1000.0 << "ms per frame\n";
+
+	// Nothing else is going on, so the blocking download is fine here
+	int width, height;
+	std::vector<float> frame = m_renderer.GetCurrentFrame(width, height);
+	m_imageWriter.Write(file, format, width, height, std::move(frame));
+
+	return 0;
+}
\ No newline at end of file
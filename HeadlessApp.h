@@ -0,0 +1,49 @@
+#pragma once
+#ifndef HEADLESS_APP_CLASS_H
+#define HEADLESS_APP_CLASS_H
+
+#include <chrono>
+#include <filesystem>
+#include "Context.h"
+#include "ImageWriter.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "SceneFile.h"
+
+// Renders without a window, for render nodes and automated runs
+class HeadlessApp
+{
+public:
+	HeadlessApp(int width, int height);
+	~HeadlessApp();
+
+	// Accumulate the given amount of frames and save the result, the format follows the file extention
+	int Render(int frames, const std::string& file);
+	// Replaces the default scene with a saved one, and waits until all of its meshes are loaded
+	bool LoadSceneFile(const std::string& file);
+	bool LoadSceneDocument(const SceneDocument& document);
+	// Accumulates frames in a region of an image of the given size, starting at a sample offset, and gets the sums and sample counts of that region
+	void RenderRegion(int width, int height, const glm::ivec4& region, unsigned int sampleOffset, int frames, std::vector<float>& sums);
+
+	// Renders at another resolution from now on
+	void SetResolution(int width, int height);
+	void SetCamera(const glm::vec3& position, const glm::vec3& rotation);
+	// Accumulates the given amount of frames of the whole image, starting over when restart is set. Waits for the GPU to finish them
+	void RenderFrames(int frames, bool restart);
+	// The average color of every pixel accumulated so far, with the bottom row first
+	std::vector<float> GetFrame(int& width, int& height);
+
+private:
+	int m_width, m_height;
+	Context m_context;
+	Renderer m_renderer;
+	Scene m_scene;
+	ImageWriter m_imageWriter;
+	// The skybox that is loaded, it is only loaded again when a document has another one
+	std::string m_skyboxFile;
+
+	// Load the default scene
+	void LoadScene();
+};
+
+#endif
\ No newline at end of file
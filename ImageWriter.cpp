@@ -0,0 +1,327 @@
+#include "ImageWriter.h"
+#include <stb/stb_image_write.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+
+// Part of stb_image_write, but not declared in its header
+extern "C" unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
+
+ImageWriter::ImageWriter() :
+	m_thread(&ImageWriter::WorkerLoop, this)
+{}
+
+ImageWriter::~ImageWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	m_thread.join();
+}
+
+const char* ImageWriter::GetExtention(ImageFormat format)
+{
+	switch (format)
+	{
+	case FORMAT_JPG: return ".jpg";
+	case FORMAT_PNG16: return ".png";
+	case FORMAT_PFM: return ".pfm";
+	case FORMAT_EXR: return ".exr";
+	default: return "";
+	}
+}
+
+ImageFormat ImageWriter::GetFormat(const std::string& file)
+{
+	// Anything unknown is saved as a jpg
+	std::string extention = std::filesystem::path(file).extension().string();
+	for (ImageFormat format : { FORMAT_JPG, FORMAT_PNG16, FORMAT_PFM, FORMAT_EXR })
+	{
+		if (extention == GetExtention(format)) return format;
+	}
+	return FORMAT_JPG;
+}
+
+void ImageWriter::Write(const std::string& file, ImageFormat format, int width, int height, std::vector<float>&& pixels)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back({ file, format, width, height, std::move(pixels) });
+	}
+	m_condition.notify_one();
+}
+
+bool ImageWriter::WriteNow(const std::string& file, ImageFormat format, int width, int height, std::vector<float>&& pixels)
+{
+	return Encode({ file, format, width, height, std::move(pixels) });
+}
+
+std::vector<unsigned char> ImageWriter::EncodeJPG(int width, int height, std::vector<float>&& pixels, int quality)
+{
+	std::vector<unsigned char> frame = Quantize({ "", FORMAT_JPG, width, height, std::move(pixels) });
+
+	std::vector<unsigned char> data;
+	auto append = [](void* context, void* bytes, int size)
+	{
+		std::vector<unsigned char>& data = *(std::vector<unsigned char>*)context;
+		data.insert(data.end(), (unsigned char*)bytes, (unsigned char*)bytes + size);
+	};
+
+	// Every caller sets the same flip, so it does not matter which thread set it last
+	stbi_flip_vertically_on_write(1);
+	if (!stbi_write_jpg_to_func(append, &data, width, height, 3, frame.data(), quality)) data.clear();
+	return data;
+}
+
+int ImageWriter::GetQueueSize()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (int)m_jobs.size();
+}
+
+void ImageWriter::WorkerLoop()
+{
+	while (true)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+
+			// Only stop once every queued image is saved
+			if (m_jobs.empty()) return;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		if (Encode(job))
+		{
+			std::cout << "Saved frame: " << job.file << "\n";
+		}
+		else
+		{
+			std::cout << "Failed to save frame: " << job.file << "\n";
+		}
+	}
+}
+
+bool ImageWriter::Encode(const Job& job)
+{
+	switch (job.format)
+	{
+	case FORMAT_JPG: return WriteJPG(job);
+	case FORMAT_PNG16: return WritePNG16(job);
+	case FORMAT_PFM: return WritePFM(job);
+	case FORMAT_EXR: return WriteEXR(job);
+	default: return false;
+	}
+}
+
+std::vector<unsigned char> ImageWriter::Quantize(const Job& job)
+{
+	std::vector<unsigned char> frame(job.width * job.height * 3, 0);
+
+	for (int i = 0; i < job.width * job.height * 3; i++)
+	{
+		frame[i] = (unsigned char)std::max(0.0f, std::min(255.0f, job.pixels[i] * 255.0f));
+	}
+	return frame;
+}
+
+bool ImageWriter::WriteJPG(const Job& job)
+{
+	std::vector<unsigned char> frame = Quantize(job);
+
+	// Every caller sets the same flip, so it does not matter which thread set it last
+	stbi_flip_vertically_on_write(1);
+	return stbi_write_jpg(job.file.c_str(), job.width, job.height, 3, frame.data(), 100);
+}
+
+static uint32_t Crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+{
+	static uint32_t table[256];
+	static bool tableReady = false;
+	if (!tableReady)
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+		tableReady = true;
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void WritePNGChunk(std::ofstream& out, const char* type, const unsigned char* data, uint32_t size)
+{
+	unsigned char header[8] = { (unsigned char)(size >> 24), (unsigned char)(size >> 16), (unsigned char)(size >> 8), (unsigned char)size };
+	std::memcpy(header + 4, type, 4);
+
+	uint32_t crc = Crc32(header + 4, 4);
+	crc = Crc32(data, size, crc);
+	unsigned char footer[4] = { (unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc };
+
+	out.write((const char*)header, 8);
+	out.write((const char*)data, size);
+	out.write((const char*)footer, 4);
+}
+
+bool ImageWriter::WritePNG16(const Job& job)
+{
+	// stb_image_write only writes 8 bit PNGs, so build the file here and only use its zlib compression
+	int rowSize = 1 + job.width * 3 * 2;
+	std::vector<unsigned char> rows(rowSize * job.height);
+
+	for (int y = 0; y < job.height; y++)
+	{
+		// PNG starts at the top row
+		const float* source = &job.pixels[(job.height - 1 - y) * job.width * 3];
+		unsigned char* row = &rows[y * rowSize];
+
+		// No filter
+		row[0] = 0;
+		for (int i = 0; i < job.width * 3; i++)
+		{
+			uint16_t value = (uint16_t)(std::max(0.0f, std::min(1.0f, source[i])) * 65535.0f + 0.5f);
+			row[1 + i * 2] = (unsigned char)(value >> 8);
+			row[2 + i * 2] = (unsigned char)value;
+		}
+	}
+
+	int compressedSize = 0;
+	unsigned char* compressed = stbi_zlib_compress(rows.data(), (int)rows.size(), &compressedSize, 8);
+	if (!compressed) return false;
+
+	std::ofstream out(job.file, std::ios::binary);
+	if (!out.is_open())
+	{
+		free(compressed);
+		return false;
+	}
+
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	out.write((const char*)signature, 8);
+
+	// Width, height, 16 bit depth, RGB, default compression, filter and interlace
+	unsigned char header[13] = {
+		(unsigned char)(job.width >> 24), (unsigned char)(job.width >> 16), (unsigned char)(job.width >> 8), (unsigned char)job.width,
+		(unsigned char)(job.height >> 24), (unsigned char)(job.height >> 16), (unsigned char)(job.height >> 8), (unsigned char)job.height,
+		16, 2, 0, 0, 0 };
+	WritePNGChunk(out, "IHDR", header, 13);
+	WritePNGChunk(out, "IDAT", compressed, compressedSize);
+	WritePNGChunk(out, "IEND", nullptr, 0);
+
+	free(compressed);
+	return out.good();
+}
+
+bool ImageWriter::WritePFM(const Job& job)
+{
+	std::ofstream out(job.file, std::ios::binary);
+	if (!out.is_open()) return false;
+
+	// A negative scale means little endian, and the rows are stored bottom to top just like OpenGL returns them
+	out << "PF\n" << job.width << " " << job.height << "\n-1.0\n";
+	out.write((const char*)job.pixels.data(), job.pixels.size() * sizeof(float));
+
+	return out.good();
+}
+
+static void WriteEXRAttribute(std::vector<char>& header, const char* name, const char* type, const void* data, int32_t size)
+{
+	header.insert(header.end(), name, name + std::strlen(name) + 1);
+	header.insert(header.end(), type, type + std::strlen(type) + 1);
+	header.insert(header.end(), (const char*)&size, (const char*)&size + 4);
+	header.insert(header.end(), (const char*)data, (const char*)data + size);
+}
+
+bool ImageWriter::WriteEXR(const Job& job)
+{
+	// An uncompressed scanline OpenEXR file with 32 bit float channels, every value is little endian
+	std::vector<char> header;
+
+	const uint32_t magic = 20000630;
+	const uint32_t version = 2;
+	header.insert(header.end(), (const char*)&magic, (const char*)&magic + 4);
+	header.insert(header.end(), (const char*)&version, (const char*)&version + 4);
+
+	// The channels have to be sorted by name
+	std::vector<char> channels;
+	for (const char* channel : { "B", "G", "R" })
+	{
+		// Name, pixel type float, pLinear and reserved bytes, x and y sampling
+		const int32_t pixelType = 2;
+		const unsigned char linear[4] = { 0, 0, 0, 0 };
+		const int32_t sampling[2] = { 1, 1 };
+		channels.insert(channels.end(), channel, channel + 2);
+		channels.insert(channels.end(), (const char*)&pixelType, (const char*)&pixelType + 4);
+		channels.insert(channels.end(), (const char*)linear, (const char*)linear + 4);
+		channels.insert(channels.end(), (const char*)sampling, (const char*)sampling + 8);
+	}
+	channels.push_back(0);
+
+	const unsigned char compression = 0;
+	const int32_t window[4] = { 0, 0, job.width - 1, job.height - 1 };
+	const unsigned char lineOrder = 0;
+	const float pixelAspectRatio = 1.0f;
+	const float screenWindowCenter[2] = { 0.0f, 0.0f };
+	const float screenWindowWidth = 1.0f;
+
+	WriteEXRAttribute(header, "channels", "chlist", channels.data(), (int32_t)channels.size());
+	WriteEXRAttribute(header, "compression", "compression", &compression, 1);
+	WriteEXRAttribute(header, "dataWindow", "box2i", window, 16);
+	WriteEXRAttribute(header, "displayWindow", "box2i", window, 16);
+	WriteEXRAttribute(header, "lineOrder", "lineOrder", &lineOrder, 1);
+	WriteEXRAttribute(header, "pixelAspectRatio", "float", &pixelAspectRatio, 4);
+	WriteEXRAttribute(header, "screenWindowCenter", "v2f", screenWindowCenter, 8);
+	WriteEXRAttribute(header, "screenWindowWidth", "float", &screenWindowWidth, 4);
+	header.push_back(0);
+
+	// Every scanline is its own chunk, with its y coordinate and size in front of it
+	int32_t lineSize = job.width * 3 * sizeof(float);
+	uint64_t chunkStart = header.size() + job.height * sizeof(uint64_t);
+	std::vector<uint64_t> offsets(job.height);
+	for (int y = 0; y < job.height; y++)
+	{
+		offsets[y] = chunkStart + (uint64_t)y * (8 + lineSize);
+	}
+
+	std::ofstream out(job.file, std::ios::binary);
+	if (!out.is_open()) return false;
+
+	out.write(header.data(), header.size());
+	out.write((const char*)offsets.data(), offsets.size() * sizeof(uint64_t));
+
+	std::vector<float> line(job.width * 3);
+	for (int32_t y = 0; y < job.height; y++)
+	{
+		// EXR starts at the top row, and stores every channel of a scanline after each other
+		const float* source = &job.pixels[(job.height - 1 - y) * job.width * 3];
+		for (int x = 0; x < job.width; x++)
+		{
+			line[x] = source[x * 3 + 2];
+			line[job.width + x] = source[x * 3 + 1];
+			line[job.width * 2 + x] = source[x * 3];
+		}
+
+		out.write((const char*)&y, 4);
+		out.write((const char*)&lineSize, 4);
+		out.write((const char*)line.data(), lineSize);
+	}
+
+	return out.good();
+}
\ No newline at end of file
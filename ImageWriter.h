@@ -0,0 +1,73 @@
+#pragma once
+#ifndef IMAGE_WRITER_CLASS_H
+#define IMAGE_WRITER_CLASS_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+enum ImageFormat : int
+{
+	// 8 bit, lossy
+	FORMAT_JPG,
+	// 16 bit per channel, lossless within the 0-1 range
+	FORMAT_PNG16,
+	// 32 bit float portable float map, lossless
+	FORMAT_PFM,
+	// 32 bit float OpenEXR, lossless
+	FORMAT_EXR
+};
+
+// Encodes and saves images on a background thread so the render loop never waits for it
+class ImageWriter
+{
+	struct Job
+	{
+		std::string file;
+		ImageFormat format;
+		int width, height;
+		// RGB floats, with the bottom row first like OpenGL returns them
+		std::vector<float> pixels;
+	};
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<Job> m_jobs;
+	bool m_stop = false;
+	// Declared last so it starts after everything it uses has been constructed
+	std::thread m_thread;
+
+	void WorkerLoop();
+	static bool Encode(const Job& job);
+	// The pixels as 8 bit RGB
+	static std::vector<unsigned char> Quantize(const Job& job);
+
+	static bool WriteJPG(const Job& job);
+	static bool WritePNG16(const Job& job);
+	static bool WritePFM(const Job& job);
+	static bool WriteEXR(const Job& job);
+
+public:
+	ImageWriter();
+	// Finishes the queued images before returning
+	~ImageWriter();
+
+	// The file extension that belongs to a format
+	static const char* GetExtention(ImageFormat format);
+	// The format that belongs to the file extention of a file
+	static ImageFormat GetFormat(const std::string& file);
+
+	// Queues an image to be saved, takes ownership of the pixels
+	void Write(const std::string& file, ImageFormat format, int width, int height, std::vector<float>&& pixels);
+	// Saves an image on the calling thread, for when the file has to exist before going on
+	static bool WriteNow(const std::string& file, ImageFormat format, int width, int height, std::vector<float>&& pixels);
+	// Encodes a jpg in memory, for sending it somewhere instead of saving it
+	static std::vector<unsigned char> EncodeJPG(int width, int height, std::vector<float>&& pixels, int quality);
+	// The amount of images that still have to be saved
+	int GetQueueSize();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "Importer.h"
+
+Importer::Importer(int threadCount)
+{
+	for (int i = 0; i < std::max(threadCount, 1); i++)
+	{
+		m_threads.emplace_back(&Importer::WorkerLoop, this);
+	}
+}
+
+Importer::~Importer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_queue.clear();
+	}
+	m_condition.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void Importer::Import(const std::string& file, bool reload, uint64_t refitTopology)
+{
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->file = file;
+	job->reload = reload;
+	job->refitTopology = refitTopology;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(job);
+		m_queue.push_back(job);
+	}
+	m_condition.notify_one();
+}
+
+std::vector<ImportProgress> Importer::GetProgress()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<ImportProgress> progress;
+	auto now = std::chrono::steady_clock::now();
+	for (const std::shared_ptr<Job>& job : m_jobs)
+	{
+		progress.push_back({ job->file, job->stage, job->readProgress, std::chrono::duration<double>(now - job->start).count() });
+	}
+	return progress;
+}
+
+std::vector<ImportResult> Importer::TakeFinished()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<ImportResult> finished;
+	for (int i = 0; i < (int)m_jobs.size(); i++)
+	{
+		ImportStage stage = m_jobs[i]->stage;
+		if (stage != IMPORT_DONE && stage != IMPORT_FAILED) continue;
+
+		if (stage == IMPORT_DONE)
+		{
+			const std::shared_ptr<Job>& job = m_jobs[i];
+			finished.push_back({ job->file, job->geometry, job->image, job->meshes, job->meshNames, job->reload });
+		}
+		else
+		{
+			std::cout << "Failed to import: " << m_jobs[i]->file << "\n";
+		}
+
+		m_jobs.erase(m_jobs.begin() + i);
+		i--;
+	}
+	return finished;
+}
+
+bool Importer::IsBusy()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return !m_jobs.empty();
+}
+
+void Importer::WorkerLoop()
+{
+	while (true)
+	{
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+
+			if (m_stop) return;
+
+			job = m_queue.front();
+			m_queue.pop_front();
+		}
+
+		TRACE_SCOPE("Importer::Import", job->file);
+
+		job->stage = IMPORT_READING;
+
+		if (IsImage(job->file))
+		{
+			std::shared_ptr<ImageData> image = std::make_shared<ImageData>();
+			if (!image->LoadFromFile(job->file.c_str()))
+			{
+				job->stage = IMPORT_FAILED;
+				continue;
+			}
+
+			job->image = image;
+			job->stage = IMPORT_DONE;
+			continue;
+		}
+
+		if (IsScene(job->file))
+		{
+			GltfLoader loader;
+			if (!loader.Load(job->file.c_str(), job->meshes, job->meshNames))
+			{
+				job->meshes.clear();
+				job->meshNames.clear();
+				job->stage = IMPORT_FAILED;
+				continue;
+			}
+			job->readProgress = 1.0f;
+
+			// Meshes share the geometry of their primitive, so only build each one once
+			job->stage = IMPORT_BUILDING;
+			for (int i = 0; i < (int)job->meshes.size(); i++)
+			{
+				bool built = false;
+				for (int j = 0; j < i && !built; j++)
+				{
+					built = job->meshes[j].geometry == job->meshes[i].geometry;
+				}
+				if (!built) job->meshes[i].geometry->UpdateBoundingBoxes();
+			}
+
+			job->stage = IMPORT_DONE;
+			continue;
+		}
+
+		// Only this worker touches the geometry until the job is done
+		std::shared_ptr<Geometry> geometry = std::make_shared<Geometry>();
+
+		// Nothing to parse or build when the file was imported before and has not changed since
+		if (geometry->LoadFromCache(job->file.c_str()) && !geometry->indices.empty())
+		{
+			job->readProgress = 1.0f;
+			job->geometry = geometry;
+			job->stage = IMPORT_DONE;
+			continue;
+		}
+
+		if (!geometry->LoadFromFile(job->file.c_str(), &job->readProgress) || geometry->indices.empty())
+		{
+			job->stage = IMPORT_FAILED;
+			continue;
+		}
+
+		// Only the vertices moved, refitting the bounding boxes that are already in the scene is a lot cheaper than building new ones
+		if (job->reload && job->refitTopology != 0 && geometry->GetTopologyHash() == job->refitTopology)
+		{
+			job->geometry = geometry;
+			job->stage = IMPORT_DONE;
+			continue;
+		}
+
+		job->stage = IMPORT_BUILDING;
+		geometry->UpdateBoundingBoxes();
+		geometry->SaveToCache();
+
+		job->geometry = geometry;
+		job->stage = IMPORT_DONE;
+	}
+}
+
+std::string Importer::GetExtention(const std::string& file)
+{
+	std::string extention = std::filesystem::path(file).extension().string();
+	std::transform(extention.begin(), extention.end(), extention.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return extention;
+}
+
+bool Importer::IsImage(const std::string& file)
+{
+	std::string extention = GetExtention(file);
+	return extention == ".jpg" || extention == ".jpeg" || extention == ".png" || extention == ".hdr";
+}
+
+bool Importer::IsScene(const std::string& file)
+{
+	return GetExtention(file) == ".glb";
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+#ifndef IMPORTER_CLASS_H
+#define IMPORTER_CLASS_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+#include <filesystem>
+#include <cctype>
+#include "Objects.h"
+#include "Texture.h"
+#include "GltfLoader.h"
+
+enum ImportStage : int
+{
+	IMPORT_QUEUED,
+	// Reading the file
+	IMPORT_READING,
+	// Building the bounding boxes
+	IMPORT_BUILDING,
+	// Ready to be added to the scene
+	IMPORT_DONE,
+	IMPORT_FAILED
+};
+
+// A finished import, either a mesh, a scene of meshes or a skybox image
+struct ImportResult
+{
+	std::string file;
+	std::shared_ptr<Geometry> geometry;
+	std::shared_ptr<ImageData> image;
+	// The meshes of a scene file with their names, they can share geometry
+	std::vector<Mesh> meshes;
+	std::vector<std::string> meshNames;
+	// Replaces what was loaded from the file before instead of adding something new
+	bool reload;
+};
+
+// What the UI shows of an import
+struct ImportProgress
+{
+	std::string file;
+	ImportStage stage;
+	// How much of the file has been read, from 0 to 1
+	float readProgress;
+	double seconds;
+};
+
+// Loads geometry files and builds their bounding boxes, or decodes images, on worker threads so the render loop keeps going in the meantime.
+// Only the CPU side happens here, the results still have to be uploaded by the render thread
+class Importer
+{
+	struct Job
+	{
+		std::string file;
+		bool reload = false;
+		// The topology hash of the geometry that is being reloaded, its bounding boxes are refitted instead of built when the triangles stay the same
+		uint64_t refitTopology = 0;
+		std::shared_ptr<Geometry> geometry;
+		std::shared_ptr<ImageData> image;
+		std::vector<Mesh> meshes;
+		std::vector<std::string> meshNames;
+		std::atomic<ImportStage> stage{ IMPORT_QUEUED };
+		std::atomic<float> readProgress{ 0.0f };
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	};
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	// Every import that has not been taken yet, the queue only holds the ones no worker has started on
+	std::vector<std::shared_ptr<Job>> m_jobs;
+	std::deque<std::shared_ptr<Job>> m_queue;
+	bool m_stop = false;
+	// Declared last so they start after everything they use has been constructed
+	std::vector<std::thread> m_threads;
+
+	void WorkerLoop();
+	static std::string GetExtention(const std::string& file);
+	static bool IsImage(const std::string& file);
+	static bool IsScene(const std::string& file);
+
+public:
+	// Each worker imports one file at a time
+	Importer(int threadCount = 2);
+	// Waits for the files that are being imported, the queued ones are dropped
+	~Importer();
+
+	// Queues an .obj, .ply or .stl mesh, a .glb scene or a skybox image to be imported.
+	// A reloaded mesh with the given topology hash comes back without bounding boxes, so the scene can refit the ones it has
+	void Import(const std::string& file, bool reload = false, uint64_t refitTopology = 0);
+	// The state of every import that has not been taken yet
+	std::vector<ImportProgress> GetProgress();
+	// Takes the imports that are done, failed imports are reported and dropped
+	std::vector<ImportResult> TakeFinished();
+	// True while there are imports that have not been taken yet
+	bool IsBusy();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,335 @@
+#include "Json.h"
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+
+struct JsonValue::Parser
+{
+	const char* text;
+	size_t length;
+	size_t position = 0;
+	int depth = 0;
+
+	void Fail(const char* message)
+	{
+		throw std::string("Invalid JSON at ") + std::to_string(position) + ": " + message;
+	}
+
+	void SkipWhitespace()
+	{
+		while (position < length && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r')) position++;
+	}
+
+	bool Match(const char* word)
+	{
+		size_t size = std::strlen(word);
+		if (length - position < size || std::strncmp(text + position, word, size) != 0) return false;
+		position += size;
+		return true;
+	}
+
+	static void AppendUTF8(std::string& out, unsigned int codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			out += (char)codePoint;
+		}
+		else if (codePoint < 0x800)
+		{
+			out += (char)(0xC0 | (codePoint >> 6));
+			out += (char)(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			out += (char)(0xE0 | (codePoint >> 12));
+			out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			out += (char)(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			out += (char)(0xF0 | (codePoint >> 18));
+			out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+			out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			out += (char)(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	unsigned int ParseHex4()
+	{
+		if (length - position < 4) Fail("unfinished escape");
+
+		unsigned int value = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			char c = text[position++];
+			value <<= 4;
+			if (c >= '0' && c <= '9') value |= c - '0';
+			else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+			else Fail("invalid escape");
+		}
+		return value;
+	}
+
+	std::string ParseString()
+	{
+		// Skip the opening quote
+		position++;
+
+		std::string out;
+		while (true)
+		{
+			if (position >= length) Fail("unfinished string");
+
+			char c = text[position++];
+			if (c == '"') return out;
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+
+			if (position >= length) Fail("unfinished escape");
+			char escape = text[position++];
+			switch (escape)
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u': {
+				unsigned int codePoint = ParseHex4();
+				// Characters outside of the basic plane are written as two surrogates
+				if (codePoint >= 0xD800 && codePoint < 0xDC00 && Match("\\u"))
+				{
+					unsigned int low = ParseHex4();
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+				}
+				AppendUTF8(out, codePoint);
+			} break;
+			default: Fail("invalid escape");
+			}
+		}
+	}
+
+	JsonValue ParseValue()
+	{
+		SkipWhitespace();
+		if (position >= length) Fail("unexpected end");
+
+		// Deeply nested input would otherwise run out of stack
+		if (depth > 512) Fail("nested too deep");
+
+		JsonValue value;
+		char c = text[position];
+		if (c == '{')
+		{
+			position++;
+			depth++;
+			value.type = JSON_OBJECT;
+
+			SkipWhitespace();
+			if (position < length && text[position] == '}')
+			{
+				position++;
+				depth--;
+				return value;
+			}
+
+			while (true)
+			{
+				SkipWhitespace();
+				if (position >= length || text[position] != '"') Fail("expected a key");
+				std::string key = ParseString();
+
+				SkipWhitespace();
+				if (position >= length || text[position] != ':') Fail("expected ':'");
+				position++;
+
+				value.object.emplace_back(std::move(key), ParseValue());
+
+				SkipWhitespace();
+				if (position < length && text[position] == ',')
+				{
+					position++;
+					continue;
+				}
+				if (position < length && text[position] == '}')
+				{
+					position++;
+					break;
+				}
+				Fail("expected ',' or '}'");
+			}
+			depth--;
+		}
+		else if (c == '[')
+		{
+			position++;
+			depth++;
+			value.type = JSON_ARRAY;
+
+			SkipWhitespace();
+			if (position < length && text[position] == ']')
+			{
+				position++;
+				depth--;
+				return value;
+			}
+
+			while (true)
+			{
+				value.array.push_back(ParseValue());
+
+				SkipWhitespace();
+				if (position < length && text[position] == ',')
+				{
+					position++;
+					continue;
+				}
+				if (position < length && text[position] == ']')
+				{
+					position++;
+					break;
+				}
+				Fail("expected ',' or ']'");
+			}
+			depth--;
+		}
+		else if (c == '"')
+		{
+			value.type = JSON_STRING;
+			value.string = ParseString();
+		}
+		else if (Match("true"))
+		{
+			value.type = JSON_BOOL;
+			value.boolean = true;
+		}
+		else if (Match("false"))
+		{
+			value.type = JSON_BOOL;
+		}
+		else if (Match("null"))
+		{
+			value.type = JSON_NULL;
+		}
+		else if (c == '-' || (c >= '0' && c <= '9'))
+		{
+			// strtod needs a terminated string, and numbers are short
+			size_t end = position + 1;
+			while (end < length && std::strchr("0123456789+-.eE", text[end])) end++;
+			std::string number(text + position, end - position);
+
+			char* numberEnd = nullptr;
+			value.type = JSON_NUMBER;
+			value.number = std::strtod(number.c_str(), &numberEnd);
+			if (numberEnd != number.c_str() + number.size()) Fail("invalid number");
+			position = end;
+		}
+		else
+		{
+			Fail("unexpected character");
+		}
+
+		return value;
+	}
+};
+
+JsonValue JsonValue::Parse(const char* text, size_t length)
+{
+	Parser parser{ text, length };
+	JsonValue value = parser.ParseValue();
+
+	parser.SkipWhitespace();
+	if (parser.position != length) parser.Fail("unexpected text after the value");
+
+	return value;
+}
+
+JsonValue JsonValue::Parse(const std::string& text)
+{
+	return Parse(text.data(), text.size());
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+	static const JsonValue null;
+	if (type != JSON_OBJECT) return null;
+
+	for (const auto& member : object)
+	{
+		if (member.first == key) return member.second;
+	}
+	return null;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	static const JsonValue null;
+	if (type != JSON_ARRAY || index >= array.size()) return null;
+	return array[index];
+}
+
+size_t JsonValue::Size() const
+{
+	if (type == JSON_ARRAY) return array.size();
+	if (type == JSON_OBJECT) return object.size();
+	return 0;
+}
+
+double JsonValue::AsNumber(double fallback) const
+{
+	return type == JSON_NUMBER ? number : fallback;
+}
+
+int JsonValue::AsInt(int fallback) const
+{
+	if (type != JSON_NUMBER || number != number) return fallback;
+
+	// Converting a number outside of the range of int is undefined, so it is clamped and still fails the caller's range checks
+	if (number <= (double)INT_MIN) return INT_MIN;
+	if (number >= (double)INT_MAX) return INT_MAX;
+	return (int)number;
+}
+
+bool JsonValue::AsBool(bool fallback) const
+{
+	return type == JSON_BOOL ? boolean : fallback;
+}
+
+const std::string& JsonValue::AsString() const
+{
+	static const std::string empty;
+	return type == JSON_STRING ? string : empty;
+}
+
+std::string JsonValue::Quote(const std::string& text)
+{
+	std::string quoted = "\"";
+	for (char c : text)
+	{
+		switch (c)
+		{
+		case '"': quoted += "\\\""; break;
+		case '\\': quoted += "\\\\"; break;
+		case '\n': quoted += "\\n"; break;
+		case '\r': quoted += "\\r"; break;
+		case '\t': quoted += "\\t"; break;
+		default:
+			if ((unsigned char)c < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+				quoted += escaped;
+			}
+			else quoted += c;
+		}
+	}
+	return quoted + "\"";
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#ifndef JSON_CLASS_H
+#define JSON_CLASS_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+enum JsonType : int
+{
+	JSON_NULL,
+	JSON_BOOL,
+	JSON_NUMBER,
+	JSON_STRING,
+	JSON_ARRAY,
+	JSON_OBJECT
+};
+
+// A parsed JSON document. Looking up a member or element that does not exist gives a null value, so lookups can be chained
+class JsonValue
+{
+	struct Parser;
+
+public:
+	JsonType type = JSON_NULL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	// The members in the order of the file
+	std::vector<std::pair<std::string, JsonValue>> object;
+
+	// Throws a std::string with the position when the text is not valid JSON
+	static JsonValue Parse(const char* text, size_t length);
+	static JsonValue Parse(const std::string& text);
+	// The text as a JSON string with quotes around it, for writing JSON
+	static std::string Quote(const std::string& text);
+
+	bool IsNull() const { return type == JSON_NULL; }
+	bool IsNumber() const { return type == JSON_NUMBER; }
+	bool IsString() const { return type == JSON_STRING; }
+	bool IsArray() const { return type == JSON_ARRAY; }
+	bool IsObject() const { return type == JSON_OBJECT; }
+
+	// The member with the key, or null
+	const JsonValue& operator[](const char* key) const;
+	// The element at the index, or null
+	const JsonValue& operator[](size_t index) const;
+	const JsonValue& operator[](int index) const { return (*this)[(size_t)index]; }
+	// The amount of elements or members
+	size_t Size() const;
+
+	// The value, or the fallback when it has another type
+	double AsNumber(double fallback = 0.0) const;
+	// Rounded towards zero and clamped to the range of int
+	int AsInt(int fallback = 0) const;
+	bool AsBool(bool fallback = false) const;
+	const std::string& AsString() const;
+};
+
+#endif
\ No newline at end of file
@@ -1,7 +1,133 @@
+#ifndef CONTEXT_NO_WINDOW
 #include "App.h"
+#endif
+#include "Benchmark.h"
+#include "DistributedRender.h"
+#include "HeadlessApp.h"
+#include "RenderServer.h"
 
-int main()
+int main(int argc, char** argv)
 {
+	// Render without a window: --headless [--scene file] [--size width height] [--frames count] [--output file]
+	// Run the benchmark scenes:  --benchmark [--headless] [--scene name] [--size width height] [--frames count] [--output file]
+	// Measure the convergence:   --convergence [--headless] [--scene name] [--size width height] [--seconds time] [--interval time]
+	//                            [--reference-frames count] [--references directory] [--output file]
+	// Serve a coordinator:      --worker [--port port] [--remote]
+	// Render on workers:        --coordinator --scene file --workers host:port,host:port [--tile size] [--timeout seconds]
+	//                            [--size width height] [--frames count] [--output file]
+	// Take render jobs over HTTP: --server [--port port] [--remote]
+	// Any of these can also save a trace of where the time went: --trace file
+	bool headless = false;
+	bool benchmark = false;
+	bool convergence = false;
+	bool worker = false;
+	bool coordinator = false;
+	bool server = false, remote = false;
+	int port = 7000, tileSize = 0;
+	double timeout = 600.0;
+	std::vector<std::string> workers;
+	int width = 1280, height = 720, frames = -1;
+	std::string output, scene;
+	double seconds = 20.0, interval = 1.0;
+	int referenceFrames = 4096;
+	std::string references = "references";
+	std::string trace;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--headless") headless = true;
+		else if (arg == "--benchmark") benchmark = true;
+		else if (arg == "--convergence") convergence = true;
+		else if (arg == "--scene" && i + 1 < argc) scene = argv[++i];
+		else if (arg == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+		else if (arg == "--interval" && i + 1 < argc) interval = std::atof(argv[++i]);
+		else if (arg == "--reference-frames" && i + 1 < argc) referenceFrames = std::atoi(argv[++i]);
+		else if (arg == "--references" && i + 1 < argc) references = argv[++i];
+		else if (arg == "--size" && i + 2 < argc) { width = std::atoi(argv[++i]); height = std::atoi(argv[++i]); }
+		else if (arg == "--frames" && i + 1 < argc) frames = std::atoi(argv[++i]);
+		else if (arg == "--output" && i + 1 < argc) output = argv[++i];
+		else if (arg == "--trace" && i + 1 < argc) trace = argv[++i];
+		else if (arg == "--worker") worker = true;
+		else if (arg == "--coordinator") coordinator = true;
+		else if (arg == "--server") server = true;
+		else if (arg == "--remote") remote = true;
+		else if (arg == "--port" && i + 1 < argc) port = std::atoi(argv[++i]);
+		else if (arg == "--tile" && i + 1 < argc) tileSize = std::atoi(argv[++i]);
+		else if (arg == "--timeout" && i + 1 < argc) timeout = std::atof(argv[++i]);
+		else if (arg == "--workers" && i + 1 < argc)
+		{
+			std::stringstream list(argv[++i]);
+			std::string address;
+			while (std::getline(list, address, ',')) workers.push_back(address);
+		}
+	}
+
+#ifdef CONTEXT_NO_WINDOW
+	// A build without windows always renders headless
+	headless = true;
+#endif
+
+	if (benchmark || convergence || headless || worker || coordinator || server)
+	{
+		try
+		{
+			int result;
+			if (worker)
+			{
+				RenderWorker renderWorker;
+				renderWorker.remoteAccess = remote;
+				result = renderWorker.Serve(port);
+			}
+			else if (server)
+			{
+				RenderServer renderServer;
+				renderServer.remoteAccess = remote;
+				result = renderServer.Serve(port);
+			}
+			else if (coordinator)
+			{
+				RenderCoordinator renderCoordinator;
+				renderCoordinator.workers = workers;
+				renderCoordinator.tileSize = tileSize;
+				renderCoordinator.timeout = timeout;
+				result = renderCoordinator.Render(scene, width, height, frames > 0 ? frames : 256, output.empty() ? "renders/distributed.png" : output);
+			}
+			else if (benchmark || convergence)
+			{
+				Benchmark suite(width, height, headless);
+				suite.sceneFilter = scene;
+				if (convergence)
+				{
+					result = suite.RunConvergence(seconds, interval, referenceFrames, references, output.empty() ? "convergence.json" : output);
+				}
+				else
+				{
+					result = suite.Run(frames > 0 ? frames : 32, output.empty() ? "benchmark.json" : output);
+				}
+			}
+			else
+			{
+				HeadlessApp app(width, height);
+				if (!scene.empty() && !app.LoadSceneFile(scene)) return 1;
+				result = app.Render(frames > 0 ? frames : 256, output.empty() ? "renders/headless.png" : output);
+			}
+
+			if (!trace.empty() && !Tracer::Get().WriteJSON(trace))
+			{
+				std::cout << "Failed to save trace: " << trace << "\n";
+			}
+			return result;
+		}
+		catch (const std::string& error)
+		{
+			std::cout << error;
+			return 1;
+		}
+	}
+
+#ifndef CONTEXT_NO_WINDOW
 	App app(1280, 720, "Ray Tracing");
 	return app.Start();
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#ifndef MAPPED_FILE_CLASS_H
+#define MAPPED_FILE_CLASS_H
+
+#include <cstddef>
+
+// A read only view of a whole file in memory, the operating system pages it in as it is read instead of copying it up front
+class MappedFile
+{
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#else
+	int m_file = -1;
+#endif
+
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Returns false when the file can not be opened, an empty file maps to nothing
+	bool Open(const char* file);
+	void Close();
+
+	const unsigned char* GetData() const;
+	size_t GetSize() const;
+};
+
+#endif
\ No newline at end of file
@@ -1,4 +1,13 @@
 #include "Objects.h"
+#include "MappedFile.h"
+#include <filesystem>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
 
 void BoundingBox::GrowToInclude(const glm::vec3& point)
 {
@@ -18,7 +27,13 @@ void BoundingBox::GrowToInclude(const Triangle& triangle)
 	GrowToInclude(triangle.p[2]);
 }
 
-void Mesh::RecursiveBoundingBox(int boundingBoxIndex, std::vector<int>& triangleIndices)
+float BoundingBox::SurfaceArea() const
+{
+	glm::vec3 size = max - min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+void Geometry::RecursiveBoundingBox(int boundingBoxIndex, std::vector<int>& triangleIndices)
 {
 	if (triangleIndices.size() == 1)
 	{
@@ -56,7 +71,7 @@ void Mesh::RecursiveBoundingBox(int boundingBoxIndex, std::vector<int>& triangle
 
 	for (int i : triangleIndices)
 	{
-		Triangle triangle = triangles[i];
+		Triangle triangle = GetTriangle(i);
 
 		//Vector3d trianglePosition = triangle->vertices[0];
 		glm::vec3 trianglePosition = (triangle.p[0] + triangle.p[1] + triangle.p[2]) / 3.0f;
@@ -81,7 +96,7 @@ void Mesh::RecursiveBoundingBox(int boundingBoxIndex, std::vector<int>& triangle
 		triangleIndicesA.clear();
 
 		// Finish the bounding box
-		boxA.GrowToInclude(triangles[triangleIndices[0]]);
+		boxA.GrowToInclude(GetTriangle(triangleIndices[0]));
 		triangleIndicesA.push_back(triangleIndices[0]);
 		boxA.triangleIndex = triangleIndices[0];
 
@@ -95,7 +110,7 @@ void Mesh::RecursiveBoundingBox(int boundingBoxIndex, std::vector<int>& triangle
 		for (int i = 1; i < triangleIndices.size(); i++)
 		{
 			int index = triangleIndices[i];
-			boxB.GrowToInclude(triangles[index]);
+			boxB.GrowToInclude(GetTriangle(index));
 			triangleIndicesB.push_back(index);
 		}
 
@@ -132,9 +147,13 @@ void Mesh::UpdateTransformMatrix()
 	modelWorldToLocalMatrix = glm::inverse(localToWorldMatrix);
 }
 
-bool Mesh::LoadFromObjectFile(const char* file)
+bool Geometry::LoadFromObjectFile(const char* file, std::atomic<float>* progress)
 {
-	triangles.clear();
+	TRACE_SCOPE("Geometry::LoadFromObjectFile", file);
+
+	Geometry::file = file;
+	vertices.clear();
+	indices.clear();
 
 	std::ifstream in(file, std::ios::binary);
 	if (!in.is_open())
@@ -142,14 +161,26 @@ bool Mesh::LoadFromObjectFile(const char* file)
 		return false;
 	}
 
-	std::vector<glm::vec3> vertices;
 	bool firstTriangle = true;
+	bool validIndices = true;
+
+	// The file size, to tell how far along the loading is
+	in.seekg(0, std::ios::end);
+	double fileSize = (double)in.tellg();
+	in.seekg(0, std::ios::beg);
+	int linesRead = 0;
 
 	while (!in.eof())
 	{
 		std::string line;
 		std::getline(in, line);
 
+		if (progress && fileSize > 0.0 && ++linesRead % 65536 == 0)
+		{
+			std::streamoff position = in.tellg();
+			if (position >= 0) *progress = (float)(position / fileSize);
+		}
+
 		std::stringstream ss(line);
 
 		switch (line[0])
@@ -167,35 +198,790 @@ bool Mesh::LoadFromObjectFile(const char* file)
 			{
 				firstTriangle = false;
 				// Pre-reserve memory for the triangles to speed up loading
-				triangles.reserve(triangles.size() + vertices.size() / 3);
+				indices.reserve(indices.size() + vertices.size() * 2);
 			}
 
-			int i0, i1, i2;
+			long long corners[3];
 			char junk;
 
-			ss >> junk >> i0 >> i1 >> i2;
-			triangles.push_back({{ glm::vec4(vertices[i0 - 1], 1.0f), glm::vec4(vertices[i1 - 1], 1.0f), glm::vec4(vertices[i2 - 1], 1.0f) }});
+			if (!(ss >> junk >> corners[0] >> corners[1] >> corners[2]))
+			{
+				validIndices = false;
+				break;
+			}
+
+			// The vertices are already shared between the faces, so the indices can be stored as they are. Negative ones count back from the last vertex so far
+			glm::uvec3 triangle;
+			for (int j = 0; j < 3; j++)
+			{
+				long long index = corners[j] < 0 ? (long long)vertices.size() + corners[j] : corners[j] - 1;
+				if (index < 0 || index > (long long)UINT32_MAX) validIndices = false;
+				triangle[j] = (unsigned int)index;
+			}
+			indices.push_back(triangle);
 		} break;
 		default: break;
 		}
 	}
 
+	for (const glm::uvec3& triangle : indices)
+	{
+		if (triangle.x >= vertices.size() || triangle.y >= vertices.size() || triangle.z >= vertices.size()) validIndices = false;
+	}
+	if (!validIndices)
+	{
+		std::cout << file << ": the OBJ faces use vertices that do not exist\n";
+		indices.clear();
+		return false;
+	}
+
+	if (progress) *progress = 1.0f;
+	return true;
+}
+
+bool Geometry::LoadFromFile(const char* file, std::atomic<float>* progress)
+{
+	std::string extention = std::filesystem::path(file).extension().string();
+	std::transform(extention.begin(), extention.end(), extention.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	if (extention == ".ply") return LoadFromPlyFile(file, progress);
+	if (extention == ".stl") return LoadFromStlFile(file, progress);
+	return LoadFromObjectFile(file, progress);
+}
+
+// The extra threads of every ParallelFor that is running. Importer workers load files at the same time, so they share the cores instead of each starting a thread per core
+static std::atomic<int> s_parallelThreads{ 0 };
+
+// Calls the function on ranges of the items spread over the free cores, and sets the progress to how many of them are done
+static void ParallelFor(size_t count, std::atomic<float>* progress, const std::function<void(size_t first, size_t last)>& function)
+{
+	// Small enough ranges to keep the progress moving and the threads busy until the end
+	const size_t rangeSize = 1 << 16;
+	size_t rangeCount = (count + rangeSize - 1) / rangeSize;
+	int coreCount = (int)std::max(std::thread::hardware_concurrency(), 1u);
+	int wanted = (int)std::min<size_t>(coreCount, rangeCount);
+
+	// The calling thread always works on the ranges as well, the others are only started while there are cores left
+	int threadCount = 1;
+	int busy = s_parallelThreads;
+	while (threadCount < wanted && busy < coreCount - 1)
+	{
+		if (s_parallelThreads.compare_exchange_weak(busy, busy + 1)) threadCount++;
+	}
+
+	std::atomic<size_t> nextRange{ 0 };
+	std::atomic<size_t> rangesDone{ 0 };
+	auto worker = [&]()
+	{
+		for (size_t range = nextRange++; range < rangeCount; range = nextRange++)
+		{
+			function(range * rangeSize, std::min(count, (range + 1) * rangeSize));
+			if (progress) *progress = (float)(++rangesDone) / (float)rangeCount;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	s_parallelThreads -= threadCount - 1;
+}
+
+// Reads a value that is stored in the file with the given byte order, the engine only runs on little endian machines
+template<typename T>
+static T ReadValue(const unsigned char* data, bool bigEndian)
+{
+	unsigned char bytes[sizeof(T)];
+	std::memcpy(bytes, data, sizeof(T));
+	if (bigEndian) std::reverse(bytes, bytes + sizeof(T));
+
+	T value;
+	std::memcpy(&value, bytes, sizeof(T));
+	return value;
+}
+
+enum PlyType : int
+{
+	PLY_INVALID,
+	PLY_INT8,
+	PLY_UINT8,
+	PLY_INT16,
+	PLY_UINT16,
+	PLY_INT32,
+	PLY_UINT32,
+	PLY_FLOAT32,
+	PLY_FLOAT64
+};
+
+struct PlyProperty
+{
+	std::string name;
+	PlyType type = PLY_INVALID;
+	// The type of the item count in front of a list, the type above is the type of its items
+	PlyType countType = PLY_INVALID;
+	bool isList = false;
+	// From the start of the record, only used when there is no list in front of it
+	size_t offset = 0;
+};
+
+struct PlyElement
+{
+	std::string name;
+	size_t count = 0;
+	std::vector<PlyProperty> properties;
+	// The size of every record, or 0 when the records have lists in them and can differ in size
+	size_t recordSize = 0;
+};
+
+static PlyType GetPlyType(const std::string& name)
+{
+	if (name == "char" || name == "int8") return PLY_INT8;
+	if (name == "uchar" || name == "uint8") return PLY_UINT8;
+	if (name == "short" || name == "int16") return PLY_INT16;
+	if (name == "ushort" || name == "uint16") return PLY_UINT16;
+	if (name == "int" || name == "int32") return PLY_INT32;
+	if (name == "uint" || name == "uint32") return PLY_UINT32;
+	if (name == "float" || name == "float32") return PLY_FLOAT32;
+	if (name == "double" || name == "float64") return PLY_FLOAT64;
+	return PLY_INVALID;
+}
+
+static size_t GetPlyTypeSize(PlyType type)
+{
+	switch (type)
+	{
+	case PLY_INT8: case PLY_UINT8: return 1;
+	case PLY_INT16: case PLY_UINT16: return 2;
+	case PLY_INT32: case PLY_UINT32: case PLY_FLOAT32: return 4;
+	case PLY_FLOAT64: return 8;
+	default: return 0;
+	}
+}
+
+static double ReadPlyValue(const unsigned char* data, PlyType type, bool bigEndian)
+{
+	switch (type)
+	{
+	case PLY_INT8: return (double)(int8_t)data[0];
+	case PLY_UINT8: return (double)data[0];
+	case PLY_INT16: return (double)ReadValue<int16_t>(data, bigEndian);
+	case PLY_UINT16: return (double)ReadValue<uint16_t>(data, bigEndian);
+	case PLY_INT32: return (double)ReadValue<int32_t>(data, bigEndian);
+	case PLY_UINT32: return (double)ReadValue<uint32_t>(data, bigEndian);
+	case PLY_FLOAT32: return (double)ReadValue<float>(data, bigEndian);
+	case PLY_FLOAT64: return ReadValue<double>(data, bigEndian);
+	default: return 0.0;
+	}
+}
+
+// The size of a record with lists in it, returns false when it does not end before the end of the data
+static bool GetPlyRecordSize(const PlyElement& element, const unsigned char* record, const unsigned char* end, bool bigEndian, size_t& size)
+{
+	size = 0;
+	for (const PlyProperty& property : element.properties)
+	{
+		if (!property.isList)
+		{
+			size += GetPlyTypeSize(property.type);
+			continue;
+		}
+
+		size_t countSize = GetPlyTypeSize(property.countType);
+		if ((size_t)(end - record) < size + countSize) return false;
+
+		double count = ReadPlyValue(record + size, property.countType, bigEndian);
+		if (count < 0.0 || count > (double)(end - record)) return false;
+		size += countSize + (size_t)count * GetPlyTypeSize(property.type);
+	}
+	return (size_t)(end - record) >= size;
+}
+
+bool Geometry::LoadFromPlyFile(const char* file, std::atomic<float>* progress)
+{
+	TRACE_SCOPE("Geometry::LoadFromPlyFile", file);
+
+	Geometry::file = file;
+	vertices.clear();
+	indices.clear();
+
+	MappedFile mappedFile;
+	if (!mappedFile.Open(file))
+	{
+		return false;
+	}
+	const unsigned char* data = mappedFile.GetData();
+	const unsigned char* end = data + mappedFile.GetSize();
+
+	// The header is text, ending with a line that says end_header
+	const char* headerEnd = "end_header";
+	const unsigned char* body = std::search(data, end, headerEnd, headerEnd + std::strlen(headerEnd));
+	body = std::find(body, end, '\n');
+	if (body == end)
+	{
+		std::cout << file << ": no PLY header\n";
+		return false;
+	}
+	body++;
+
+	std::stringstream header(std::string((const char*)data, body - data));
+	std::string line;
+	std::getline(header, line);
+	if (line.compare(0, 3, "ply") != 0)
+	{
+		std::cout << file << ": not a PLY file\n";
+		return false;
+	}
+
+	bool bigEndian = false;
+	std::vector<PlyElement> elements;
+	while (std::getline(header, line))
+	{
+		std::stringstream ss(line);
+		std::string keyword;
+		ss >> keyword;
+
+		if (keyword == "format")
+		{
+			std::string format;
+			ss >> format;
+			if (format == "binary_big_endian") bigEndian = true;
+			else if (format != "binary_little_endian")
+			{
+				std::cout << file << ": only binary PLY files are supported\n";
+				return false;
+			}
+		}
+		else if (keyword == "element")
+		{
+			PlyElement element;
+			ss >> element.name >> element.count;
+			elements.push_back(element);
+		}
+		else if (keyword == "property" && !elements.empty())
+		{
+			PlyProperty property;
+			std::string type;
+			ss >> type;
+			if (type == "list")
+			{
+				std::string countType;
+				ss >> countType >> type;
+				property.isList = true;
+				property.countType = GetPlyType(countType);
+			}
+			property.type = GetPlyType(type);
+			ss >> property.name;
+
+			if (property.type == PLY_INVALID || (property.isList && property.countType == PLY_INVALID))
+			{
+				std::cout << file << ": unknown PLY property type in '" << line << "'\n";
+				return false;
+			}
+			elements.back().properties.push_back(property);
+		}
+	}
+
+	// The offsets of the properties in front of the first list, and the size of records without any
+	for (PlyElement& element : elements)
+	{
+		size_t offset = 0;
+		bool hasList = false;
+		for (PlyProperty& property : element.properties)
+		{
+			property.offset = offset;
+			if (property.isList) hasList = true;
+			offset += GetPlyTypeSize(property.type);
+		}
+		element.recordSize = hasList ? 0 : offset;
+	}
+
+	const unsigned char* elementStart = body;
+	for (const PlyElement& element : elements)
+	{
+		size_t available = end - elementStart;
+
+		if (element.name == "vertex")
+		{
+			const PlyProperty* axes[3] = { nullptr, nullptr, nullptr };
+			for (const PlyProperty& property : element.properties)
+			{
+				if (property.name == "x") axes[0] = &property;
+				if (property.name == "y") axes[1] = &property;
+				if (property.name == "z") axes[2] = &property;
+			}
+			if (!axes[0] || !axes[1] || !axes[2] || element.recordSize == 0 || available / element.recordSize < element.count)
+			{
+				std::cout << file << ": the PLY vertices can not be read\n";
+				return false;
+			}
+
+			// Every record has the same size, so each thread can go straight to its own
+			vertices.resize(element.count);
+			ParallelFor(element.count, progress, [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					const unsigned char* record = elementStart + i * element.recordSize;
+					vertices[i] = glm::vec3(
+						(float)ReadPlyValue(record + axes[0]->offset, axes[0]->type, bigEndian),
+						(float)ReadPlyValue(record + axes[1]->offset, axes[1]->type, bigEndian),
+						(float)ReadPlyValue(record + axes[2]->offset, axes[2]->type, bigEndian));
+				}
+			});
+			elementStart += element.count * element.recordSize;
+		}
+		else if (element.name == "face")
+		{
+			int listIndex = -1;
+			int listCount = 0;
+			for (int i = 0; i < (int)element.properties.size(); i++)
+			{
+				if (!element.properties[i].isList) continue;
+				listCount++;
+				if (element.properties[i].name == "vertex_indices" || element.properties[i].name == "vertex_index") listIndex = i;
+			}
+			if (listIndex == -1)
+			{
+				std::cout << file << ": the PLY faces have no vertex indices\n";
+				return false;
+			}
+
+			const PlyProperty& list = element.properties[listIndex];
+			size_t countSize = GetPlyTypeSize(list.countType);
+			size_t indexSize = GetPlyTypeSize(list.type);
+
+			// Nearly every file only has triangles, which makes every record the same size. The first record that is not a triangle
+			// is always read at its right place, so checking the count of every record finds out if that is true
+			size_t triangleRecordSize = 0;
+			for (const PlyProperty& property : element.properties)
+			{
+				triangleRecordSize += property.isList ? countSize + 3 * indexSize : GetPlyTypeSize(property.type);
+			}
+
+			std::atomic<bool> onlyTriangles{ listCount == 1 && available / triangleRecordSize >= element.count };
+			if (onlyTriangles)
+			{
+				ParallelFor(element.count, nullptr, [&](size_t first, size_t last)
+				{
+					for (size_t i = first; i < last && onlyTriangles; i++)
+					{
+						if (ReadPlyValue(elementStart + i * triangleRecordSize + list.offset, list.countType, bigEndian) != 3.0) onlyTriangles = false;
+					}
+				});
+			}
+
+			std::atomic<bool> validIndices{ true };
+			if (onlyTriangles)
+			{
+				indices.resize(element.count);
+				ParallelFor(element.count, progress, [&](size_t first, size_t last)
+				{
+					for (size_t i = first; i < last; i++)
+					{
+						const unsigned char* corners = elementStart + i * triangleRecordSize + list.offset + countSize;
+						glm::uvec3 triangle;
+						for (int j = 0; j < 3; j++)
+						{
+							double index = ReadPlyValue(corners + j * indexSize, list.type, bigEndian);
+							if (index < 0.0 || index >= (double)vertices.size()) validIndices = false;
+							triangle[j] = (unsigned int)index;
+						}
+						indices[i] = triangle;
+					}
+				});
+				elementStart += element.count * triangleRecordSize;
+			}
+			else
+			{
+				// The records have to be found one after the other, and polygons are split into fans of triangles.
+				// The count comes from the header, but every record holds at least the count of its list
+				indices.reserve(std::min(element.count, available / countSize));
+				for (size_t i = 0; i < element.count; i++)
+				{
+					size_t recordSize;
+					if (!GetPlyRecordSize(element, elementStart, end, bigEndian, recordSize))
+					{
+						std::cout << file << ": the PLY faces end before the end of the file\n";
+						return false;
+					}
+
+					// Skip to the vertex indices
+					const unsigned char* position = elementStart;
+					for (int j = 0; j < listIndex; j++)
+					{
+						const PlyProperty& property = element.properties[j];
+						if (property.isList) position += GetPlyTypeSize(property.countType) + (size_t)ReadPlyValue(position, property.countType, bigEndian) * GetPlyTypeSize(property.type);
+						else position += GetPlyTypeSize(property.type);
+					}
+
+					size_t cornerCount = (size_t)ReadPlyValue(position, list.countType, bigEndian);
+					const unsigned char* corners = position + countSize;
+					auto getCorner = [&](size_t j) -> unsigned int
+					{
+						double index = ReadPlyValue(corners + j * indexSize, list.type, bigEndian);
+						if (index < 0.0 || index >= (double)vertices.size()) validIndices = false;
+						return (unsigned int)index;
+					};
+					for (size_t j = 2; j < cornerCount; j++)
+					{
+						indices.push_back(glm::uvec3(getCorner(0), getCorner(j - 1), getCorner(j)));
+					}
+
+					elementStart += recordSize;
+					if (progress && i % 65536 == 0) *progress = (float)i / (float)element.count;
+				}
+			}
+
+			// An index outside of the vertices would read outside of the buffers on the GPU
+			if (!validIndices)
+			{
+				std::cout << file << ": the PLY faces use vertices that do not exist\n";
+				indices.clear();
+				return false;
+			}
+		}
+		else if (element.recordSize > 0)
+		{
+			if (available / element.recordSize < element.count) break;
+			elementStart += element.count * element.recordSize;
+		}
+		else
+		{
+			for (size_t i = 0; i < element.count; i++)
+			{
+				size_t recordSize;
+				if (!GetPlyRecordSize(element, elementStart, end, bigEndian, recordSize)) break;
+				elementStart += recordSize;
+			}
+		}
+	}
+
+	if (progress) *progress = 1.0f;
+	return true;
+}
+
+bool Geometry::LoadFromStlFile(const char* file, std::atomic<float>* progress)
+{
+	TRACE_SCOPE("Geometry::LoadFromStlFile", file);
+
+	Geometry::file = file;
+	vertices.clear();
+	indices.clear();
+
+	MappedFile mappedFile;
+	if (!mappedFile.Open(file))
+	{
+		return false;
+	}
+	const unsigned char* data = mappedFile.GetData();
+	size_t size = mappedFile.GetSize();
+
+	// An 80 byte header and the triangle count, followed by a normal, three corners and two unused bytes per triangle
+	const size_t headerSize = 84;
+	const size_t recordSize = 50;
+	size_t triangleCount = size >= headerSize ? ReadValue<uint32_t>(data + 80, false) : 0;
+	if (size < headerSize || (size - headerSize) / recordSize < triangleCount)
+	{
+		if (size >= 5 && std::memcmp(data, "solid", 5) == 0) std::cout << file << ": only binary STL files are supported\n";
+		else std::cout << file << ": not a binary STL file\n";
+		return false;
+	}
+
+	// STL does not share corners between triangles, so every triangle gets its own three vertices
+	vertices.resize(triangleCount * 3);
+	indices.resize(triangleCount);
+	ParallelFor(triangleCount, progress, [&](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			// The corners are right after the normal, and always little endian
+			std::memcpy(&vertices[i * 3], data + headerSize + i * recordSize + 12, 3 * sizeof(glm::vec3));
+			indices[i] = glm::uvec3(i * 3, i * 3 + 1, i * 3 + 2);
+		}
+	});
+
+	if (progress) *progress = 1.0f;
+	return true;
+}
+
+// Identifies the version of the source file a cache file was made from
+struct GeometryCacheHeader
+{
+	char magic[4] = { 'R', 'T', 'G', 'C' };
+	uint32_t version = 1;
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+
+	uint64_t nVertices = 0;
+	uint64_t nIndices = 0;
+	uint64_t nBoundingBoxes = 0;
+	uint64_t nRefitOrder = 0;
+	uint64_t nRefitLevels = 0;
+	float builtCost = 0.0f;
+};
+
+static bool GetGeometryCacheFile(const std::string& file, std::string& cacheFile, GeometryCacheHeader& header)
+{
+	std::error_code error;
+	std::filesystem::path path = std::filesystem::weakly_canonical(file, error);
+	if (error) return false;
+
+	header.sourceSize = std::filesystem::file_size(path, error);
+	if (error) return false;
+	header.sourceTime = (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+	if (error) return false;
+
+	// 64 bit FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : path.string())
+	{
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ull;
+	}
+
+	std::ostringstream name;
+	name << "geometrycache/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+	cacheFile = name.str();
 	return true;
 }
 
-void Mesh::UpdateBoundingBoxes()
+bool Geometry::LoadFromCache(const char* file)
 {
-	if (triangles.size() == 0) return;
+	TRACE_SCOPE("Geometry::LoadFromCache", file);
+
+	std::string cacheFile;
+	GeometryCacheHeader expected;
+	if (!GetGeometryCacheFile(file, cacheFile, expected)) return false;
+
+	MappedFile mappedFile;
+	if (!mappedFile.Open(cacheFile.c_str())) return false;
+
+	// Only use it when it was made from the file as it is now
+	GeometryCacheHeader header;
+	if (mappedFile.GetSize() < sizeof(header)) return false;
+	std::memcpy(&header, mappedFile.GetData(), sizeof(header));
+	if (std::memcmp(header.magic, expected.magic, 4) != 0 || header.version != expected.version ||
+		header.sourceSize != expected.sourceSize || header.sourceTime != expected.sourceTime)
+	{
+		return false;
+	}
+
+	size_t size = sizeof(header) +
+		header.nVertices * sizeof(glm::vec3) +
+		header.nIndices * sizeof(glm::uvec3) +
+		header.nBoundingBoxes * sizeof(BoundingBox) +
+		(header.nRefitOrder + header.nRefitLevels) * sizeof(int);
+	if (mappedFile.GetSize() != size) return false;
+
+	const unsigned char* data = mappedFile.GetData() + sizeof(header);
+	auto read = [&data](auto& items, uint64_t count)
+	{
+		items.resize(count);
+		std::memcpy(items.data(), data, count * sizeof(items[0]));
+		data += count * sizeof(items[0]);
+	};
+
+	Geometry::file = file;
+	read(vertices, header.nVertices);
+	read(indices, header.nIndices);
+	read(boundingBoxes, header.nBoundingBoxes);
+	read(refitOrder, header.nRefitOrder);
+	read(refitLevels, header.nRefitLevels);
+	builtCost = header.builtCost;
+	boundingBoxesOutdated = false;
+	return true;
+}
+
+void Geometry::SaveToCache() const
+{
+	TRACE_SCOPE("Geometry::SaveToCache", file);
+
+	std::string cacheFile;
+	GeometryCacheHeader header;
+	if (!GetGeometryCacheFile(file, cacheFile, header)) return;
+
+	header.nVertices = vertices.size();
+	header.nIndices = indices.size();
+	header.nBoundingBoxes = boundingBoxes.size();
+	header.nRefitOrder = refitOrder.size();
+	header.nRefitLevels = refitLevels.size();
+	header.builtCost = builtCost;
+
+	// Written next to it first, so another import never reads half a file
+	std::error_code error;
+	std::filesystem::create_directories("geometrycache", error);
+	std::string temporaryFile = cacheFile + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	bool written;
+	{
+		std::ofstream out(temporaryFile, std::ios::binary);
+		if (!out.is_open())
+		{
+			std::cout << "Failed to write geometry cache: " << cacheFile << "\n";
+			return;
+		}
+
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)vertices.data(), vertices.size() * sizeof(glm::vec3));
+		out.write((const char*)indices.data(), indices.size() * sizeof(glm::uvec3));
+		out.write((const char*)boundingBoxes.data(), boundingBoxes.size() * sizeof(BoundingBox));
+		out.write((const char*)refitOrder.data(), refitOrder.size() * sizeof(int));
+		out.write((const char*)refitLevels.data(), refitLevels.size() * sizeof(int));
+		// Closing writes out the rest of the buffer, which can fail as well when the disk is full
+		out.close();
+		written = !out.fail();
+	}
+
+	if (written) std::filesystem::rename(temporaryFile, cacheFile, error);
+	if (!written || error)
+	{
+		// A half written file would only be left behind for every failed save
+		std::cout << "Failed to write geometry cache: " << cacheFile << "\n";
+		std::filesystem::remove(temporaryFile, error);
+	}
+}
+
+Triangle Geometry::GetTriangle(int index) const
+{
+	const glm::uvec3& triangleIndices = indices[index];
+	return {{ vertices[triangleIndices.x], vertices[triangleIndices.y], vertices[triangleIndices.z] }};
+}
+
+void Geometry::UpdateBoundingBoxes()
+{
+	TRACE_SCOPE("Geometry::UpdateBoundingBoxes");
+
+	if (indices.size() == 0) return;
 
 	boundingBoxes.clear();
 	boundingBoxes.push_back(BoundingBox());
 
 	std::vector<int> boxTriangles;
-	for (int i = 0; i < triangles.size(); i++)
+	for (int i = 0; i < (int)indices.size(); i++)
 	{
-		boundingBoxes[0].GrowToInclude(triangles[i]);
+		boundingBoxes[0].GrowToInclude(GetTriangle(i));
 		boxTriangles.push_back(i);
 	}
 
 	RecursiveBoundingBox(0, boxTriangles);
+
+	UpdateRefitOrder();
+	RefitNodes();
+	builtCost = GetBoundingBoxCost();
+	boundingBoxesOutdated = false;
+}
+
+void Geometry::UpdateRefitOrder()
+{
+	// Children are always added after their parent, so one pass is enough to get the depth of every box
+	std::vector<int> depths(boundingBoxes.size(), 0);
+	int maxDepth = 0;
+	for (int i = 0; i < (int)boundingBoxes.size(); i++)
+	{
+		const BoundingBox& box = boundingBoxes[i];
+		if (box.boundingBoxAIndex != -1) depths[box.boundingBoxAIndex] = depths[i] + 1;
+		if (box.boundingBoxBIndex != -1) depths[box.boundingBoxBIndex] = depths[i] + 1;
+		maxDepth = std::max(maxDepth, depths[i]);
+	}
+
+	// Count the boxes per level, deepest level first
+	refitLevels.assign(maxDepth + 2, 0);
+	for (int depth : depths)
+	{
+		refitLevels[maxDepth - depth + 1]++;
+	}
+	for (int level = 1; level < (int)refitLevels.size(); level++)
+	{
+		refitLevels[level] += refitLevels[level - 1];
+	}
+
+	// Sort the boxes into their levels
+	refitOrder.resize(boundingBoxes.size());
+	std::vector<int> levelCursors(refitLevels.begin(), refitLevels.end() - 1);
+	for (int i = 0; i < (int)boundingBoxes.size(); i++)
+	{
+		refitOrder[levelCursors[maxDepth - depths[i]]++] = i;
+	}
+}
+
+void Geometry::RefitNodes()
+{
+	// Children are always stored after their parent, so going backwards visits every child before its parent
+	for (int i = (int)boundingBoxes.size() - 1; i >= 0; i--)
+	{
+		BoundingBox& box = boundingBoxes[i];
+
+		if (box.boundingBoxAIndex == -1 || box.boundingBoxBIndex == -1)
+		{
+			if (box.triangleIndex != -1)
+			{
+				box.min = glm::vec3(std::numeric_limits<float>::infinity());
+				box.max = glm::vec3(-std::numeric_limits<float>::infinity());
+				box.GrowToInclude(GetTriangle(box.triangleIndex));
+			}
+
+			box.subtreeSurfaceArea = box.SurfaceArea();
+			continue;
+		}
+
+		const BoundingBox& boxA = boundingBoxes[box.boundingBoxAIndex];
+		const BoundingBox& boxB = boundingBoxes[box.boundingBoxBIndex];
+
+		box.min = glm::min(boxA.min, boxB.min);
+		box.max = glm::max(boxA.max, boxB.max);
+		box.subtreeSurfaceArea = box.SurfaceArea() + boxA.subtreeSurfaceArea + boxB.subtreeSurfaceArea;
+	}
+}
+
+bool Geometry::RefitBoundingBoxes(float rebuildThreshold)
+{
+	if (boundingBoxes.size() == 0) return false;
+
+	RefitNodes();
+	boundingBoxesOutdated = false;
+
+	// The tree keeps its shape when refitting, so heavily deformed meshes end up with big overlapping boxes
+	if (GetBoundingBoxCost() > builtCost * rebuildThreshold)
+	{
+		UpdateBoundingBoxes();
+		return true;
+	}
+
+	return false;
+}
+
+float Geometry::GetBoundingBoxCost() const
+{
+	if (boundingBoxes.size() == 0) return 0.0f;
+
+	float rootSurfaceArea = boundingBoxes[0].SurfaceArea();
+	if (rootSurfaceArea <= 0.0f) return 0.0f;
+
+	return boundingBoxes[0].subtreeSurfaceArea / rootSurfaceArea;
+}
+
+uint64_t Geometry::GetTopologyHash() const
+{
+	auto mix = [](uint64_t x)
+	{
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ull;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	};
+
+	// Building the bounding boxes sorts the triangles, so add up their hashes instead of hashing them in order
+	uint64_t hash = mix(vertices.size());
+	for (const glm::uvec3& triangle : indices)
+	{
+		hash += mix(mix(mix(triangle.x) ^ triangle.y) ^ triangle.z);
+	}
+	return hash;
 }
\ No newline at end of file
@@ -14,6 +14,9 @@
 #include <vector>
 #include <fstream>
 #include <limits>
+#include <memory>
+#include <atomic>
+#include "Trace.h"
 
 struct Material
 {
@@ -51,9 +54,18 @@ struct Sphere
 	Material material;
 };
 
+// The corners of a single triangle, the GPU gets the triangles as indexed vertices instead
 struct Triangle
 {
-	glm::vec4 p[3];
+	glm::vec3 p[3];
+};
+
+// A triangle with its edges and unnormalized normal already calculated, the normal is stored in the w components
+struct PrecomputedTriangle
+{
+	glm::vec4 a;
+	glm::vec4 edgeAB;
+	glm::vec4 edgeAC;
 };
 
 struct BoundingBox
@@ -67,16 +79,68 @@ struct BoundingBox
 	int triangleIndex = -1;
 	int boundingBoxAIndex = -1;
 	int boundingBoxBIndex = -1;
-	float padding3;
+	// The surface area of this box and all the boxes below it, used to measure the quality of the tree
+	float subtreeSurfaceArea = 0.0f;
 
 	void GrowToInclude(const glm::vec3& point);
 	void GrowToInclude(const Triangle& triangle);
+	float SurfaceArea() const;
 };
 
-class Mesh
+// The triangles and bounding boxes of a model, shared by every mesh that uses the same model
+class Geometry
 {
 	void RecursiveBoundingBox(int boundingBoxIndex, std::vector<int>& triangleIndices);
+	// Sorts the bounding boxes by depth so they can be refitted level by level
+	void UpdateRefitOrder();
+	// Recalculates the bounds of every bounding box from its children, starting at the leaves
+	void RefitNodes();
+
+public:
+	// The file the geometry was loaded from
+	std::string file;
+
+	std::vector<glm::vec3> vertices;
+	// Three vertex indices per triangle
+	std::vector<glm::uvec3> indices;
+	std::vector<BoundingBox> boundingBoxes;
+
+	// The bounding box indices sorted from the deepest level to the root
+	std::vector<int> refitOrder;
+	// The start of every level in the refit order, followed by the end of the last level
+	std::vector<int> refitLevels;
+	// The cost of the bounding boxes right after they were built
+	float builtCost = 0.0f;
+	// Set when the bounding boxes were refitted on the GPU and the ones here are outdated
+	bool boundingBoxesOutdated = false;
+
+	// Loads the geometry from a .obj file, and removes any prexisting triangles. The progress is set to how much of the file has been read, from 0 to 1
+	bool LoadFromObjectFile(const char* file, std::atomic<float>* progress = nullptr);
+	// Loads the geometry from a binary little or big endian .ply file, converting the records on every core
+	bool LoadFromPlyFile(const char* file, std::atomic<float>* progress = nullptr);
+	// Loads the geometry from a binary .stl file, converting the records on every core. Every triangle gets its own vertices
+	bool LoadFromStlFile(const char* file, std::atomic<float>* progress = nullptr);
+	// Loads the geometry from an .obj, .ply or .stl file depending on its extention
+	bool LoadFromFile(const char* file, std::atomic<float>* progress = nullptr);
+	// Loads the triangles and bounding boxes that were saved for the file, as long as the file did not change since then
+	bool LoadFromCache(const char* file);
+	// Saves the triangles and bounding boxes in the geometry cache, so the next load of the file can skip the parsing and building
+	void SaveToCache() const;
+	// Gets the corners of a triangle from the vertices
+	Triangle GetTriangle(int index) const;
+	// Pre-computes the bounding boxes of the triangles to speed up rendering. BY A LOT
+	void UpdateBoundingBoxes();
+	// Updates the bounding boxes to fit the current triangles without changing the tree, rebuilds them when the tree got too slow. Returns true when the tree was rebuilt
+	bool RefitBoundingBoxes(float rebuildThreshold);
+	// The surface area heuristic cost of the bounding boxes, relative to the root box
+	float GetBoundingBoxCost() const;
+	// A hash of the triangles that does not depend on their order, so the bounding boxes built for one file can be refitted to a reload with the same triangles
+	uint64_t GetTopologyHash() const;
+};
 
+// An instance of a geometry with its own transform and material
+class Mesh
+{
 public:
 	glm::vec3 position = glm::vec3(0.0f);
 	glm::vec3 rotation = glm::vec3(0.0f);
@@ -84,16 +148,11 @@ public:
 	glm::mat4 localToWorldMatrix = glm::mat4(1.0f);
 	glm::mat4 modelWorldToLocalMatrix = glm::mat4(1.0f);
 
-	std::vector<Triangle> triangles;
-	std::vector<BoundingBox> boundingBoxes;
+	std::shared_ptr<Geometry> geometry;
 	Material material;
 
 	// Calculates the transform matrix based on the position, rotation and scale;
 	void UpdateTransformMatrix();
-	// Loads the mesh from a .obj file, and removes any prexisting triangles
-	bool LoadFromObjectFile(const char* file);
-	// Pre-computes the bounding boxes of the triangles to speed up rendering. BY A LOT
-	void UpdateBoundingBoxes();
 };
 
 struct ShaderReadyMesh
@@ -107,6 +166,12 @@ struct ShaderReadyMesh
 	int boundingBoxIndex;
 	int nBoundingBoxes;
 
+	// The quantized vertices are stored relative to the bounds of the geometry
+	glm::vec3 quantizationMin = glm::vec3(0.0f);
+	int vertexIndex;
+	glm::vec3 quantizationScale = glm::vec3(0.0f);
+	int nVertices;
+
 	Material material;
 };
 
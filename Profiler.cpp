@@ -0,0 +1,149 @@
+#include "Profiler.h"
+
+Profiler::Section& Profiler::GetSection(const char* name, bool gpu)
+{
+	auto it = m_sectionIndices.find(name);
+	if (it != m_sectionIndices.end())
+	{
+		return m_sections[it->second];
+	}
+
+	Section section;
+	section.name = name;
+	section.gpu = gpu;
+	if (gpu)
+	{
+		glGenQueries(QUERIES_IN_FLIGHT, section.queries);
+	}
+
+	m_sectionIndices[name] = (int)m_sections.size();
+	m_sections.push_back(section);
+	return m_sections.back();
+}
+
+void Profiler::AddToHistory(Section& section, float ms)
+{
+	if (section.history.size() < HISTORY_SIZE)
+	{
+		section.history.push_back(ms);
+		return;
+	}
+
+	section.history[section.historyOffset] = ms;
+	section.historyOffset = (section.historyOffset + 1) % HISTORY_SIZE;
+}
+
+void Profiler::Delete()
+{
+	for (Section& section : m_sections)
+	{
+		if (section.gpu) glDeleteQueries(QUERIES_IN_FLIGHT, section.queries);
+	}
+	m_sections.clear();
+	m_sectionIndices.clear();
+}
+
+void Profiler::NewFrame()
+{
+	auto now = std::chrono::high_resolution_clock::now();
+	if (enabled && m_frame > 0)
+	{
+		AddToHistory(GetSection("Frame", false), std::chrono::duration<float, std::milli>(now - m_frameStart).count());
+	}
+	m_frameStart = now;
+	m_frame++;
+
+	// Read every result that is ready, in the order the queries were made
+	for (Section& section : m_sections)
+	{
+		if (!section.gpu) continue;
+
+		while (section.pending[section.nextResult])
+		{
+			GLuint query = section.queries[section.nextResult];
+			GLint available = 0;
+			glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) break;
+
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+			AddToHistory(section, nanoseconds / 1000000.0f);
+
+			section.pending[section.nextResult] = false;
+			section.nextResult = (section.nextResult + 1) % QUERIES_IN_FLIGHT;
+		}
+	}
+}
+
+void Profiler::BeginGPU(const char* name)
+{
+	if (!enabled) return;
+
+	Section& section = GetSection(name, true);
+
+	// Skip this frame if the GPU is so far behind that the query is still in use
+	if (section.pending[section.nextQuery])
+	{
+		section.current = -1;
+		return;
+	}
+
+	section.current = section.nextQuery;
+	section.nextQuery = (section.nextQuery + 1) % QUERIES_IN_FLIGHT;
+	glBeginQuery(GL_TIME_ELAPSED, section.queries[section.current]);
+}
+
+void Profiler::EndGPU(const char* name)
+{
+	if (!enabled) return;
+
+	Section& section = GetSection(name, true);
+	if (section.current < 0) return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	section.pending[section.current] = true;
+	section.current = -1;
+}
+
+void Profiler::BeginCPU(const char* name)
+{
+	if (!enabled) return;
+
+	GetSection(name, false).cpuStart = std::chrono::high_resolution_clock::now();
+}
+
+void Profiler::EndCPU(const char* name)
+{
+	if (!enabled) return;
+
+	Section& section = GetSection(name, false);
+	AddToHistory(section, std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - section.cpuStart).count());
+}
+
+void Profiler::DrawUI()
+{
+	ImGui::Begin("Profiler");
+
+	ImGui::Checkbox("enabled", &enabled);
+
+	for (const Section& section : m_sections)
+	{
+		if (section.history.empty()) continue;
+
+		// The percentiles of the history
+		std::vector<float> sorted = section.history;
+		std::sort(sorted.begin(), sorted.end());
+		float p50 = sorted[(sorted.size() - 1) * 50 / 100];
+		float p95 = sorted[(sorted.size() - 1) * 95 / 100];
+		float p99 = sorted[(sorted.size() - 1) * 99 / 100];
+
+		char overlay[96];
+		snprintf(overlay, sizeof(overlay), "p50 %.2fms  p95 %.2fms  p99 %.2fms", p50, p95, p99);
+
+		std::string label = section.name + (section.gpu ? " (GPU)" : " (CPU)");
+		ImGui::Text("%s", label.c_str());
+		ImGui::PlotLines(("##" + label).c_str(), section.history.data(), (int)section.history.size(), section.historyOffset, overlay, 0.0f, sorted.back() * 1.2f, ImVec2(0, 50));
+	}
+
+	ImGui::End();
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+#ifndef PROFILER_CLASS_H
+#define PROFILER_CLASS_H
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "imgui.h"
+
+// Measures named sections of every frame, on the GPU with timer queries and on the CPU with a clock, and shows them in an ImGui window
+class Profiler
+{
+	// Every GPU section has this many queries, so a result is only read once the GPU is a few frames further and never stalls
+	static const int QUERIES_IN_FLIGHT = 4;
+	// The amount of frames kept for the graphs and percentiles
+	static const int HISTORY_SIZE = 240;
+
+	struct Section
+	{
+		std::string name;
+		bool gpu = false;
+
+		GLuint queries[QUERIES_IN_FLIGHT] = {};
+		bool pending[QUERIES_IN_FLIGHT] = {};
+		// The query the next frame uses, and the oldest query that has not been read yet
+		int nextQuery = 0;
+		int nextResult = 0;
+		// The query the current frame uses, or -1 if it was skipped because every query was still in use
+		int current = -1;
+		std::chrono::high_resolution_clock::time_point cpuStart;
+
+		// Milliseconds, as a ring buffer starting at historyOffset
+		std::vector<float> history;
+		int historyOffset = 0;
+	};
+
+	std::vector<Section> m_sections;
+	std::unordered_map<std::string, int> m_sectionIndices;
+	int m_frame = 0;
+	std::chrono::high_resolution_clock::time_point m_frameStart;
+
+	Section& GetSection(const char* name, bool gpu);
+	static void AddToHistory(Section& section, float ms);
+
+public:
+	// Nothing is measured while this is off
+	bool enabled = true;
+
+	void Delete();
+
+	// Reads the GPU results that are ready and starts a new frame, call once at the start of every frame
+	void NewFrame();
+
+	// GPU sections can not be nested, only one timer query can run at once
+	void BeginGPU(const char* name);
+	void EndGPU(const char* name);
+	void BeginCPU(const char* name);
+	void EndCPU(const char* name);
+
+	// The rolling graphs and 50th, 95th and 99th percentiles of every section
+	void DrawUI();
+};
+
+// Measures the CPU time until the end of the scope
+class ProfileScope
+{
+	Profiler& m_profiler;
+	const char* m_name;
+
+public:
+	ProfileScope(Profiler& profiler, const char* name) : m_profiler(profiler), m_name(name) { m_profiler.BeginCPU(m_name); }
+	~ProfileScope() { m_profiler.EndCPU(m_name); }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,565 @@
+#include "RenderServer.h"
+#include "HeadlessApp.h"
+#include "Json.h"
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+
+// Scene documents are small, anything bigger than this is not a job
+const size_t MAX_REQUEST_SIZE = 16 << 20;
+// Where the images of the jobs are saved, a job can only pick a path within it
+const std::string OUTPUT_DIRECTORY = "renders/server/";
+
+static const char* GetStateName(RenderJobState state)
+{
+	switch (state)
+	{
+	case JOB_QUEUED: return "queued";
+	case JOB_RENDERING: return "rendering";
+	case JOB_DONE: return "done";
+	case JOB_FAILED: return "failed";
+	case JOB_CANCELLED: return "cancelled";
+	default: return "";
+	}
+}
+
+static const char* GetStatusText(int status)
+{
+	switch (status)
+	{
+	case 200: return "OK";
+	case 201: return "Created";
+	case 400: return "Bad Request";
+	case 404: return "Not Found";
+	case 405: return "Method Not Allowed";
+	case 409: return "Conflict";
+	default: return "Internal Server Error";
+	}
+}
+
+// Reads the request line, the headers and the body of one request
+static bool ReadRequest(Socket& socket, std::string& method, std::string& path, std::string& body)
+{
+	std::string header;
+	char buffer[4096];
+	size_t headerEnd;
+	while ((headerEnd = header.find("\r\n\r\n")) == std::string::npos)
+	{
+		if (header.size() > MAX_REQUEST_SIZE) return false;
+
+		int received = socket.Receive(buffer, sizeof(buffer));
+		if (received <= 0) return false;
+		header.append(buffer, received);
+	}
+
+	// Part of the body might have arrived with the headers
+	body = header.substr(headerEnd + 4);
+	header.resize(headerEnd);
+
+	std::istringstream lines(header);
+	std::string line;
+	std::getline(lines, line);
+	std::istringstream requestLine(line);
+	requestLine >> method >> path;
+	if (method.empty() || path.empty()) return false;
+
+	size_t length = 0;
+	while (std::getline(lines, line))
+	{
+		size_t colon = line.find(':');
+		if (colon == std::string::npos) continue;
+
+		// Header names are not case sensitive
+		std::string name = line.substr(0, colon);
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		if (name == "content-length") length = (size_t)std::strtoull(line.c_str() + colon + 1, nullptr, 10);
+	}
+	if (length > MAX_REQUEST_SIZE) return false;
+
+	size_t received = std::min(body.size(), length);
+	body.resize(length);
+	return received == length || socket.ReceiveAll(&body[received], length - received);
+}
+
+static bool SendResponse(Socket& socket, int status, const char* contentType, const void* data, size_t size)
+{
+	std::ostringstream header;
+	header << "HTTP/1.1 " << status << " " << GetStatusText(status) << "\r\n";
+	header << "Content-Type: " << contentType << "\r\n";
+	header << "Content-Length: " << size << "\r\n";
+	// The previews change all the time
+	header << "Cache-Control: no-store\r\n";
+	header << "Connection: close\r\n\r\n";
+
+	std::string text = header.str();
+	return socket.SendAll(text.data(), text.size()) && socket.SendAll(data, size);
+}
+
+static bool SendJSON(Socket& socket, int status, const std::string& json)
+{
+	return SendResponse(socket, status, "application/json", json.data(), json.size());
+}
+
+static bool SendError(Socket& socket, int status, const std::string& error)
+{
+	return SendJSON(socket, status, "{\"error\": " + JsonValue::Quote(error) + "}\n");
+}
+
+static glm::vec3 ReadVector(const JsonValue& value, const glm::vec3& fallback)
+{
+	if (value.Size() != 3) return fallback;
+	return glm::vec3((float)value[0].AsNumber(fallback.x), (float)value[1].AsNumber(fallback.y), (float)value[2].AsNumber(fallback.z));
+}
+
+int RenderServer::Serve(int port)
+{
+	if (!m_listener.Listen(port, !remoteAccess))
+	{
+		std::cout << "Failed to listen on port " << port << "\n";
+		return 1;
+	}
+
+	// The OpenGL context belongs to this thread, so the jobs render here and the requests are answered on another one
+	HeadlessApp app(64, 64);
+	// It runs for as long as the process does
+	std::thread(&RenderServer::ServeHTTP, this).detach();
+	std::cout << "Render server listening on port " << port << "\n";
+
+	while (true)
+	{
+		std::shared_ptr<RenderJob> job = TakeJob();
+		Render(app, *job);
+	}
+}
+
+void RenderServer::Render(HeadlessApp& app, RenderJob& job)
+{
+	TRACE_SCOPE("RenderServer::Render", job.name);
+	std::cout << "Rendering " << job.name << " at " << job.width << "x" << job.height << "\n";
+
+	// Only the camera changed when everything else is the same as the last job, then nothing has to be loaded
+	SceneDocument scene = job.document;
+	scene.cameraPosition = glm::vec3(0.0f);
+	scene.cameraRotation = glm::vec3(0.0f);
+	std::string sceneKey = SceneFile::Write(scene);
+	if (sceneKey != m_loadedScene)
+	{
+		m_loadedScene.clear();
+		if (!app.LoadSceneDocument(job.document))
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			job.state = JOB_FAILED;
+			job.error = "the geometry of the scene could not be loaded";
+			return;
+		}
+		m_loadedScene = sceneKey;
+	}
+	app.SetCamera(job.document.cameraPosition, job.document.cameraRotation);
+	app.SetResolution(job.width, job.height);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	auto lastPreview = start;
+	double secondsPerFrame = 0.0;
+	int framesDone = 0;
+	bool cancelled = false;
+
+	while (true)
+	{
+		// Slices of about a tenth of a second, so cancelling and the previews never wait long
+		int slice = secondsPerFrame > 0.0 ? std::max(1, std::min(64, (int)(0.1 / secondsPerFrame))) : 1;
+		if (job.frames > 0) slice = std::min(slice, job.frames - framesDone);
+
+		auto sliceStart = std::chrono::high_resolution_clock::now();
+		app.RenderFrames(slice, framesDone == 0);
+		auto now = std::chrono::high_resolution_clock::now();
+
+		secondsPerFrame = std::chrono::duration<double>(now - sliceStart).count() / slice;
+		framesDone += slice;
+		double elapsed = std::chrono::duration<double>(now - start).count();
+		bool finished = (job.frames > 0 && framesDone >= job.frames) || (job.seconds > 0.0 && elapsed >= job.seconds);
+
+		// The last preview is the final image, taken below
+		std::shared_ptr<const std::vector<unsigned char>> preview;
+		if (!finished && std::chrono::duration<double>(now - lastPreview).count() >= previewInterval)
+		{
+			int width, height;
+			std::vector<float> pixels = app.GetFrame(width, height);
+			preview = std::make_shared<const std::vector<unsigned char>>(ImageWriter::EncodeJPG(width, height, std::move(pixels), 90));
+			lastPreview = std::chrono::high_resolution_clock::now();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			job.framesDone = framesDone;
+			job.secondsElapsed = elapsed;
+			if (preview) job.preview = preview;
+			cancelled = job.cancel;
+		}
+		if (finished || cancelled) break;
+	}
+
+	if (cancelled)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		job.state = JOB_CANCELLED;
+		std::cout << "Cancelled " << job.name << " after " << framesDone << " frames\n";
+		return;
+	}
+
+	int width, height;
+	std::vector<float> pixels = app.GetFrame(width, height);
+	auto preview = std::make_shared<const std::vector<unsigned char>>(ImageWriter::EncodeJPG(width, height, std::vector<float>(pixels), 90));
+
+	// The image is only served once it is saved, so it is saved right away instead of on the writer thread
+	std::filesystem::path directory = std::filesystem::path(job.output).parent_path();
+	std::error_code error;
+	if (!directory.empty()) std::filesystem::create_directories(directory, error);
+	bool saved = ImageWriter::WriteNow(job.output, ImageWriter::GetFormat(job.output), width, height, std::move(pixels));
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	job.preview = preview;
+	if (saved)
+	{
+		job.state = JOB_DONE;
+		std::cout << "Finished " << job.name << ": " << framesDone << " frames in " << job.secondsElapsed << "s, saved " << job.output << "\n";
+	}
+	else
+	{
+		job.state = JOB_FAILED;
+		job.error = "the image could not be saved to " + job.output;
+		std::cout << "Failed to save " << job.output << "\n";
+	}
+}
+
+std::shared_ptr<RenderJob> RenderServer::TakeJob()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		// The jobs are in the order they were submitted, so the first of the highest priority has waited the longest
+		std::shared_ptr<RenderJob> next;
+		for (const std::shared_ptr<RenderJob>& job : m_jobs)
+		{
+			if (job->state == JOB_QUEUED && (!next || job->priority > next->priority)) next = job;
+		}
+
+		if (next)
+		{
+			next->state = JOB_RENDERING;
+			return next;
+		}
+		m_condition.wait(lock);
+	}
+}
+
+void RenderServer::EvictJobs()
+{
+	int finished = 0;
+	for (const std::shared_ptr<RenderJob>& job : m_jobs)
+	{
+		if (job->state != JOB_QUEUED && job->state != JOB_RENDERING) finished++;
+	}
+
+	// The jobs are in the order they were submitted, so the oldest come first
+	for (int i = 0; i < (int)m_jobs.size() && finished > std::max(retainedJobs, 0); i++)
+	{
+		if (m_jobs[i]->state == JOB_QUEUED || m_jobs[i]->state == JOB_RENDERING) continue;
+
+		m_jobs.erase(m_jobs.begin() + i);
+		finished--;
+		i--;
+	}
+}
+
+std::shared_ptr<RenderJob> RenderServer::FindJob(int id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (const std::shared_ptr<RenderJob>& job : m_jobs)
+	{
+		if (job->id == id) return job;
+	}
+	return nullptr;
+}
+
+bool RenderServer::ReadJob(const std::string& body, RenderJob& job, std::string& error)
+{
+	JsonValue root;
+	try
+	{
+		root = JsonValue::Parse(body);
+	}
+	catch (const std::string& parseError)
+	{
+		error = parseError;
+		return false;
+	}
+	if (!root.IsObject())
+	{
+		error = "the job has to be a JSON object";
+		return false;
+	}
+
+	// Either the file of a scene or the document itself
+	const std::string& sceneFile = root["scene"].AsString();
+	if (root["document"].IsObject())
+	{
+		if (!SceneFile::Read(root["document"], job.document, "document"))
+		{
+			error = "the document is not a scene";
+			return false;
+		}
+
+		// The files a document loads come from the client as well
+		if (!SceneFile::HasSafePaths(job.document, error)) return false;
+	}
+	else if (!sceneFile.empty())
+	{
+		if (!SceneFile::IsSafePath(sceneFile))
+		{
+			error = "the scene has to be a relative path without ..: " + sceneFile;
+			return false;
+		}
+		if (!SceneFile::Load(sceneFile, job.document))
+		{
+			error = "the scene could not be read: " + sceneFile;
+			return false;
+		}
+	}
+	else
+	{
+		error = "the job needs a scene file or a document";
+		return false;
+	}
+
+	// The camera of the scene, unless the job has its own
+	const JsonValue& camera = root["camera"];
+	job.document.cameraPosition = ReadVector(camera["position"], job.document.cameraPosition);
+	job.document.cameraRotation = ReadVector(camera["rotation"], job.document.cameraRotation);
+
+	job.name = root["name"].AsString();
+	if (job.name.empty() && !sceneFile.empty()) job.name = sceneFile;
+	job.priority = root["priority"].AsInt(0);
+	job.width = root["width"].AsInt(job.width);
+	job.height = root["height"].AsInt(job.height);
+	if (job.width <= 0 || job.height <= 0 || job.width > 16384 || job.height > 16384)
+	{
+		error = "the resolution is out of range";
+		return false;
+	}
+	// Both are compiled into the raytrace shader, so too many would keep the GPU busy for longer than the driver allows
+	if (job.document.maxBounces < 1 || job.document.maxBounces > 64 || job.document.samplesPerPixel < 1 || job.document.samplesPerPixel > 256)
+	{
+		error = "max_bounces has to be 1 to 64 and samples_per_pixel 1 to 256";
+		return false;
+	}
+
+	// A sample budget is rounded up to whole frames
+	job.frames = root["frames"].AsInt(0);
+	int samples = root["samples"].AsInt(0);
+	int samplesPerFrame = job.document.samplesPerPixel;
+	if (samples > 0) job.frames = (int)(((long long)samples + samplesPerFrame - 1) / samplesPerFrame);
+	job.seconds = root["seconds"].AsNumber(0.0);
+	if (job.frames < 0 || job.seconds < 0.0)
+	{
+		error = "the budget can not be negative";
+		return false;
+	}
+	if (job.frames == 0 && job.seconds == 0.0) job.frames = 256;
+
+	// Relative to the output directory, so a job can not overwrite anything else
+	const std::string& output = root["output"].AsString();
+	if (!output.empty())
+	{
+		if (!SceneFile::IsSafePath(output))
+		{
+			error = "the output has to be a relative path without ..: " + output;
+			return false;
+		}
+		job.output = OUTPUT_DIRECTORY + output;
+	}
+	return true;
+}
+
+std::string RenderServer::WriteStatus(const RenderJob& job)
+{
+	std::ostringstream json;
+	json << "{\"id\": " << job.id;
+	json << ", \"name\": " << JsonValue::Quote(job.name);
+	json << ", \"state\": \"" << GetStateName(job.state) << "\"";
+	json << ", \"priority\": " << job.priority;
+	json << ", \"width\": " << job.width << ", \"height\": " << job.height;
+	json << ", \"frames\": " << job.frames << ", \"seconds\": " << job.seconds;
+	json << ", \"frames_done\": " << job.framesDone;
+	json << ", \"samples_done\": " << job.framesDone * std::max(1, job.document.samplesPerPixel);
+	json << ", \"elapsed\": " << job.secondsElapsed;
+	json << ", \"output\": " << JsonValue::Quote(job.output);
+	if (!job.error.empty()) json << ", \"error\": " << JsonValue::Quote(job.error);
+	json << "}";
+	return json.str();
+}
+
+void RenderServer::ServeHTTP()
+{
+	while (true)
+	{
+		Socket socket = m_listener.Accept();
+		if (!socket.IsOpen()) continue;
+
+		// A client that stops sending or reading should not hold up everyone else for long
+		socket.SetTimeout(10.0);
+		HandleRequest(socket);
+	}
+}
+
+void RenderServer::HandleRequest(Socket& socket)
+{
+	std::string method, path, body;
+	if (!ReadRequest(socket, method, path, body))
+	{
+		SendError(socket, 400, "malformed request");
+		return;
+	}
+
+	// The query is not used by anything
+	path = path.substr(0, path.find('?'));
+	std::vector<std::string> parts;
+	std::stringstream pathStream(path);
+	std::string part;
+	while (std::getline(pathStream, part, '/'))
+	{
+		if (!part.empty()) parts.push_back(part);
+	}
+
+	if (parts.empty() || parts[0] != "jobs" || parts.size() > 3)
+	{
+		SendError(socket, 404, "unknown path " + path);
+		return;
+	}
+
+	if (parts.size() == 1)
+	{
+		if (method == "GET")
+		{
+			// Sent after unlocking, a slow client must not hold up the renderer
+			std::string json = "[\n";
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				for (int i = 0; i < (int)m_jobs.size(); i++)
+				{
+					json += "\t" + WriteStatus(*m_jobs[i]) + (i + 1 < (int)m_jobs.size() ? ",\n" : "\n");
+				}
+			}
+			json += "]\n";
+			SendJSON(socket, 200, json);
+		}
+		else if (method == "POST")
+		{
+			// The scene is read right away, so a bad job is refused instead of failing later
+			auto job = std::make_shared<RenderJob>();
+			std::string error;
+			if (!ReadJob(body, *job, error))
+			{
+				SendError(socket, 400, error);
+				return;
+			}
+
+			int id;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				id = job->id = m_nextID++;
+				if (job->name.empty()) job->name = "job " + std::to_string(id);
+				if (job->output.empty()) job->output = OUTPUT_DIRECTORY + "job-" + std::to_string(id) + ".png";
+				m_jobs.push_back(job);
+				EvictJobs();
+			}
+			m_condition.notify_one();
+			std::cout << "Queued " << job->name << " as job " << id << "\n";
+			SendJSON(socket, 201, "{\"id\": " + std::to_string(id) + "}\n");
+		}
+		else SendError(socket, 405, "only GET and POST work on /jobs");
+		return;
+	}
+
+	std::shared_ptr<RenderJob> job = FindJob(std::atoi(parts[1].c_str()));
+	if (!job)
+	{
+		SendError(socket, 404, "no job " + parts[1]);
+		return;
+	}
+
+	if (parts.size() == 2)
+	{
+		std::string json;
+		if (method == "GET")
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			json = WriteStatus(*job) + "\n";
+		}
+		else if (method == "DELETE")
+		{
+			// A job that is rendering stops after its current slice
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (job->state == JOB_QUEUED) job->state = JOB_CANCELLED;
+			else if (job->state == JOB_RENDERING) job->cancel = true;
+			json = WriteStatus(*job) + "\n";
+		}
+		else
+		{
+			SendError(socket, 405, "only GET and DELETE work on a job");
+			return;
+		}
+
+		// Sent after unlocking, like the list of jobs
+		SendJSON(socket, 200, json);
+		return;
+	}
+
+	if (method != "GET")
+	{
+		SendError(socket, 405, "only GET works on " + parts[2]);
+		return;
+	}
+
+	if (parts[2] == "preview.jpg")
+	{
+		std::shared_ptr<const std::vector<unsigned char>> preview;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			preview = job->preview;
+		}
+		if (!preview || preview->empty()) SendError(socket, 404, "there is no preview yet");
+		else SendResponse(socket, 200, "image/jpeg", preview->data(), preview->size());
+	}
+	else if (parts[2] == "image")
+	{
+		std::string output;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (job->state == JOB_DONE) output = job->output;
+		}
+		if (output.empty())
+		{
+			SendError(socket, 409, "the job is not done");
+			return;
+		}
+
+		std::ifstream in(output, std::ios::binary);
+		if (!in.is_open())
+		{
+			SendError(socket, 404, "the image is gone: " + output);
+			return;
+		}
+		std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+		const char* contentType = "application/octet-stream";
+		ImageFormat format = ImageWriter::GetFormat(output);
+		if (format == FORMAT_JPG) contentType = "image/jpeg";
+		else if (format == FORMAT_PNG16) contentType = "image/png";
+		SendResponse(socket, 200, contentType, data.data(), data.size());
+	}
+	else SendError(socket, 404, "unknown path " + path);
+}
\ No newline at end of file
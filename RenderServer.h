@@ -0,0 +1,94 @@
+#pragma once
+#ifndef RENDER_SERVER_CLASS_H
+#define RENDER_SERVER_CLASS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include "SceneFile.h"
+#include "Socket.h"
+
+enum RenderJobState : int
+{
+	JOB_QUEUED,
+	JOB_RENDERING,
+	JOB_DONE,
+	JOB_FAILED,
+	JOB_CANCELLED
+};
+
+class HeadlessApp;
+
+// A render submitted to the server. What was submitted never changes afterwards, the rest is only touched with the lock of the server held
+struct RenderJob
+{
+	int id = 0;
+	// Higher goes first, jobs with the same priority go in the order they were submitted
+	int priority = 0;
+	std::string name;
+	SceneDocument document;
+	int width = 1280, height = 720;
+	// The job is done once either budget runs out, a budget of 0 is no limit
+	int frames = 0;
+	double seconds = 0.0;
+	std::string output;
+
+	RenderJobState state = JOB_QUEUED;
+	bool cancel = false;
+	int framesDone = 0;
+	double secondsElapsed = 0.0;
+	std::string error;
+	// The latest progress as a jpg, replaced while rendering
+	std::shared_ptr<const std::vector<unsigned char>> preview;
+};
+
+// Keeps a headless renderer running and renders the jobs that are submitted over a small HTTP API, one at a time.
+// The scene, geometry and compiled shaders stay loaded between jobs, so a job only pays for what changed since the last one.
+//   POST   /jobs                  submit a job, returns its id
+//   GET    /jobs                  the status of every job
+//   GET    /jobs/<id>             the status of a job
+//   GET    /jobs/<id>/preview.jpg the latest progress of a job
+//   GET    /jobs/<id>/image       the saved image of a finished job
+//   DELETE /jobs/<id>             cancel a job
+// The output of a job is a path within renders/server/
+class RenderServer
+{
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<std::shared_ptr<RenderJob>> m_jobs;
+	int m_nextID = 1;
+
+	Socket m_listener;
+	// What the renderer has loaded of the scene of the last job, so the next job with the same scene does not load it again
+	std::string m_loadedScene;
+
+	// Renders a job that was taken from the queue, on the thread of the OpenGL context
+	void Render(HeadlessApp& app, RenderJob& job);
+
+	// Answers the connections one at a time, on its own thread
+	void ServeHTTP();
+	void HandleRequest(Socket& socket);
+	// Fills in the job from the JSON of a request, the error says what is wrong with it otherwise
+	bool ReadJob(const std::string& body, RenderJob& job, std::string& error);
+	// Waits for the queued job with the highest priority
+	std::shared_ptr<RenderJob> TakeJob();
+	std::shared_ptr<RenderJob> FindJob(int id);
+	// Drops the oldest jobs that are done, failed or cancelled once there are more than retainedJobs of them, with the lock held
+	void EvictJobs();
+	static std::string WriteStatus(const RenderJob& job);
+
+public:
+	// Seconds between the previews of a job, taking one costs a download and a jpg encode
+	double previewInterval = 1.0;
+	// Only connections from this machine are accepted unless set
+	bool remoteAccess = false;
+	// How many finished jobs are kept for their status and image, older ones are forgotten. Their images stay on disk
+	int retainedJobs = 64;
+
+	// Renders jobs until the process ends, only returns when the port can not be listened on
+	int Serve(int port);
+};
+
+#endif
\ No newline at end of file
@@ -1,9 +1,14 @@
 #include "Renderer.h"
+#include <cstring>
 
-void Renderer::Initialize(int width, int height)
+// The frames a window traces the whole viewport for before it freezes what is outside of a region
+const int FROZEN_FULL_FRAMES = 8;
+// Every setting and scene change can need another variant of the raytrace shader, and each one keeps a program in the driver
+const int MAX_RAYTRACE_VARIANTS = 8;
+
+void Renderer::Initialize(int width, int height, bool headless)
 {
-	// Load OpenGL
-	gladLoadGL();
+	m_headless = headless;
 
 	// Set up the rect to draw on
 	GLfloat screenCoords[] = { -1,-1, -1,1, 1,1,  -1,-1, 1,1, 1,-1 };
@@ -17,33 +22,57 @@ void Renderer::Initialize(int width, int height)
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 2, 0);
 	glEnableVertexAttribArray(0);
 
-	// The render framebuffer object, to capture the output from the raytrace shader
-	glGenFramebuffers(1, &renderFBO);
-	// Initialize the texture
-	renderTexture.Initialize(GL_TEXTURE1);
-	renderTexture.Resize(width, height);
-	// Bind the texture to the framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, renderFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderTexture.ID, 0);
-
-	// The final render framebuffer object, to capture the final render from the average program
-	glGenFramebuffers(1, &finalRenderFBO);
-	// Initialize the texture
-	finalRenderTexture.Initialize(GL_TEXTURE2);
-	finalRenderTexture.Resize(width, height);
-	// Bind the texture to the framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, finalRenderFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, finalRenderTexture.ID, 0);
-
-	// Compile the shaders
-	m_raytraceShader.LoadFromFile("raytrace.vert", "raytrace.frag");
-	m_averageShader.LoadFromFile("average.vert", "average.frag");
-	m_drawTextureShader.LoadFromFile("drawtexture.vert", "drawtexture.frag");
-
-	// Upload the accumilate textures to the shaders
-	renderTexture.UploadToShader("renderTex", m_averageShader.ID, 1);
-	finalRenderTexture.UploadToShader("finalRenderTex", m_averageShader.ID, 2);
-	finalRenderTexture.UploadToShader("tex", m_drawTextureShader.ID, 2);
+	// The accumulation image, the raytrace shader adds every frame to it in place
+	accumulationTexture.Initialize(GL_TEXTURE1);
+	accumulationTexture.Resize(width, height);
+	m_cpuSamplesTexture.Initialize(GL_TEXTURE2);
+
+	// The framebuffer without attachments to run the raytrace shader on when there is no window
+	if (m_headless)
+	{
+		glGenFramebuffers(1, &m_outputFBO);
+	}
+
+	// The pixel buffer for the frame captures
+	glGenBuffers(1, &m_capturePBO);
+	glGenBuffers(1, &m_checkpointPBO);
+
+	// The traversal counters, always on binding 7
+	glGenBuffers(1, &m_statisticsSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_statisticsSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, 12 * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, m_statisticsSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glGenBuffers(1, &m_statisticsReadback);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_statisticsReadback);
+	glBufferData(GL_COPY_WRITE_BUFFER, 12 * sizeof(GLuint), NULL, GL_STREAM_READ);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	// Compile the shaders, the raytrace shader starts with the variant that works for any scene and settings
+	m_previewShader.LoadFromFile("raytrace.vert", "preview.frag");
+	m_refitShader.LoadComputeFromFile("refit.comp");
+	m_blendShader.LoadComputeFromFile("blend.comp");
+	if (!m_headless) m_frozenShader.LoadFromFile("raytrace.vert", "frozen.frag");
+	if (m_headless)
+	{
+		m_raytraceShader.LoadFromFile("raytrace.vert", "raytrace.frag");
+		m_raytraceVariants[""].shader = m_raytraceShader;
+		m_previewing = false;
+	}
+	else
+	{
+		// A window comes up right away and shows the preview while this compiles
+		m_pendingRaytraceShader.BeginLoadFromFile("raytrace.vert", "raytrace.frag");
+		m_pendingRaytraceDefines = "";
+		m_compilingVariant = true;
+		m_raytraceShader = m_previewShader;
+		m_previewing = true;
+	}
+	m_raytraceDefines = "";
+
+	// The accumulation image is always on image unit 0
+	accumulationTexture.BindImage(0, GL_READ_WRITE);
 
 	// Set the viewport resolution
 	SetViewportResolution(width, height);
@@ -51,25 +80,65 @@ void Renderer::Initialize(int width, int height)
 
 void Renderer::Uninitialize()
 {
-	renderTexture.Delete();
-	finalRenderTexture.Delete();
+	m_cpuTracer.Uninitialize();
+	m_cpuSkybox = nullptr;
+	m_cpuSkyboxID = 0;
+
+	accumulationTexture.Delete();
+	m_cpuSamplesTexture.Delete();
+
+	if (m_headless) glDeleteFramebuffers(1, &m_outputFBO);
 
-	glDeleteFramebuffers(1, &renderFBO);
-	glDeleteFramebuffers(1, &finalRenderFBO);
+	if (m_captureFence) glDeleteSync(m_captureFence);
+	glDeleteBuffers(1, &m_capturePBO);
+	if (m_checkpointFence) glDeleteSync(m_checkpointFence);
+	glDeleteBuffers(1, &m_checkpointPBO);
 
-	m_raytraceShader.Delete();
-	m_averageShader.Delete();
-	m_drawTextureShader.Delete();
+	if (m_statisticsFence) glDeleteSync(m_statisticsFence);
+	glDeleteBuffers(1, &m_statisticsSSBO);
+	glDeleteBuffers(1, &m_statisticsReadback);
+
+	for (auto& variant : m_raytraceVariants)
+	{
+		variant.second.shader.Delete();
+	}
+	m_raytraceVariants.clear();
+	if (m_compilingVariant)
+	{
+		m_pendingRaytraceShader.FinishLoad();
+		m_pendingRaytraceShader.Delete();
+		m_compilingVariant = false;
+	}
+	m_previewShader.Delete();
+	m_refitShader.Delete();
+	m_blendShader.Delete();
+	if (!m_headless) m_frozenShader.Delete();
 }
 
 void Renderer::SetViewportResolution(int width, int height)
 {
+	m_width = width;
+	m_height = height;
+
 	// Set the gl viewport resolution
 	glViewport(0, 0, width, height);
 
-	// Resize the accumilate textures
-	renderTexture.Resize(width, height);
-	finalRenderTexture.Resize(width, height);
+	// The size of a framebuffer without attachments has to be set by hand
+	if (m_headless)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_outputFBO);
+		glFramebufferParameteri(GL_FRAMEBUFFER, GL_FRAMEBUFFER_DEFAULT_WIDTH, width);
+		glFramebufferParameteri(GL_FRAMEBUFFER, GL_FRAMEBUFFER_DEFAULT_HEIGHT, height);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	// Resize the accumilate texture, its contents are cleared by the shader on the next first frame
+	accumulationTexture.Resize(width, height);
+	accumulationTexture.BindImage(0, GL_READ_WRITE);
+	frame = 0;
+	m_fullFrames = 0;
+	// A checkpoint that is still waiting does not fit anymore
+	if (m_resumeCheckpoint.width != width || m_resumeCheckpoint.height != height) m_resumeCheckpoint = AccumulationCheckpoint();
 
 	// Update the aspect ratio
 	m_raytraceShader.Activate();
@@ -81,12 +150,24 @@ int Renderer::GetRenderShaderID()
 	return m_raytraceShader.ID;
 }
 
+
 void Renderer::UploadObjects(Scene& scene)
 {
+	// Bounding boxes can be refitted in place while uploading, so the CPU may not be tracing them
+	if (m_cpuTracer.IsRunning()) m_cpuTracer.Stop();
+
 	scene.UpdateSSBO(m_raytraceShader.ID);
 	scene.skybox.UploadToShader("skybox", m_raytraceShader.ID, 0);
 }
 
+bool Renderer::ReloadGeometry(Scene& scene, const std::shared_ptr<Geometry>& geometry)
+{
+	// A refit changes the vertices and bounding boxes in place
+	if (m_cpuTracer.IsRunning()) m_cpuTracer.Stop();
+
+	return scene.ReloadGeometry(geometry, m_refitShader.ID);
+}
+
 void Renderer::UploadRaytraceSettings()
 {
 	m_raytraceShader.Activate();
@@ -97,13 +178,222 @@ void Renderer::UploadRaytraceSettings()
 	glUniform1f(glGetUniformLocation(m_raytraceShader.ID, "focalDistance"), focalDistance);
 	glUniform1f(glGetUniformLocation(m_raytraceShader.ID, "focalBlur"), focalBlur);
 	glUniform1f(glGetUniformLocation(m_raytraceShader.ID, "blur"), blur);
+	glUniform1i(glGetUniformLocation(m_raytraceShader.ID, "debugView"), debugView);
+	glUniform1f(glGetUniformLocation(m_raytraceShader.ID, "heatmapScale"), heatmapScale);
+}
+
+void Renderer::SetInstrumentation(bool enabled, Scene& scene)
+{
+	if (enabled == m_instrumentation) return;
+	m_instrumentation = enabled;
+
+	SelectRaytraceVariant(scene);
+
+	// Counts that are still being copied belong to the old shader
+	if (m_statisticsFence) glDeleteSync(m_statisticsFence);
+	m_statisticsFence = 0;
+	m_statistics = TraversalStatistics();
+	m_statisticsFrames = 0;
+	m_statisticsCopyTime = std::chrono::high_resolution_clock::now();
+	frame = 0;
+}
+
+bool Renderer::GetInstrumentation() const
+{
+	return m_instrumentation;
+}
+
+const std::string& Renderer::GetRaytraceVariant() const
+{
+	return m_raytraceDefines;
+}
+
+int Renderer::GetRaytraceVariantCount() const
+{
+	return (int)m_raytraceVariants.size();
+}
+
+bool Renderer::IsCompilingShaders() const
+{
+	return m_compilingVariant;
+}
+
+std::string Renderer::GetRaytraceDefines(const Scene& scene) const
+{
+	std::string defines;
+	if (m_instrumentation) defines += "#define INSTRUMENTATION\n";
+
+	if (!specializeShaders) return defines;
+
+	// Uploading a scene switches the variant on the next frame, until then the uploaded counts are what the shader sees
+	if (scene.GetUploadedSphereCount() == 0) defines += "#define NO_SPHERES\n";
+	if (scene.GetUploadedMeshCount() == 0) defines += "#define NO_MESHES\n";
+	defines += "#define TRIANGLE_STORAGE " + std::to_string(scene.GetUploadedTriangleStorage()) + "\n";
+	if (focalBlur == 0.0f) defines += "#define NO_FOCAL_BLUR\n";
+	if (blur == 0.0f) defines += "#define NO_BLUR\n";
+
+	// The settings stay the same for the whole of an accumulated render, so only then a variant per bounce and sample count is worth compiling
+	if (renderMode || m_headless)
+	{
+		defines += "#define MAX_BOUNCES " + std::to_string(maxBounces) + "\n";
+		defines += "#define SAMPLES_PER_PIXEL " + std::to_string(samplesPerPixel) + "\n";
+	}
+
+	return defines;
+}
+
+void Renderer::SelectRaytraceVariant(Scene& scene)
+{
+	// Pick up the variant that was compiling once the driver is done with it
+	if (m_compilingVariant && m_pendingRaytraceShader.IsReady())
+	{
+		m_pendingRaytraceShader.FinishLoad();
+		m_raytraceVariants[m_pendingRaytraceDefines] = { m_pendingRaytraceShader, ++m_variantUses };
+		m_compilingVariant = false;
+	}
+
+	std::string defines = GetRaytraceDefines(scene);
+	if (!m_previewing && defines == m_raytraceDefines) return;
+
+	bool preview = false;
+	auto variant = m_raytraceVariants.find(defines);
+	if (variant == m_raytraceVariants.end() && m_headless)
+	{
+		// Nothing is shown in the meantime, so just wait for it
+		Shader shader;
+		shader.LoadFromFile("raytrace.vert", "raytrace.frag", defines);
+		variant = m_raytraceVariants.emplace(defines, RaytraceVariant{ shader, ++m_variantUses }).first;
+	}
+	else if (variant == m_raytraceVariants.end())
+	{
+		// Only one variant compiles at a time, the next one starts on a later frame
+		if (!m_compilingVariant)
+		{
+			m_pendingRaytraceShader = Shader();
+			m_pendingRaytraceShader.BeginLoadFromFile("raytrace.vert", "raytrace.frag", defines);
+			m_pendingRaytraceDefines = defines;
+			m_compilingVariant = true;
+		}
+
+		variant = m_raytraceVariants.find("");
+		preview = variant == m_raytraceVariants.end();
+	}
+
+	// Already drawing with the fallback
+	if (preview && m_previewing) return;
+	if (!preview && !m_previewing && variant->first == m_raytraceDefines) return;
+
+	// The preview does not add to the accumulation image, so the render starts over
+	if (m_previewing && !preview) frame = 0;
+
+	m_previewing = preview;
+	m_raytraceShader = preview ? m_previewShader : variant->second.shader;
+	m_raytraceDefines = preview ? "" : variant->first;
+	if (!preview) variant->second.lastUsed = ++m_variantUses;
+	EvictRaytraceVariants();
+
+	// The variant still has the uniforms from when it was last active, or none at all
+	UploadRaytraceSettings();
+	scene.UploadUniforms(m_raytraceShader.ID);
+	scene.skybox.UploadToShader("skybox", m_raytraceShader.ID, 0);
+	UploadCameraView(scene);
+	glUniform1f(glGetUniformLocation(m_raytraceShader.ID, "aspectRatio"), (float)m_height / (float)m_width);
+}
+
+void Renderer::EvictRaytraceVariants()
+{
+	while ((int)m_raytraceVariants.size() > MAX_RAYTRACE_VARIANTS)
+	{
+		// The one without defines is drawn while another variant compiles, so it always stays
+		auto oldest = m_raytraceVariants.end();
+		for (auto variant = m_raytraceVariants.begin(); variant != m_raytraceVariants.end(); variant++)
+		{
+			if (variant->first.empty() || (!m_previewing && variant->first == m_raytraceDefines)) continue;
+			if (oldest == m_raytraceVariants.end() || variant->second.lastUsed < oldest->second.lastUsed) oldest = variant;
+		}
+		if (oldest == m_raytraceVariants.end()) return;
+
+		oldest->second.shader.Delete();
+		m_raytraceVariants.erase(oldest);
+	}
+}
+
+const TraversalStatistics& Renderer::GetStatistics() const
+{
+	return m_statistics;
+}
+
+const CpuTracer& Renderer::GetCpuTracer() const
+{
+	return m_cpuTracer;
+}
+
+void Renderer::UpdateStatistics()
+{
+	m_statisticsFrames++;
+
+	if (m_statisticsFence)
+	{
+		// Only check the fence, never wait on it. The first check flushes it
+		GLenum status = glClientWaitSync(m_statisticsFence, m_statisticsFlushed ? 0 : GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		m_statisticsFlushed = true;
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+
+		glDeleteSync(m_statisticsFence);
+		m_statisticsFence = 0;
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_statisticsReadback);
+		GLuint* counters = (GLuint*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, 11 * sizeof(GLuint), GL_MAP_READ_BIT);
+		if (counters)
+		{
+			double seconds = std::chrono::duration<double>(m_statisticsCopyTime - m_previousStatisticsCopyTime).count();
+
+			// The totals are split into a low and a high half
+			auto total = [&](int index) { return (uint64_t)counters[index * 2] | ((uint64_t)counters[index * 2 + 1] << 32); };
+
+			m_statistics.frames = m_copiedStatisticsFrames;
+			m_statistics.paths = total(0);
+			m_statistics.rays = total(1);
+			m_statistics.boxTests = total(2);
+			m_statistics.triangleTests = total(3);
+			m_statistics.bounces = total(4);
+			m_statistics.maxStackDepth = counters[10];
+			m_statistics.mraysPerSecond = seconds > 0.0 ? m_statistics.rays / seconds / 1000000.0 : 0.0;
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	// Make sure the atomics of the frames so far are done before copying
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	// Copy the counters and start counting from zero again, both happen in order on the GPU
+	glBindBuffer(GL_COPY_READ_BUFFER, m_statisticsSSBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_statisticsReadback);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, 12 * sizeof(GLuint));
+	glClearBufferData(GL_COPY_READ_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	m_statisticsFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_statisticsFlushed = false;
+
+	m_previousStatisticsCopyTime = m_statisticsCopyTime;
+	m_statisticsCopyTime = std::chrono::high_resolution_clock::now();
+	m_copiedStatisticsFrames = m_statisticsFrames;
+	m_statisticsFrames = 0;
+}
+
+glm::mat4 Renderer::GetCameraRotation(const Camera& camera)
+{
+	glm::mat4 rotationX = glm::rotate(glm::mat4(1.0f), camera.rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
+	glm::mat4 rotationY = glm::rotate(glm::mat4(1.0f), camera.rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
+	return rotationY * rotationX;
 }
 
 void Renderer::UploadCameraView(Scene& scene)
 {
-	glm::mat4 rotationX = glm::rotate(glm::mat4(1.0f), scene.camera.rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
-	glm::mat4 rotationY = glm::rotate(glm::mat4(1.0f), scene.camera.rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
-	glm::mat4 rotationMatrix = rotationY * rotationX;
+	glm::mat4 rotationMatrix = GetCameraRotation(scene.camera);
 
 	// Upload the camera view matrices
 	m_raytraceShader.Activate();
@@ -111,15 +401,248 @@ void Renderer::UploadCameraView(Scene& scene)
 	glUniform3f(glGetUniformLocation(m_raytraceShader.ID, "cameraPosition"), scene.camera.position.x, scene.camera.position.y, scene.camera.position.z);
 }
 
+void Renderer::ResolveAccumulation(const float* sums, int width, int height, std::vector<float>& data)
+{
+	data.resize(width * height * 3);
+
+	for (int i = 0; i < width * height; i++)
+	{
+		float count = std::max(sums[i * 4 + 3], 1.0f);
+		data[i * 3 + 0] = sums[i * 4 + 0] / count;
+		data[i * 3 + 1] = sums[i * 4 + 1] / count;
+		data[i * 3 + 2] = sums[i * 4 + 2] / count;
+	}
+}
+
 std::vector<float> Renderer::GetCurrentFrame(int& width, int& height)
 {
-	std::vector<float> data;
+	width = m_width;
+	height = m_height;
 
-	finalRenderTexture.GetTextureData(width, height, data);
+	// Make sure the image stores of the last frame are visible to the download
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
 
+	std::vector<float> sums(width * height * 4);
+	accumulationTexture.Bind();
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, sums.data());
+	accumulationTexture.Unbind();
+
+	std::vector<float> data;
+	ResolveAccumulation(sums.data(), width, height, data);
 	return data;
 }
 
+void Renderer::GetAccumulatedSums(int x, int y, int width, int height, std::vector<float>& sums)
+{
+	// Make sure the image stores of the last frame are visible to the download
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+	sums.resize(width * height * 4);
+	glGetTextureSubImage(accumulationTexture.ID, 0, x, y, 0, width, height, 1, GL_RGBA, GL_FLOAT, (GLsizei)(sums.size() * sizeof(float)), sums.data());
+}
+
+bool Renderer::RequestFrame()
+{
+	if (m_captureFence) return false;
+
+	m_captureWidth = m_width;
+	m_captureHeight = m_height;
+
+	// Make sure the image stores of the last frame are visible to the copy
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+
+	// Copy the accumulation image into the pixel buffer, this returns right away and the copy happens on the GPU
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_capturePBO);
+	glBufferData(GL_PIXEL_PACK_BUFFER, m_captureWidth * m_captureHeight * 4 * sizeof(float), NULL, GL_STREAM_READ);
+	accumulationTexture.Bind();
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, 0);
+	accumulationTexture.Unbind();
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_captureFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_captureFlushed = false;
+	return true;
+}
+
+bool Renderer::GetRequestedFrame(int& width, int& height, std::vector<float>& data)
+{
+	if (!m_captureFence) return false;
+
+	// Only check the fence, never wait on it. The first check flushes it, or it may never reach the GPU
+	GLenum status = glClientWaitSync(m_captureFence, m_captureFlushed ? 0 : GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	m_captureFlushed = true;
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+
+	glDeleteSync(m_captureFence);
+	m_captureFence = 0;
+
+	width = m_captureWidth;
+	height = m_captureHeight;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_capturePBO);
+	float* ptr = (float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, width * height * 4 * sizeof(float), GL_MAP_READ_BIT);
+	if (ptr)
+	{
+		ResolveAccumulation(ptr, width, height, data);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	return ptr != nullptr;
+}
+
+unsigned int Renderer::GetAccumulatedFrames() const
+{
+	return frame;
+}
+
+bool Renderer::RequestCheckpoint()
+{
+	if (m_checkpointFence) return false;
+
+	m_checkpoint.width = m_width;
+	m_checkpoint.height = m_height;
+	m_checkpoint.frame = frame;
+	m_checkpoint.sampleOffset = sampleOffset;
+
+	// Make sure the image stores of the last frame are visible to the copy
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_checkpointPBO);
+	glBufferData(GL_PIXEL_PACK_BUFFER, m_width * m_height * 4 * sizeof(float), NULL, GL_STREAM_READ);
+	accumulationTexture.Bind();
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, 0);
+	accumulationTexture.Unbind();
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_checkpointFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_checkpointFlushed = false;
+	return true;
+}
+
+bool Renderer::GetRequestedCheckpoint(AccumulationCheckpoint& checkpoint)
+{
+	if (!m_checkpointFence) return false;
+
+	// Only check the fence, never wait on it. The first check flushes it
+	GLenum status = glClientWaitSync(m_checkpointFence, m_checkpointFlushed ? 0 : GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	m_checkpointFlushed = true;
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+
+	glDeleteSync(m_checkpointFence);
+	m_checkpointFence = 0;
+
+	checkpoint = m_checkpoint;
+	checkpoint.sums.resize(checkpoint.width * checkpoint.height * 4);
+
+	// The sums are copied as they are, resolving them would lose the sample counts
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_checkpointPBO);
+	float* ptr = (float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, checkpoint.sums.size() * sizeof(float), GL_MAP_READ_BIT);
+	if (ptr)
+	{
+		std::memcpy(checkpoint.sums.data(), ptr, checkpoint.sums.size() * sizeof(float));
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	return ptr != nullptr;
+}
+
+bool Renderer::ResumeAccumulation(AccumulationCheckpoint&& checkpoint)
+{
+	if (checkpoint.width != m_width || checkpoint.height != m_height || checkpoint.sums.size() != (size_t)m_width * m_height * 4)
+	{
+		std::cout << "The checkpoint is " << checkpoint.width << "x" << checkpoint.height << " but the viewport is " << m_width << "x" << m_height << "\n";
+		return false;
+	}
+
+	m_resumeCheckpoint = std::move(checkpoint);
+	return true;
+}
+
+std::shared_ptr<const CpuScene> Renderer::MakeCpuScene(const Scene& scene)
+{
+	TRACE_SCOPE("Renderer::MakeCpuScene");
+
+	std::shared_ptr<CpuScene> cpuScene = std::make_shared<CpuScene>();
+	cpuScene->spheres = scene.spheres;
+	for (const Mesh& mesh : scene.meshes)
+	{
+		// Bring the boxes up to date after a refit on the GPU, without rebuilding so the triangles stay in the order the GPU has them in
+		if (mesh.geometry->boundingBoxesOutdated) mesh.geometry->RefitBoundingBoxes(std::numeric_limits<float>::infinity());
+
+		cpuScene->meshes.push_back({ mesh.modelWorldToLocalMatrix, mesh.material, mesh.geometry });
+	}
+
+	// Loading a skybox always creates a new texture
+	if (scene.skybox.ID != m_cpuSkyboxID)
+	{
+		std::shared_ptr<std::vector<float>> pixels = std::make_shared<std::vector<float>>();
+		scene.skybox.GetTextureData(m_cpuSkyboxWidth, m_cpuSkyboxHeight, *pixels);
+		m_cpuSkybox = pixels;
+		m_cpuSkyboxID = scene.skybox.ID;
+	}
+	cpuScene->skybox = m_cpuSkybox;
+	cpuScene->skyboxWidth = m_cpuSkyboxWidth;
+	cpuScene->skyboxHeight = m_cpuSkyboxHeight;
+
+	cpuScene->cameraRotation = GetCameraRotation(scene.camera);
+	cpuScene->cameraPosition = scene.camera.position;
+	cpuScene->sampleStream = sampleStream;
+
+	cpuScene->width = m_width;
+	cpuScene->height = m_height;
+	cpuScene->maxBounces = maxBounces;
+	cpuScene->samplesPerPixel = samplesPerPixel;
+	cpuScene->perspectiveSlope = perspectiveSlope;
+	cpuScene->focalDistance = focalDistance;
+	cpuScene->focalBlur = focalBlur;
+	cpuScene->blur = blur;
+	return cpuScene;
+}
+
+void Renderer::BlendCpuSamples(const Scene& scene, bool restart)
+{
+	TRACE_SCOPE("Renderer::BlendCpuSamples");
+
+	// The threads only start once hybrid rendering is used
+	if (m_cpuTracer.GetThreadCount() == 0) m_cpuTracer.Initialize();
+
+	// Stopped while the scene was uploaded, the samples so far still count
+	if (restart || !m_cpuTracer.IsRunning())
+	{
+		m_cpuTracer.Start(MakeCpuScene(scene));
+	}
+
+	uint64_t gpuSamples = (uint64_t)m_width * m_height * samplesPerPixel;
+	m_cpuTracer.Balance(gpuSamples);
+
+	m_blendShader.Activate();
+
+	CpuTile tile;
+	while (m_cpuTracer.TakeTile(tile))
+	{
+		if (tile.region.z > m_cpuSamplesWidth || tile.region.w > m_cpuSamplesHeight)
+		{
+			m_cpuSamplesWidth = std::max(m_cpuSamplesWidth, tile.region.z);
+			m_cpuSamplesHeight = std::max(m_cpuSamplesHeight, tile.region.w);
+			m_cpuSamplesTexture.Resize(m_cpuSamplesWidth, m_cpuSamplesHeight);
+		}
+
+		m_cpuSamplesTexture.Bind();
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tile.region.z, tile.region.w, GL_RGBA, GL_FLOAT, tile.sums.data());
+		m_cpuSamplesTexture.Unbind();
+		m_cpuSamplesTexture.BindImage(1, GL_READ_ONLY);
+
+		glUniform2i(glGetUniformLocation(m_blendShader.ID, "offset"), tile.region.x, tile.region.y);
+		glUniform2i(glGetUniformLocation(m_blendShader.ID, "size"), tile.region.z, tile.region.w);
+		glDispatchCompute((tile.region.z + 7) / 8, (tile.region.w + 7) / 8, 1);
+
+		// The next tile or frame reads what this one stored
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+}
+
 void Renderer::Render(Scene& scene, bool& viewChanged)
 {
 	if (viewChanged)
@@ -128,48 +651,91 @@ void Renderer::Render(Scene& scene, bool& viewChanged)
 		frame = 0;
 	}
 
+	// Settings or the scene might need another variant of the raytrace shader
+	SelectRaytraceVariant(scene);
+
+	// What is outside of the region only stays frozen for as long as the camera does
+	if (scene.camera.position != m_fullFramesCameraPosition || scene.camera.rotation != m_fullFramesCameraRotation)
+	{
+		m_fullFramesCameraPosition = scene.camera.position;
+		m_fullFramesCameraRotation = scene.camera.rotation;
+		m_fullFrames = 0;
+	}
+
+	// A window keeps showing the pixels outside of the region, so it accumulates to still have them
+	bool useRegion = region.z > 0 && region.w > 0;
+	bool crop = useRegion && !m_headless;
+	if (crop && m_fullFrames < FROZEN_FULL_FRAMES) useRegion = false;
+
+	// Only once the raytrace shader runs, leaving the preview starts over
+	bool accumulate = renderMode || m_headless || crop;
+	bool resumed = false;
+	if (!m_resumeCheckpoint.sums.empty() && accumulate && !m_previewing)
+	{
+		resumed = true;
+		accumulationTexture.Bind();
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_resumeCheckpoint.width, m_resumeCheckpoint.height, GL_RGBA, GL_FLOAT, m_resumeCheckpoint.sums.data());
+		accumulationTexture.Unbind();
+
+		frame = m_resumeCheckpoint.frame;
+		sampleOffset = m_resumeCheckpoint.sampleOffset;
+		m_resumeCheckpoint = AccumulationCheckpoint();
+	}
+
+	// The raytrace shader only draws the region, the rest of the window shows what was accumulated before
+	if (crop && useRegion)
+	{
+		m_frozenShader.Activate();
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+
 	// Activate the raytrace shader
 	m_raytraceShader.Activate();
 	// Bind the skybox texture
 	scene.skybox.Bind();
 	// Upload the current frame count
 	glUniform1ui(glGetUniformLocation(m_raytraceShader.ID, "frame"), frame);
+	glUniform1ui(glGetUniformLocation(m_raytraceShader.ID, "sampleOffset"), sampleOffset);
+	glUniform1ui(glGetUniformLocation(m_raytraceShader.ID, "sampleStream"), sampleStream);
+
+	// Only add to the accumulation image in render mode
+	glUniform1i(glGetUniformLocation(m_raytraceShader.ID, "accumulate"), accumulate);
 
-	if (!renderMode)
+	// Activate the framebuffer to draw to, the actual window unless headless
+	glBindFramebuffer(GL_FRAMEBUFFER, m_outputFBO);
+	// Start ray tracing
+	// Only the fragments of the region run the shader
+	if (useRegion)
 	{
-		// Activate the framebuffer to draw to
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		// Start ray tracing
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(region.x, region.y, region.z, region.w);
+	}
+	if (profiler) profiler->BeginGPU("Trace");
+	{
+		TRACE_GPU_SCOPE("Renderer::Render");
 		glDrawArrays(GL_TRIANGLES, 0, 6);
-
-		return;
 	}
+	if (profiler) profiler->EndGPU("Trace");
+	if (useRegion) glDisable(GL_SCISSOR_TEST);
 
-	// Activate the framebuffer to draw to
-	glBindFramebuffer(GL_FRAMEBUFFER, renderFBO);
-	// Start ray tracing
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-
-	// Activate the average shader
-	m_averageShader.Activate();
-	// Set the frame count
-	glUniform1ui(glGetUniformLocation(m_averageShader.ID, "frame"), frame);
-	// Bind the final render texture and the render texture
-	finalRenderTexture.Bind();
-	renderTexture.Bind();
-	// Activate the framebuffer to draw to
-	glBindFramebuffer(GL_FRAMEBUFFER, finalRenderFBO);
-	// Calculate the average
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-
-	// Activate the draw texture shader
-	m_drawTextureShader.Activate();
-	// Bind the final render texture
-	finalRenderTexture.Bind();
-	// Bind the default framebuffer, the actual window
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	// Render the framebuffer texture to screen
-	glDrawArrays(GL_TRIANGLES, 0, 6);
+	if (m_instrumentation) UpdateStatistics();
+
+	// The CPU samples are always shaded, and only the raytrace shader keeps them in the accumulation. The CPU traces the whole viewport,
+	// so it would add to the pixels a region leaves alone
+	bool hybrid = hybridRendering && accumulate && !m_previewing && !useRegion && !(m_instrumentation && debugView != DEBUG_VIEW_SHADED);
+	if (!hybrid && m_cpuTracer.IsRunning()) m_cpuTracer.Stop();
+
+	// The preview and frames that are not accumulated leave nothing to freeze
+	if (!accumulate || m_previewing) m_fullFrames = 0;
+	else if (!useRegion) m_fullFrames = frame == 0 ? 1 : m_fullFrames + 1;
+
+	if (!accumulate) return;
+
+	// The next frame reads back what this frame stored
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+	// Added after the frame, the first frame of an accumulation clears the pixels
+	if (hybrid) BlendCpuSamples(scene, frame == 0 || resumed);
 
 	frame++;
 }
\ No newline at end of file
@@ -3,23 +3,137 @@
 #define RENDERER_CLASS_H
 
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include "Checkpoint.h"
+#include "CpuTracer.h"
 #include "Objects.h"
+#include "Profiler.h"
 #include "Shader.h"
 #include "Scene.h"
 
+// What the instrumented raytrace shader shows instead of the shaded image, as a heatmap
+enum DebugView : int
+{
+	DEBUG_VIEW_SHADED,
+	// Bounding box tests per ray
+	DEBUG_VIEW_BOX_TESTS,
+	// Triangle tests per ray
+	DEBUG_VIEW_TRIANGLE_TESTS,
+	// The deepest the traversal stack got in the pixel
+	DEBUG_VIEW_STACK_DEPTH,
+	// Bounces per path
+	DEBUG_VIEW_BOUNCES
+};
+
+// The counts of the instrumented raytrace shader, summed over the frames between two readbacks
+struct TraversalStatistics
+{
+	uint64_t paths = 0;
+	uint64_t rays = 0;
+	uint64_t boxTests = 0;
+	uint64_t triangleTests = 0;
+	uint64_t bounces = 0;
+	unsigned int maxStackDepth = 0;
+
+	int frames = 0;
+	// Every ray counts, including the bounces
+	double mraysPerSecond = 0.0;
+};
+
 class Renderer
 {
+	// The active variant of the raytrace shader
 	Shader m_raytraceShader;
-	Shader m_averageShader;
-	Shader m_drawTextureShader;
+	struct RaytraceVariant
+	{
+		Shader shader;
+		// When it was last made active, the least recently used variants are deleted first
+		unsigned int lastUsed = 0;
+	};
+	// The variants of the raytrace shader that are compiled, by the defines they were compiled with
+	std::map<std::string, RaytraceVariant> m_raytraceVariants;
+	unsigned int m_variantUses = 0;
+	std::string m_raytraceDefines;
+	// Only shows the sky, drawn instead of the raytrace shader until its first variant is compiled
+	Shader m_previewShader;
+	bool m_previewing = false;
+	// The variant that is compiling in the background, a window keeps drawing with the active one in the meantime
+	Shader m_pendingRaytraceShader;
+	std::string m_pendingRaytraceDefines;
+	bool m_compilingVariant = false;
+	Shader m_refitShader;
+	// Adds the tiles the CPU traced to the accumulation image
+	Shader m_blendShader;
+	// Draws the accumulation image where a crop region keeps the raytrace shader from running
+	Shader m_frozenShader;
 
-	GLuint renderFBO;
-	Texture renderTexture;
-	GLuint finalRenderFBO;
-	Texture finalRenderTexture;
+	// The running sum of every sample in rgb and the sample count in alpha, written by the raytrace shader itself
+	Texture accumulationTexture;
 
 	unsigned int frame = 0;
+	int m_width = 0, m_height = 0;
+
+	// The frames accumulated over the whole viewport since it started over, with the camera they were taken from.
+	// A window only freezes the pixels outside of a region once there are enough of them to show
+	int m_fullFrames = 0;
+	glm::vec3 m_fullFramesCameraPosition = glm::vec3(0.0f), m_fullFramesCameraRotation = glm::vec3(0.0f);
+
+	// Without a window there is no default framebuffer, the raytrace shader then draws into a framebuffer without attachments
+	bool m_headless = false;
+	GLuint m_outputFBO = 0;
+
+	// Pixel buffer the frame is copied into without stalling, and the fence that tells when the copy is done
+	GLuint m_capturePBO = 0;
+	GLsync m_captureFence = 0;
+	// Whether the fence has been flushed to the GPU by the first check yet
+	bool m_captureFlushed = false;
+	int m_captureWidth = 0, m_captureHeight = 0;
+
+	// The same for the raw sums of a checkpoint, with the frame count at the time of the copy
+	GLuint m_checkpointPBO = 0;
+	GLsync m_checkpointFence = 0;
+	bool m_checkpointFlushed = false;
+	AccumulationCheckpoint m_checkpoint;
+	// The checkpoint to continue from, uploaded on the first frame the raytrace shader accumulates
+	AccumulationCheckpoint m_resumeCheckpoint;
+
+	// Traces extra samples on the CPU while the GPU renders, only started once hybrid rendering is used
+	CpuTracer m_cpuTracer;
+	// The tiles of the CPU are uploaded here before they are blended, it only grows
+	Texture m_cpuSamplesTexture;
+	int m_cpuSamplesWidth = 0, m_cpuSamplesHeight = 0;
+	// The pixels of the skybox texture the CPU traces with, only downloaded again when the texture is replaced
+	std::shared_ptr<const std::vector<float>> m_cpuSkybox;
+	GLuint m_cpuSkyboxID = 0;
+	int m_cpuSkyboxWidth = 0, m_cpuSkyboxHeight = 0;
+	// Copies what the CPU needs to trace the scene like the raytrace shader would right now
+	std::shared_ptr<const CpuScene> MakeCpuScene(const Scene& scene);
+	// Starts the CPU on a new accumulation when it has to, and blends the tiles it finished since the last frame
+	void BlendCpuSamples(const Scene& scene, bool restart);
+
+	// The counters the instrumented raytrace shader adds to, and the buffer they are copied into to read them without stalling
+	bool m_instrumentation = false;
+	GLuint m_statisticsSSBO = 0;
+	GLuint m_statisticsReadback = 0;
+	GLsync m_statisticsFence = 0;
+	bool m_statisticsFlushed = false;
+	int m_statisticsFrames = 0, m_copiedStatisticsFrames = 0;
+	std::chrono::high_resolution_clock::time_point m_statisticsCopyTime, m_previousStatisticsCopyTime;
+	TraversalStatistics m_statistics;
+	// Reads the counters copied a couple of frames ago once they are ready, and starts copying the next ones
+	void UpdateStatistics();
+
+	// The defines of the raytrace shader variant that fits the current settings and what is uploaded of the scene
+	std::string GetRaytraceDefines(const Scene& scene) const;
+	// Switches to the variant that fits and uploads everything to it. A missing variant is compiled in the background, until then
+	// the variant that works for everything is used, or the preview when that one is not compiled yet either. Headless it waits for the compile
+	void SelectRaytraceVariant(Scene& scene);
+	// Deletes the least recently used variants while there are more than MAX_RAYTRACE_VARIANTS, never the active one or the one without defines
+	void EvictRaytraceVariants();
+	// The rotation of the camera, the same for the GPU and the CPU
+	static glm::mat4 GetCameraRotation(const Camera& camera);
 
 public:
 	// Raytracing settings
@@ -30,8 +144,29 @@ public:
 	float focalBlur = 0.0f;
 	float blur = 0.0f;
 	bool renderMode = false;
+	// Only used by the instrumented raytrace shader
+	DebugView debugView = DEBUG_VIEW_SHADED;
+	float heatmapScale = 64.0f;
+	// Times the passes when set
+	Profiler* profiler = nullptr;
+	// Added to the frame count for the random seeds, renders with different offsets get independent samples
+	unsigned int sampleOffset = 0;
+	// Renders with different streams get independent samples, even for the same frames
+	unsigned int sampleStream = 0;
+	// The pixels that are traced as x, y, width and height from the bottom left, the whole viewport when the width or height is 0.
+	// Everything outside of it keeps what was in the accumulation image. A window always accumulates with a region and shows the rest frozen,
+	// after first tracing the whole viewport for a couple of frames when the camera moved
+	glm::ivec4 region = glm::ivec4(0);
+	// Traces extra samples on the CPU while accumulating and adds them to the GPU samples, the amount of CPU threads is balanced by the measured throughput
+	bool hybridRendering = false;
+	// Compile variants of the raytrace shader with the scene and settings baked in, so the unused code is dropped and the loops have a fixed length
+	bool specializeShaders = true;
+
+	// Turn the accumulated sums into the average color of every pixel
+	static void ResolveAccumulation(const float* sums, int width, int height, std::vector<float>& data);
 
-	void Initialize(int width, int height);
+	// A headless renderer always accumulates, since there is no window to show the preview on
+	void Initialize(int width, int height, bool headless = false);
 	void Uninitialize();
 
 	// Set the gl viewport resolution, and updates all the screen textures
@@ -43,11 +178,42 @@ public:
 	void UploadRaytraceSettings();
 	// Upload all the scene spheres, triangles and boundingBoxed to the GPU
 	void UploadObjects(Scene& scene);
+	// Swaps a reloaded geometry into the scene, refitting the bounding boxes on the GPU when only the vertices moved. Returns false when the scene needs an UploadObjects
+	bool ReloadGeometry(Scene& scene, const std::shared_ptr<Geometry>& geometry);
 	// Upload the camera matrix and position to the GPU
 	void UploadCameraView(Scene& scene);
 
+	// Recompiles the raytrace shader with or without the traversal counters, and uploads everything to it again
+	void SetInstrumentation(bool enabled, Scene& scene);
+	bool GetInstrumentation() const;
+	// The defines of the active raytrace shader variant, and how many variants are compiled
+	const std::string& GetRaytraceVariant() const;
+	int GetRaytraceVariantCount() const;
+	// True while a variant of the raytrace shader compiles in the background
+	bool IsCompilingShaders() const;
+	// The latest counts of the instrumented raytrace shader
+	const TraversalStatistics& GetStatistics() const;
+	// The thread count and throughput of hybrid rendering
+	const CpuTracer& GetCpuTracer() const;
+
 	// Get the frame of the current render
 	std::vector<float> GetCurrentFrame(int& width, int& height);
+	// Get the sums and sample counts of a part of the accumulation image, without turning them into colors
+	void GetAccumulatedSums(int x, int y, int width, int height, std::vector<float>& sums);
+	// Starts copying the current render to a pixel buffer in the background, returns false if a copy is still going on
+	bool RequestFrame();
+	// Gets the frame from RequestFrame once the GPU has finished copying it, returns false while it is not ready yet
+	bool GetRequestedFrame(int& width, int& height, std::vector<float>& data);
+
+	// The amount of frames in the accumulation image
+	unsigned int GetAccumulatedFrames() const;
+	// Starts copying the accumulation image for a checkpoint in the background, returns false if a copy is still going on
+	bool RequestCheckpoint();
+	// Gets the checkpoint from RequestCheckpoint once the GPU has finished copying it, without the scene hash
+	bool GetRequestedCheckpoint(AccumulationCheckpoint& checkpoint);
+	// Continues accumulating from the checkpoint instead of starting over, as long as it has the size of the viewport.
+	// It is uploaded once the raytrace shader is compiled and accumulating, the preview never touches it
+	bool ResumeAccumulation(AccumulationCheckpoint&& checkpoint);
 
 	// Render the next frame
 	void Render(Scene& scene, bool& sceneChanged);
@@ -4,8 +4,11 @@ void Scene::Initialize()
 {
 	glGenBuffers(1, &m_spheresSSBO);
 	glGenBuffers(1, &m_meshesSSBO);
-	glGenBuffers(1, &m_trianglesSSBO);
+	glGenBuffers(1, &m_indicesSSBO);
+	glGenBuffers(1, &m_verticesSSBO);
+	glGenBuffers(1, &m_precomputedTrianglesSSBO);
 	glGenBuffers(1, &m_boundingBoxesSSBO);
+	glGenBuffers(1, &m_refitOrderSSBO);
 
 	skybox.Initialize(GL_TEXTURE0);
 }
@@ -14,8 +17,11 @@ void Scene::Uninitialize()
 {
 	glDeleteBuffers(1, &m_spheresSSBO);
 	glDeleteBuffers(1, &m_meshesSSBO);
-	glDeleteBuffers(1, &m_trianglesSSBO);
+	glDeleteBuffers(1, &m_indicesSSBO);
+	glDeleteBuffers(1, &m_verticesSSBO);
+	glDeleteBuffers(1, &m_precomputedTrianglesSSBO);
 	glDeleteBuffers(1, &m_boundingBoxesSSBO);
+	glDeleteBuffers(1, &m_refitOrderSSBO);
 
 	skybox.Delete();
 }
@@ -60,46 +66,370 @@ void Scene::UpdateSphere(GLuint shaderID, const int& index)
 
 void Scene::AddMesh(const char* file)
 {
-	meshes.push_back(Mesh());
-	meshes[meshes.size() - 1].LoadFromObjectFile(file);
-	meshes[meshes.size() - 1].UpdateBoundingBoxes();
-	meshes[meshes.size() - 1].UpdateTransformMatrix();
-	meshes[meshes.size() - 1].material = Material({ 0.9f, 0.9f, 0.9f }, 0.8f, 0.0f, 0.5f, 1.0f, 1.5f, 1.0f);
+	TRACE_SCOPE("Scene::AddMesh", file);
+
+	std::shared_ptr<Geometry> geometry = LoadGeometry(file);
+	if (geometry) AddMesh(geometry);
+}
+
+void Scene::AddMesh(const std::shared_ptr<Geometry>& geometry)
+{
+	Mesh mesh;
+	mesh.geometry = geometry;
+	mesh.UpdateTransformMatrix();
+	mesh.material = Material({ 0.9f, 0.9f, 0.9f }, 0.8f, 0.0f, 0.5f, 1.0f, 1.5f, 1.0f);
+	AddMesh(mesh);
+}
+
+void Scene::AddMesh(const Mesh& mesh)
+{
+	// Another import of the same file might have gotten there first
+	std::string key = GetLibraryKey(mesh.geometry->file.c_str());
+	auto it = m_geometryLibrary.find(key);
+	if (it == m_geometryLibrary.end())
+	{
+		it = m_geometryLibrary.emplace(key, mesh.geometry).first;
+	}
+
+	meshes.push_back(mesh);
+	meshes[meshes.size() - 1].geometry = it->second;
+}
+
+std::string Scene::GetLibraryKey(const char* file)
+{
+	std::error_code error;
+	std::string key = std::filesystem::weakly_canonical(file, error).string();
+	if (error) key = file;
+	return key;
+}
+
+std::shared_ptr<Geometry> Scene::FindGeometry(const char* file) const
+{
+	auto it = m_geometryLibrary.find(GetLibraryKey(file));
+	if (it == m_geometryLibrary.end()) return nullptr;
+	return it->second;
+}
+
+bool Scene::ReloadGeometry(const std::shared_ptr<Geometry>& geometry, GLuint refitShaderID)
+{
+	TRACE_SCOPE("Scene::ReloadGeometry", geometry->file);
+
+	std::string key = GetLibraryKey(geometry->file.c_str());
+	std::shared_ptr<Geometry> oldGeometry = m_geometryLibrary[key];
+
+	// The importer leaves out the bounding boxes when only the vertices moved
+	if (geometry->boundingBoxes.size() == 0)
+	{
+		if (oldGeometry && oldGeometry->boundingBoxes.size() > 0 && oldGeometry->GetTopologyHash() == geometry->GetTopologyHash())
+		{
+			// Keep the old geometry with its tree, so its ranges in the buffers stay the same as well
+			oldGeometry->vertices = std::move(geometry->vertices);
+
+			int firstMesh = -1;
+			for (int i = 0; i < (int)meshes.size() && firstMesh == -1; i++)
+			{
+				if (meshes[i].geometry == oldGeometry) firstMesh = i;
+			}
+
+			// Not on the GPU yet, so the next UpdateSSBO uploads it
+			if (firstMesh == -1 || firstMesh >= (int)shaderReadyMeshes.size())
+			{
+				oldGeometry->RefitBoundingBoxes(rebuildThreshold);
+				return firstMesh == -1;
+			}
+
+			RefitMesh(refitShaderID, firstMesh);
+			return true;
+		}
+
+		// The file changed again after the reload was queued
+		geometry->UpdateBoundingBoxes();
+	}
+
+	m_geometryLibrary[key] = geometry;
+	if (!oldGeometry) return true;
+
+	int firstMesh = -1;
+	for (int i = 0; i < (int)meshes.size(); i++)
+	{
+		if (meshes[i].geometry != oldGeometry) continue;
+
+		meshes[i].geometry = geometry;
+		if (firstMesh == -1) firstMesh = i;
+	}
+	if (firstMesh == -1) return true;
+
+	// The new geometry only fits in the old ranges of the buffers when it has just as many of everything
+	bool fits = geometry->vertices.size() == oldGeometry->vertices.size() &&
+		geometry->indices.size() == oldGeometry->indices.size() &&
+		geometry->boundingBoxes.size() == oldGeometry->boundingBoxes.size();
+	if (!fits || firstMesh >= (int)shaderReadyMeshes.size()) return false;
+
+	// Every mesh that uses the geometry shares its ranges, so uploading it for one updates all of them
+	UploadMeshGeometry(firstMesh, true);
+	return true;
+}
+
+std::shared_ptr<Geometry> Scene::LoadGeometry(const char* file)
+{
+	TRACE_SCOPE("Scene::LoadGeometry", file);
+
+	std::shared_ptr<Geometry> geometry = FindGeometry(file);
+	if (geometry)
+	{
+		return geometry;
+	}
+
+	geometry = std::make_shared<Geometry>();
+	// Not put in the library, so the next try reads the file again
+	if (!geometry->LoadFromFile(file) || geometry->indices.empty())
+	{
+		std::cout << "Failed to load geometry: " << file << "\n";
+		return nullptr;
+	}
+	geometry->UpdateBoundingBoxes();
+
+	m_geometryLibrary[GetLibraryKey(file)] = geometry;
+	return geometry;
+}
+
+int Scene::GetVertexStride() const
+{
+	return triangleStorage == STORAGE_QUANTIZED ? 2 : 3;
+}
+
+void Scene::EncodeGeometry(const Geometry& geometry, std::vector<unsigned int>& vertexData, std::vector<PrecomputedTriangle>& precomputedTriangles, std::vector<BoundingBox>& boundingBoxes, glm::vec3& quantizationMin, glm::vec3& quantizationScale) const
+{
+	quantizationMin = glm::vec3(0.0f);
+	quantizationScale = glm::vec3(0.0f);
+
+	if (triangleStorage == STORAGE_PRECOMPUTED)
+	{
+		// Do the per triangle math of the intersection once here instead of for every ray
+		for (int i = 0; i < (int)geometry.indices.size(); i++)
+		{
+			Triangle triangle = geometry.GetTriangle(i);
+			glm::vec3 edgeAB = triangle.p[1] - triangle.p[0];
+			glm::vec3 edgeAC = triangle.p[2] - triangle.p[0];
+			glm::vec3 normal = glm::cross(edgeAB, edgeAC);
+
+			precomputedTriangles.push_back({ glm::vec4(triangle.p[0], normal.x), glm::vec4(edgeAB, normal.y), glm::vec4(edgeAC, normal.z) });
+		}
+	}
+
+	if (triangleStorage != STORAGE_QUANTIZED)
+	{
+		// Store the full float positions, 3 values per vertex
+		for (const glm::vec3& vertex : geometry.vertices)
+		{
+			glm::uvec3 bits = glm::floatBitsToUint(vertex);
+			vertexData.push_back(bits.x);
+			vertexData.push_back(bits.y);
+			vertexData.push_back(bits.z);
+		}
+
+		boundingBoxes.insert(boundingBoxes.end(), geometry.boundingBoxes.begin(), geometry.boundingBoxes.end());
+		return;
+	}
+
+	if (geometry.vertices.size() == 0) return;
+
+	// Quantize every axis to 16 bits within the bounds of the vertices, 2 values per vertex
+	BoundingBox bounds;
+	for (const glm::vec3& vertex : geometry.vertices)
+	{
+		bounds.GrowToInclude(vertex);
+	}
+
+	quantizationMin = bounds.min;
+	quantizationScale = (bounds.max - bounds.min) / 65535.0f;
+	glm::vec3 inverseScale = glm::vec3(1.0f) / glm::max(quantizationScale, glm::vec3(std::numeric_limits<float>::min()));
+
+	for (const glm::vec3& vertex : geometry.vertices)
+	{
+		glm::uvec3 quantized = glm::uvec3(glm::clamp(glm::round((vertex - quantizationMin) * inverseScale), 0.0f, 65535.0f));
+		vertexData.push_back(quantized.x | (quantized.y << 16));
+		vertexData.push_back(quantized.z);
+	}
+
+	// The quantized vertices can move half a step, so grow the boxes by a step to keep the triangles inside of them
+	for (BoundingBox boundingBox : geometry.boundingBoxes)
+	{
+		boundingBox.min -= quantizationScale;
+		boundingBox.max += quantizationScale;
+		boundingBoxes.push_back(boundingBox);
+	}
+}
+
+void Scene::UploadMeshGeometry(const int& index, bool uploadBoundingBoxes)
+{
+	const Geometry& geometry = *meshes[index].geometry;
+	const ShaderReadyMesh& shaderReadyMesh = shaderReadyMeshes[index];
+
+	std::vector<unsigned int> vertexData;
+	std::vector<PrecomputedTriangle> precomputedTriangles;
+	std::vector<BoundingBox> boundingBoxes;
+	glm::vec3 quantizationMin, quantizationScale;
+	EncodeGeometry(geometry, vertexData, precomputedTriangles, boundingBoxes, quantizationMin, quantizationScale);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_verticesSSBO);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, shaderReadyMesh.vertexIndex * GetVertexStride() * sizeof(unsigned int), vertexData.size() * sizeof(unsigned int), vertexData.data());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_indicesSSBO);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, shaderReadyMesh.triangleIndex * sizeof(glm::uvec3), geometry.indices.size() * sizeof(glm::uvec3), geometry.indices.data());
+
+	if (triangleStorage == STORAGE_PRECOMPUTED)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_precomputedTrianglesSSBO);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, shaderReadyMesh.triangleIndex * sizeof(PrecomputedTriangle), precomputedTriangles.size() * sizeof(PrecomputedTriangle), precomputedTriangles.data());
+	}
+
+	if (uploadBoundingBoxes)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundingBoxesSSBO);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, shaderReadyMesh.boundingBoxIndex * sizeof(BoundingBox), boundingBoxes.size() * sizeof(BoundingBox), boundingBoxes.data());
+	}
+
+	// The vertices might have moved outside of the old quantization bounds, so every mesh using this geometry gets the new ones
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_meshesSSBO);
+	for (int i = 0; i < (int)meshes.size(); i++)
+	{
+		if (meshes[i].geometry != meshes[index].geometry) continue;
+
+		shaderReadyMeshes[i].quantizationMin = quantizationMin;
+		shaderReadyMeshes[i].quantizationScale = quantizationScale;
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, i * sizeof(ShaderReadyMesh), sizeof(ShaderReadyMesh), &shaderReadyMeshes[i]);
+	}
+
+	// Unbind the buffer
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+bool Scene::RefitMesh(GLuint refitShaderID, const int& index)
+{
+	TRACE_SCOPE("Scene::RefitMesh");
+	TRACE_GPU_SCOPE("Scene::RefitMesh");
+
+	// The geometry is shared, so this refits every mesh that uses it
+	Geometry& geometry = *meshes[index].geometry;
+	const ShaderReadyMesh& shaderReadyMesh = shaderReadyMeshes[index];
+
+	if (geometry.boundingBoxes.size() == 0) return false;
+
+	if (!refitOnGPU)
+	{
+		// The tree always has the same amount of boxes for the same amount of triangles, so a rebuild still fits in the same range
+		bool rebuilt = geometry.RefitBoundingBoxes(rebuildThreshold);
+		UploadMeshGeometry(index, true);
+		return rebuilt;
+	}
+
+	// Upload the new vertices
+	UploadMeshGeometry(index, false);
+
+	// Upload the order in which the boxes have to be refitted
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_refitOrderSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, geometry.refitOrder.size() * sizeof(int), geometry.refitOrder.data(), GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_refitOrderSSBO);
+
+	glUseProgram(refitShaderID);
+	glUniform1i(glGetUniformLocation(refitShaderID, "triangleIndex"), shaderReadyMesh.triangleIndex);
+	glUniform1i(glGetUniformLocation(refitShaderID, "vertexIndex"), shaderReadyMesh.vertexIndex);
+	glUniform1i(glGetUniformLocation(refitShaderID, "boundingBoxIndex"), shaderReadyMesh.boundingBoxIndex);
+	glUniform1i(glGetUniformLocation(refitShaderID, "triangleStorage"), triangleStorage);
+	glUniform3fv(glGetUniformLocation(refitShaderID, "quantizationMin"), 1, glm::value_ptr(shaderReadyMesh.quantizationMin));
+	glUniform3fv(glGetUniformLocation(refitShaderID, "quantizationScale"), 1, glm::value_ptr(shaderReadyMesh.quantizationScale));
+
+	// Refit one level at a time, every level only depends on the level below it
+	for (int level = 0; level < (int)geometry.refitLevels.size() - 1; level++)
+	{
+		int levelStart = geometry.refitLevels[level];
+		int levelCount = geometry.refitLevels[level + 1] - levelStart;
+
+		glUniform1i(glGetUniformLocation(refitShaderID, "levelStart"), levelStart);
+		glUniform1i(glGetUniformLocation(refitShaderID, "levelCount"), levelCount);
+		glDispatchCompute((levelCount + 63) / 64, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	// Reading the buffer back needs the shader writes to be visible to buffer downloads as well
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	// The boxes on the CPU no longer match, they get refitted before they are uploaded again
+	geometry.boundingBoxesOutdated = true;
+
+	// Only read back the root box, it holds the surface area of the whole tree
+	BoundingBox root;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundingBoxesSSBO);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, shaderReadyMesh.boundingBoxIndex * sizeof(BoundingBox), sizeof(BoundingBox), &root);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	float rootSurfaceArea = root.SurfaceArea();
+	if (rootSurfaceArea > 0.0f && root.subtreeSurfaceArea / rootSurfaceArea > geometry.builtCost * rebuildThreshold)
+	{
+		geometry.UpdateBoundingBoxes();
+		UploadMeshGeometry(index, true);
+		return true;
+	}
+
+	return false;
 }
 
 void Scene::UpdateSSBO(GLuint shaderID)
 {
+	TRACE_SCOPE("Scene::UpdateSSBO");
+	TRACE_GPU_SCOPE("Scene::UpdateSSBO");
+
 	// Get all the scene data into a format our GPU can understand
-	std::vector<Triangle> shaderReadyTriangles;
+	std::vector<unsigned int> shaderReadyVertexData;
+	std::vector<PrecomputedTriangle> shaderReadyPrecomputedTriangles;
+	std::vector<glm::uvec3> shaderReadyIndices;
 	std::vector<BoundingBox> shaderReadyBoundingBoxes;
 	shaderReadyMeshes.clear();
+	// Where every geometry starts in the vertex, index and bounding box buffers
+	std::unordered_map<const Geometry*, ShaderReadyMesh> geometryRanges;
 	for (Mesh& mesh : meshes)
 	{
-		ShaderReadyMesh shaderReadyMesh;
+		Geometry& geometry = *mesh.geometry;
+
+		auto range = geometryRanges.find(&geometry);
+		if (range == geometryRanges.end())
+		{
+			// Bring the bounding boxes up to date after they were refitted on the GPU
+			if (geometry.boundingBoxesOutdated)
+			{
+				geometry.RefitBoundingBoxes(rebuildThreshold);
+			}
+
+			// First mesh that uses this geometry, so add it to the buffers
+			ShaderReadyMesh geometryRange;
+			geometryRange.triangleIndex = shaderReadyIndices.size();
+			geometryRange.nTriangles = geometry.indices.size();
+			geometryRange.boundingBoxIndex = shaderReadyBoundingBoxes.size();
+			geometryRange.nBoundingBoxes = geometry.boundingBoxes.size();
+			geometryRange.vertexIndex = shaderReadyVertexData.size() / GetVertexStride();
+			geometryRange.nVertices = geometry.vertices.size();
+
+			EncodeGeometry(geometry, shaderReadyVertexData, shaderReadyPrecomputedTriangles, shaderReadyBoundingBoxes, geometryRange.quantizationMin, geometryRange.quantizationScale);
+			shaderReadyIndices.insert(shaderReadyIndices.end(), geometry.indices.begin(), geometry.indices.end());
+
+			range = geometryRanges.emplace(&geometry, geometryRange).first;
+		}
+
+		ShaderReadyMesh shaderReadyMesh = range->second;
 
 		shaderReadyMesh.localToWorldMatrix = mesh.localToWorldMatrix;
 		shaderReadyMesh.modelWorldToLocalMatrix = mesh.modelWorldToLocalMatrix;
-		shaderReadyMesh.triangleIndex = shaderReadyTriangles.size();
-		shaderReadyMesh.nTriangles = mesh.triangles.size();
-		shaderReadyMesh.boundingBoxIndex = shaderReadyBoundingBoxes.size();
-		shaderReadyMesh.nBoundingBoxes = mesh.boundingBoxes.size();
 		shaderReadyMesh.material = mesh.material;
 
 		shaderReadyMeshes.push_back(shaderReadyMesh);
-
-		for (const Triangle& triangle : mesh.triangles)
-		{
-			shaderReadyTriangles.push_back(triangle);
-		}
-		for (const BoundingBox& boundingBox : mesh.boundingBoxes)
-		{
-			shaderReadyBoundingBoxes.push_back(boundingBox);
-		}
 	}
 
 	std::cout << shaderReadyMeshes.size() << "meshes\n";
+	std::cout << geometryRanges.size() << "unique geometries\n";
 	std::cout << shaderReadyBoundingBoxes.size() << "bounding boxes\n";
-	std::cout << shaderReadyTriangles.size() << "triangles\n";
+	std::cout << shaderReadyIndices.size() << "triangles\n";
+	std::cout << shaderReadyVertexData.size() / GetVertexStride() << "vertices\n";
 
 	// Activate the shader so we can upload the scene data
 	glUseProgram(shaderID);
@@ -109,39 +439,78 @@ void Scene::UpdateSSBO(GLuint shaderID)
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_spheresSSBO);
 	// Allocate storage for the SSBO
 	glBufferData(GL_SHADER_STORAGE_BUFFER, spheres.size() * sizeof(Sphere), spheres.data(), GL_DYNAMIC_DRAW);
-	// Update the triangle count uniform
-	glUniform1ui(glGetUniformLocation(shaderID, "nSpheres"), spheres.size());
 
 	// MESHES
 	// Bind the shader storage buffer
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_meshesSSBO);
 	// Allocate storage for the SSBO
 	glBufferData(GL_SHADER_STORAGE_BUFFER, shaderReadyMeshes.size() * sizeof(ShaderReadyMesh), shaderReadyMeshes.data(), GL_DYNAMIC_DRAW);
-	// Update the triangle count uniform
-	glUniform1ui(glGetUniformLocation(shaderID, "nMeshes"), shaderReadyMeshes.size());
 
 	// TRIANGLES
 	// Bind the shader storage buffer
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_trianglesSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_indicesSSBO);
+	// Allocate storage for the SSBO
+	glBufferData(GL_SHADER_STORAGE_BUFFER, shaderReadyIndices.size() * sizeof(glm::uvec3), shaderReadyIndices.data(), GL_DYNAMIC_DRAW);
+
+	// VERTICES
+	// Bind the shader storage buffer
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_verticesSSBO);
 	// Allocate storage for the SSBO
-	glBufferData(GL_SHADER_STORAGE_BUFFER, shaderReadyTriangles.size() * sizeof(Triangle), shaderReadyTriangles.data(), GL_DYNAMIC_DRAW);
-	// Update the triangle count uniform
-	glUniform1ui(glGetUniformLocation(shaderID, "nTriangles"), shaderReadyTriangles.size());
+	glBufferData(GL_SHADER_STORAGE_BUFFER, shaderReadyVertexData.size() * sizeof(unsigned int), shaderReadyVertexData.data(), GL_DYNAMIC_DRAW);
+
+	// PRECOMPUTED TRIANGLES
+	// Bind the shader storage buffer
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_precomputedTrianglesSSBO);
+	// Allocate storage for the SSBO, this stays empty when the triangles are not precomputed
+	glBufferData(GL_SHADER_STORAGE_BUFFER, shaderReadyPrecomputedTriangles.size() * sizeof(PrecomputedTriangle), shaderReadyPrecomputedTriangles.data(), GL_DYNAMIC_DRAW);
 
 	// BOUNDING BOXES
 	// Bind the shader storage buffer
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundingBoxesSSBO);
 	// Allocate storage for the SSBO
 	glBufferData(GL_SHADER_STORAGE_BUFFER, shaderReadyBoundingBoxes.size() * sizeof(BoundingBox), shaderReadyBoundingBoxes.data(), GL_DYNAMIC_DRAW);
-	// Update the triangle count uniform
-	glUniform1ui(glGetUniformLocation(shaderID, "nBoundingBoxes"), shaderReadyBoundingBoxes.size());
 
 	// Unbind the shader storage buffer
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
+	// Update the count uniforms
+	m_nUploadedSpheres = spheres.size();
+	m_nUploadedTriangles = shaderReadyIndices.size();
+	m_nUploadedBoundingBoxes = shaderReadyBoundingBoxes.size();
+	m_uploadedTriangleStorage = triangleStorage;
+	UploadUniforms(shaderID);
+
 	// Bind each shader storage buffer to a unique binding port
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_spheresSSBO);
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_meshesSSBO);
-	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_trianglesSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_indicesSSBO);
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_boundingBoxesSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_verticesSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, m_precomputedTrianglesSSBO);
+}
+
+void Scene::UploadUniforms(GLuint shaderID) const
+{
+	glUseProgram(shaderID);
+	glUniform1ui(glGetUniformLocation(shaderID, "nSpheres"), m_nUploadedSpheres);
+	glUniform1ui(glGetUniformLocation(shaderID, "nMeshes"), shaderReadyMeshes.size());
+	glUniform1ui(glGetUniformLocation(shaderID, "nTriangles"), m_nUploadedTriangles);
+	glUniform1ui(glGetUniformLocation(shaderID, "nBoundingBoxes"), m_nUploadedBoundingBoxes);
+	// Tell the shader how the vertices are stored
+	glUniform1i(glGetUniformLocation(shaderID, "triangleStorage"), m_uploadedTriangleStorage);
+}
+
+unsigned int Scene::GetUploadedSphereCount() const
+{
+	return m_nUploadedSpheres;
+}
+
+unsigned int Scene::GetUploadedMeshCount() const
+{
+	return shaderReadyMeshes.size();
+}
+
+TriangleStorage Scene::GetUploadedTriangleStorage() const
+{
+	return m_uploadedTriangleStorage;
 }
\ No newline at end of file
@@ -6,16 +6,47 @@
 #include "Camera.h"
 #include "Texture.h"
 #include "Shader.h"
+#include <filesystem>
+#include <unordered_map>
+
+// How the triangles are stored on the GPU
+enum TriangleStorage : int
+{
+	// Indexed vertices with full float positions
+	STORAGE_INDEXED,
+	// Indexed vertices with 16 bit positions relative to the bounds of their geometry
+	STORAGE_QUANTIZED,
+	// Indexed vertices plus the edges and normal of every triangle, uses more memory but less math per intersection
+	STORAGE_PRECOMPUTED
+};
 
 class Scene
 {
 private:
 	GLuint m_spheresSSBO;
 	GLuint m_meshesSSBO;
-	GLuint m_trianglesSSBO;
+	GLuint m_indicesSSBO;
+	GLuint m_verticesSSBO;
+	GLuint m_precomputedTrianglesSSBO;
 	GLuint m_boundingBoxesSSBO;
+	GLuint m_refitOrderSSBO;
 
 	std::vector<ShaderReadyMesh> shaderReadyMeshes;
+	// The counts of the last UpdateSSBO, so another shader can get the uniforms without uploading the buffers again
+	unsigned int m_nUploadedSpheres = 0;
+	unsigned int m_nUploadedTriangles = 0;
+	unsigned int m_nUploadedBoundingBoxes = 0;
+	TriangleStorage m_uploadedTriangleStorage = STORAGE_INDEXED;
+
+	// Every geometry that has been loaded, by file path, so the same file is only loaded and uploaded once
+	std::unordered_map<std::string, std::shared_ptr<Geometry>> m_geometryLibrary;
+
+	// The amount of values per vertex in the vertex buffer
+	int GetVertexStride() const;
+	// Adds the vertices, precomputed triangles and bounding boxes of a geometry in the format of the current triangle storage
+	void EncodeGeometry(const Geometry& geometry, std::vector<unsigned int>& vertexData, std::vector<PrecomputedTriangle>& precomputedTriangles, std::vector<BoundingBox>& boundingBoxes, glm::vec3& quantizationMin, glm::vec3& quantizationScale) const;
+	// Uploads the vertices, indices and optionally the bounding boxes of a mesh into its existing range of the shader storage buffers
+	void UploadMeshGeometry(const int& index, bool uploadBoundingBoxes);
 
 public:
 	std::vector<Sphere> spheres;
@@ -24,16 +55,46 @@ public:
 	Texture skybox;
 	Camera camera;
 
+	// How the triangles are stored on the GPU, needs an UpdateSSBO after changing
+	TriangleStorage triangleStorage = STORAGE_INDEXED;
+	// Refit the bounding boxes with a compute shader instead of on the CPU
+	bool refitOnGPU = true;
+	// How much slower the bounding boxes of a refitted mesh may get before they are rebuilt
+	float rebuildThreshold = 2.0f;
+
 	void Initialize();
 	void Uninitialize();
 
 	void UpdateMesh(GLuint shaderID, const int& index);
 	void UpdateSphere(GLuint shaderID, const int& index);
 
+	// Adds a new instance of the geometry in the file, the file is only loaded the first time. Nothing is added when it fails to load
 	void AddMesh(const char* file);
+	// Adds a new instance of a geometry that was loaded somewhere else, and puts it in the library if its file is not in there yet
+	void AddMesh(const std::shared_ptr<Geometry>& geometry);
+	// Adds a mesh with its own transform and material, its geometry goes through the library just like above
+	void AddMesh(const Mesh& mesh);
+	// Gets the geometry of a file from the library, or loads it if it is not in there yet. Returns nullptr when the file can not be loaded
+	std::shared_ptr<Geometry> LoadGeometry(const char* file);
+	// The full path is the library key, so different relative paths to the same file share the geometry
+	static std::string GetLibraryKey(const char* file);
+	// Gets the geometry of a file from the library, or nullptr if it has not been loaded
+	std::shared_ptr<Geometry> FindGeometry(const char* file) const;
+	// Swaps a reloaded geometry into every mesh that used its file, keeping their transforms and materials.
+	// Only the ranges of the geometry are uploaded, unless its size changed. Then it returns false and the scene needs an UpdateSSBO.
+	// A reload without bounding boxes that has the same triangles gets the vertices copied into the old geometry, which is refitted instead
+	bool ReloadGeometry(const std::shared_ptr<Geometry>& geometry, GLuint refitShaderID);
+	// Updates the bounding boxes after the triangles of a mesh have changed, returns true when they had to be rebuilt
+	bool RefitMesh(GLuint refitShaderID, const int& index);
 
 	// Updates the shader storage buffer with the scene data
 	void UpdateSSBO(GLuint shaderID);
+	// Uploads the object counts and triangle storage of the last UpdateSSBO to a shader
+	void UploadUniforms(GLuint shaderID) const;
+	// What is on the GPU since the last UpdateSSBO, which can differ from the scene until it is called again
+	unsigned int GetUploadedSphereCount() const;
+	unsigned int GetUploadedMeshCount() const;
+	TriangleStorage GetUploadedTriangleStorage() const;
 };
 
 #endif
\ No newline at end of file
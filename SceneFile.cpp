@@ -0,0 +1,259 @@
+#include "SceneFile.h"
+#include "Json.h"
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+
+static std::string WriteVector(const glm::vec3& vector)
+{
+	std::ostringstream text;
+	// Enough digits to read back the exact same floats
+	text << std::setprecision(9) << "[" << vector.x << ", " << vector.y << ", " << vector.z << "]";
+	return text.str();
+}
+
+static glm::vec3 ReadVector(const JsonValue& value, const glm::vec3& fallback)
+{
+	if (value.Size() != 3) return fallback;
+	return glm::vec3((float)value[0].AsNumber(fallback.x), (float)value[1].AsNumber(fallback.y), (float)value[2].AsNumber(fallback.z));
+}
+
+static void WriteMaterial(std::ostream& json, const Material& material, const char* indent)
+{
+	json << indent << "\"material\": {\n";
+	json << indent << "\t\"color\": " << WriteVector(material.color) << ",\n";
+	json << indent << "\t\"roughness\": " << material.roughness << ",\n";
+	json << indent << "\t\"emission_color\": " << WriteVector(material.emissionColor) << ",\n";
+	json << indent << "\t\"emission_strength\": " << material.emissionStrength << ",\n";
+	json << indent << "\t\"emission_scattering_index\": " << material.emissionScatteringIndex << ",\n";
+	json << indent << "\t\"absorb_color\": " << WriteVector(material.absorbColor) << ",\n";
+	json << indent << "\t\"absorbsion_strength\": " << material.absorbsionStrength << ",\n";
+	json << indent << "\t\"refractive_index\": " << material.refractiveIndex << ",\n";
+	json << indent << "\t\"reflective_index\": " << material.reflectiveIndex << "\n";
+	json << indent << "}";
+}
+
+static Material ReadMaterial(const JsonValue& value)
+{
+	// Anything that is left out gets the value of a newly added object
+	Material material({ 0.9f, 0.9f, 0.9f }, 0.8f, 0.0f, 0.5f, 1.0f, 1.5f, 1.0f);
+
+	material.color = ReadVector(value["color"], material.color);
+	material.roughness = (float)value["roughness"].AsNumber(material.roughness);
+	material.emissionColor = ReadVector(value["emission_color"], material.color);
+	material.emissionStrength = (float)value["emission_strength"].AsNumber(material.emissionStrength);
+	material.emissionScatteringIndex = (float)value["emission_scattering_index"].AsNumber(material.emissionScatteringIndex);
+	material.absorbColor = ReadVector(value["absorb_color"], glm::vec3(1.0f) - material.color);
+	material.absorbsionStrength = (float)value["absorbsion_strength"].AsNumber(material.absorbsionStrength);
+	material.refractiveIndex = (float)value["refractive_index"].AsNumber(material.refractiveIndex);
+	material.reflectiveIndex = (float)value["reflective_index"].AsNumber(material.reflectiveIndex);
+	return material;
+}
+
+bool SceneFile::Load(const std::string& file, SceneDocument& document)
+{
+	TRACE_SCOPE("SceneFile::Load", file);
+
+	std::ifstream in(file, std::ios::binary);
+	if (!in.is_open())
+	{
+		std::cout << "Failed to open scene: " << file << "\n";
+		return false;
+	}
+	std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	return Parse(text, document, file);
+}
+
+bool SceneFile::Parse(const std::string& text, SceneDocument& document, const std::string& name)
+{
+	JsonValue root;
+	try
+	{
+		root = JsonValue::Parse(text);
+	}
+	catch (const std::string& error)
+	{
+		std::cout << name << ": " << error << "\n";
+		return false;
+	}
+	return Read(root, document, name);
+}
+
+bool SceneFile::Read(const JsonValue& root, SceneDocument& document, const std::string& name)
+{
+	if (!root.IsObject())
+	{
+		std::cout << name << ": not a scene\n";
+		return false;
+	}
+
+	document = SceneDocument();
+
+	const JsonValue& camera = root["camera"];
+	document.cameraPosition = ReadVector(camera["position"], document.cameraPosition);
+	document.cameraRotation = ReadVector(camera["rotation"], document.cameraRotation);
+
+	const JsonValue& render = root["render"];
+	document.maxBounces = render["max_bounces"].AsInt(document.maxBounces);
+	document.samplesPerPixel = render["samples_per_pixel"].AsInt(document.samplesPerPixel);
+	document.perspectiveSlope = (float)render["perspective_slope"].AsNumber(document.perspectiveSlope);
+	document.focalDistance = (float)render["focal_distance"].AsNumber(document.focalDistance);
+	document.focalBlur = (float)render["focal_blur"].AsNumber(document.focalBlur);
+	const std::string& storage = render["triangle_storage"].AsString();
+	if (storage == "quantized") document.triangleStorage = STORAGE_QUANTIZED;
+	else if (storage == "precomputed") document.triangleStorage = STORAGE_PRECOMPUTED;
+
+	document.skybox = root["skybox"].AsString();
+
+	for (const JsonValue& value : root["spheres"].array)
+	{
+		SceneSphere sphere;
+		sphere.name = value["name"].AsString();
+		if (sphere.name.empty()) sphere.name = "Sphere" + std::to_string(document.spheres.size() + 1);
+		sphere.sphere.position = ReadVector(value["position"], glm::vec3(0.0f));
+		sphere.sphere.radius = (float)value["radius"].AsNumber(1.0);
+		sphere.sphere.material = ReadMaterial(value["material"]);
+		document.spheres.push_back(sphere);
+	}
+
+	for (const JsonValue& value : root["meshes"].array)
+	{
+		SceneMeshReference reference;
+		reference.file = value["file"].AsString();
+		if (reference.file.empty())
+		{
+			std::cout << name << ": skipped a mesh without a file\n";
+			continue;
+		}
+
+		reference.name = value["name"].AsString();
+		if (reference.name.empty()) reference.name = "Mesh" + std::to_string(document.meshes.size() + 1);
+		reference.mesh.position = ReadVector(value["position"], glm::vec3(0.0f));
+		reference.mesh.rotation = ReadVector(value["rotation"], glm::vec3(0.0f));
+		reference.mesh.scale = ReadVector(value["scale"], glm::vec3(1.0f));
+		reference.mesh.material = ReadMaterial(value["material"]);
+		reference.mesh.UpdateTransformMatrix();
+		document.meshes.push_back(reference);
+	}
+
+	return true;
+}
+
+bool SceneFile::Save(const std::string& file, const SceneDocument& document)
+{
+	TRACE_SCOPE("SceneFile::Save", file);
+
+	std::ofstream out(file, std::ios::binary);
+	if (!out.is_open())
+	{
+		std::cout << "Failed to save scene: " << file << "\n";
+		return false;
+	}
+	out << Write(document);
+	return out.good();
+}
+
+std::string SceneFile::Write(const SceneDocument& document)
+{
+	const char* storages[] = { "indexed", "quantized", "precomputed" };
+
+	std::ostringstream json;
+	json << std::setprecision(9);
+	json << "{\n";
+	json << "\t\"version\": 1,\n";
+	json << "\t\"camera\": {\n";
+	json << "\t\t\"position\": " << WriteVector(document.cameraPosition) << ",\n";
+	json << "\t\t\"rotation\": " << WriteVector(document.cameraRotation) << "\n";
+	json << "\t},\n";
+	json << "\t\"render\": {\n";
+	json << "\t\t\"max_bounces\": " << document.maxBounces << ",\n";
+	json << "\t\t\"samples_per_pixel\": " << document.samplesPerPixel << ",\n";
+	json << "\t\t\"perspective_slope\": " << document.perspectiveSlope << ",\n";
+	json << "\t\t\"focal_distance\": " << document.focalDistance << ",\n";
+	json << "\t\t\"focal_blur\": " << document.focalBlur << ",\n";
+	json << "\t\t\"triangle_storage\": \"" << storages[document.triangleStorage] << "\"\n";
+	json << "\t},\n";
+	json << "\t\"skybox\": " << JsonValue::Quote(document.skybox) << ",\n";
+
+	json << "\t\"spheres\": [\n";
+	for (int i = 0; i < (int)document.spheres.size(); i++)
+	{
+		const SceneSphere& sphere = document.spheres[i];
+		json << "\t\t{\n";
+		json << "\t\t\t\"name\": " << JsonValue::Quote(sphere.name) << ",\n";
+		json << "\t\t\t\"position\": " << WriteVector(sphere.sphere.position) << ",\n";
+		json << "\t\t\t\"radius\": " << sphere.sphere.radius << ",\n";
+		WriteMaterial(json, sphere.sphere.material, "\t\t\t");
+		json << "\n\t\t}" << (i + 1 < (int)document.spheres.size() ? "," : "") << "\n";
+	}
+	json << "\t],\n";
+
+	json << "\t\"meshes\": [\n";
+	for (int i = 0; i < (int)document.meshes.size(); i++)
+	{
+		const SceneMeshReference& reference = document.meshes[i];
+		json << "\t\t{\n";
+		json << "\t\t\t\"name\": " << JsonValue::Quote(reference.name) << ",\n";
+		json << "\t\t\t\"file\": " << JsonValue::Quote(reference.file) << ",\n";
+		json << "\t\t\t\"position\": " << WriteVector(reference.mesh.position) << ",\n";
+		json << "\t\t\t\"rotation\": " << WriteVector(reference.mesh.rotation) << ",\n";
+		json << "\t\t\t\"scale\": " << WriteVector(reference.mesh.scale) << ",\n";
+		WriteMaterial(json, reference.mesh.material, "\t\t\t");
+		json << "\n\t\t}" << (i + 1 < (int)document.meshes.size() ? "," : "") << "\n";
+	}
+	json << "\t]\n";
+	json << "}\n";
+	return json.str();
+}
+
+bool SceneFile::IsSafePath(const std::string& file)
+{
+	std::filesystem::path path(file);
+	if (file.empty() || path.is_absolute() || path.has_root_name() || path.has_root_directory()) return false;
+
+	for (const std::filesystem::path& part : path)
+	{
+		if (part == "..") return false;
+	}
+	return true;
+}
+
+bool SceneFile::HasSafePaths(const SceneDocument& document, std::string& error)
+{
+	if (!document.skybox.empty() && !IsSafePath(document.skybox))
+	{
+		error = "the skybox has to be a relative path without ..: " + document.skybox;
+		return false;
+	}
+	for (const SceneMeshReference& mesh : document.meshes)
+	{
+		if (!IsSafePath(mesh.file))
+		{
+			error = "the mesh files have to be relative paths without ..: " + mesh.file;
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string SceneFile::GetImportFile(const std::string& geometryFile)
+{
+	// The primitives of a .glb file are all imported with the file itself
+	size_t separator = geometryFile.find('#');
+	return separator == std::string::npos ? geometryFile : geometryFile.substr(0, separator);
+}
+
+std::shared_ptr<Geometry> SceneFile::FindImportedGeometry(const ImportResult& result, const std::string& geometryFile)
+{
+	std::string key = Scene::GetLibraryKey(geometryFile.c_str());
+	if (result.geometry && Scene::GetLibraryKey(result.geometry->file.c_str()) == key) return result.geometry;
+
+	for (const Mesh& mesh : result.meshes)
+	{
+		if (Scene::GetLibraryKey(mesh.geometry->file.c_str()) == key) return mesh.geometry;
+	}
+	return nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef SCENE_FILE_CLASS_H
+#define SCENE_FILE_CLASS_H
+
+#include <string>
+#include <vector>
+#include "Objects.h"
+#include "Importer.h"
+#include "Json.h"
+#include "Scene.h"
+
+struct SceneSphere
+{
+	std::string name;
+	Sphere sphere;
+};
+
+// A mesh in the document, its geometry is only loaded after the document has been read
+struct SceneMeshReference
+{
+	std::string name;
+	// The file of the geometry, a primitive of a .glb file is "file.glb#mesh.primitive"
+	std::string file;
+	// Everything but the geometry
+	Mesh mesh;
+};
+
+// Everything that is saved of a scene
+struct SceneDocument
+{
+	glm::vec3 cameraPosition = glm::vec3(0.0f);
+	glm::vec3 cameraRotation = glm::vec3(0.0f);
+
+	int maxBounces = 12;
+	int samplesPerPixel = 1;
+	float perspectiveSlope = 1.2f;
+	float focalDistance = 1.0f;
+	float focalBlur = 0.0f;
+	TriangleStorage triangleStorage = STORAGE_INDEXED;
+
+	std::string skybox;
+	std::vector<SceneSphere> spheres;
+	std::vector<SceneMeshReference> meshes;
+};
+
+// Reads and writes scene documents as JSON
+class SceneFile
+{
+public:
+	// Prints what went wrong and returns false when the file can not be read
+	static bool Load(const std::string& file, SceneDocument& document);
+	// The same for a document that is already in memory, the name is only used in the messages
+	static bool Parse(const std::string& text, SceneDocument& document, const std::string& name);
+	// The same for a document that is already parsed
+	static bool Read(const JsonValue& root, SceneDocument& document, const std::string& name);
+	static bool Save(const std::string& file, const SceneDocument& document);
+	// The JSON that Save writes
+	static std::string Write(const SceneDocument& document);
+
+	// Documents from other machines only get to name files below the working directory, so no absolute paths and no ..
+	static bool IsSafePath(const std::string& file);
+	// Whether the skybox and every mesh of the document have safe paths, the error names the first one that does not
+	static bool HasSafePaths(const SceneDocument& document, std::string& error);
+
+	// The file that has to be imported for the geometry of a mesh reference
+	static std::string GetImportFile(const std::string& geometryFile);
+	// The geometry of a mesh reference in a finished import of its file, or nullptr when the file does not have it
+	static std::shared_ptr<Geometry> FindImportedGeometry(const ImportResult& result, const std::string& geometryFile);
+};
+
+#endif
\ No newline at end of file
@@ -31,32 +31,257 @@ Shader::Shader(const char* vertexFile, const char* fragmentFile)
 	LoadFromFile(vertexFile, fragmentFile);
 }
 
-void Shader::LoadFromFile(const char* vertexFile, const char* fragmentFile)
+std::string Shader::AddDefines(const std::string& code, const std::string& defines)
 {
-	std::string vertexCode = get_file_contents(vertexFile);
-	std::string fragmentCode = get_file_contents(fragmentFile);
+	if (defines.empty()) return code;
+
+	size_t versionEnd = code.find('\n') + 1;
+	return code.substr(0, versionEnd) + defines + "#line 2\n" + code.substr(versionEnd);
+}
+
+std::string Shader::LoadSource(const std::string& file, std::vector<std::string>& included)
+{
+	if (std::find(included.begin(), included.end(), file) != included.end()) return "";
+
+	int sourceNumber = (int)included.size();
+	included.push_back(file);
+
+	std::istringstream code(get_file_contents(file.c_str()));
+	std::string source;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(code, line))
+	{
+		lineNumber++;
+
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+		{
+			source += line + "\n";
+			continue;
+		}
+
+		size_t open = line.find('"', start);
+		size_t close = line.find('"', open + 1);
+		if (open == std::string::npos || close == std::string::npos)
+		{
+			std::cout << "Invalid include in " << file << " on line " << lineNumber << "\n";
+			source += "\n";
+			continue;
+		}
+
+		std::filesystem::path includeFile = std::filesystem::path(file).parent_path() / line.substr(open + 1, close - open - 1);
+		int includeNumber = (int)included.size();
+
+		source += "#line 1 " + std::to_string(includeNumber) + "\n" + LoadSource(includeFile.string(), included);
+		source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceNumber) + "\n";
+	}
+
+	return source;
+}
+
+void Shader::LoadFromFile(const char* vertexFile, const char* fragmentFile, const std::string& defines)
+{
+	BeginLoadFromFile(vertexFile, fragmentFile, defines);
+	FinishLoad();
+}
+
+void Shader::BeginLoadFromFile(const char* vertexFile, const char* fragmentFile, const std::string& defines)
+{
+	TRACE_SCOPE("Shader::BeginLoadFromFile", fragmentFile);
+
+	std::vector<std::string> vertexIncluded, fragmentIncluded;
+	std::string vertexCode = AddDefines(LoadSource(vertexFile, vertexIncluded), defines);
+	std::string fragmentCode = AddDefines(LoadSource(fragmentFile, fragmentIncluded), defines);
+
+	m_cacheFile = GetCacheFile(vertexCode + fragmentCode);
+	if (LoadFromCache()) return;
+
+	EnableParallelCompile();
 
 	const char* vertexSource = vertexCode.c_str();
 	const char* fragmentSource = fragmentCode.c_str();
 
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexSource, NULL);
-	glCompileShader(vertexShader);
-	compileErrors(vertexShader, "vertex");
+	// Only start the work here, every status check waits for the driver to finish
+	m_vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(m_vertexShader, 1, &vertexSource, NULL);
+	glCompileShader(m_vertexShader);
+
+	m_fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(m_fragmentShader, 1, &fragmentSource, NULL);
+	glCompileShader(m_fragmentShader);
+
+	ID = glCreateProgram();
+	glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glAttachShader(ID, m_vertexShader);
+	glAttachShader(ID, m_fragmentShader);
+	glLinkProgram(ID);
+}
+
+bool Shader::IsReady()
+{
+	// Loaded from the cache, or already finished
+	if (m_vertexShader == 0) return true;
+	// Without parallel compilation FinishLoad blocks anyway
+	if (!EnableParallelCompile()) return true;
+
+	GLint completed = GL_FALSE;
+	glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed == GL_TRUE;
+}
+
+void Shader::FinishLoad()
+{
+	if (m_vertexShader == 0) return;
+
+	TRACE_SCOPE("Shader::FinishLoad", m_cacheFile.c_str());
+
+	compileErrors(m_vertexShader, "vertex");
+	compileErrors(m_fragmentShader, "fragment");
+	compileErrors(ID, "PROGRAM");
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+	if (linked == GL_TRUE) SaveToCache();
+
+	glDeleteShader(m_vertexShader);
+	glDeleteShader(m_fragmentShader);
+	m_vertexShader = 0;
+	m_fragmentShader = 0;
+}
+
+void Shader::LoadComputeFromFile(const char* computeFile)
+{
+	TRACE_SCOPE("Shader::LoadComputeFromFile", computeFile);
+
+	std::vector<std::string> included;
+	std::string computeCode = LoadSource(computeFile, included);
+
+	m_cacheFile = GetCacheFile(computeCode);
+	if (LoadFromCache()) return;
+
+	const char* computeSource = computeCode.c_str();
 
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-	glCompileShader(fragmentShader);
-	compileErrors(fragmentShader, "fragment");
+	GLuint computeShader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(computeShader, 1, &computeSource, NULL);
+	glCompileShader(computeShader);
+	compileErrors(computeShader, "compute");
 
 	ID = glCreateProgram();
-	glAttachShader(ID, vertexShader);
-	glAttachShader(ID, fragmentShader);
+	glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glAttachShader(ID, computeShader);
 	glLinkProgram(ID);
 	compileErrors(ID, "PROGRAM");
 
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+	GLint linked = GL_FALSE;
+	glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+	if (linked == GL_TRUE) SaveToCache();
+
+	glDeleteShader(computeShader);
+}
+
+bool Shader::EnableParallelCompile()
+{
+	static bool supported = false;
+	static bool initialized = false;
+	if (initialized) return supported;
+	initialized = true;
+
+	// Both extensions share the completion status enum
+	if (GLAD_GL_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		supported = true;
+	}
+	else if (GLAD_GL_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+		supported = true;
+	}
+	return supported;
+}
+
+std::string Shader::GetCacheFile(const std::string& source)
+{
+	std::string key = source;
+	key += (const char*)glGetString(GL_VENDOR);
+	key += (const char*)glGetString(GL_RENDERER);
+	key += (const char*)glGetString(GL_VERSION);
+
+	// 64 bit FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : key)
+	{
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ull;
+	}
+
+	std::ostringstream file;
+	file << "shadercache/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+	return file.str();
+}
+
+bool Shader::LoadFromCache()
+{
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats == 0) return false;
+
+	std::ifstream in(m_cacheFile, std::ios::binary | std::ios::ate);
+	if (!in.is_open()) return false;
+	std::streamoff fileSize = in.tellg();
+	in.seekg(0);
+
+	// The binary format and length, followed by the binary itself
+	GLenum format = 0;
+	uint32_t length = 0;
+	in.read((char*)&format, sizeof(GLenum));
+	in.read((char*)&length, sizeof(length));
+	if (!in || length == 0 || length > fileSize - (std::streamoff)(sizeof(GLenum) + sizeof(length))) return false;
+
+	// A cut off file is compiled again, instead of handing half a binary to the driver
+	std::vector<char> binary(length);
+	in.read(binary.data(), length);
+	if ((uint32_t)in.gcount() != length) return false;
+
+	ID = glCreateProgram();
+	glProgramBinary(ID, format, binary.data(), (GLsizei)binary.size());
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+	if (linked == GL_FALSE)
+	{
+		// The driver changed in a way its strings do not show, so compile it again
+		glDeleteProgram(ID);
+		ID = 0xffffffff;
+		return false;
+	}
+
+	return true;
+}
+
+void Shader::SaveToCache()
+{
+	GLint length = 0;
+	glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length == 0) return;
+
+	GLenum format = 0;
+	std::vector<char> binary(length);
+	glGetProgramBinary(ID, length, NULL, &format, binary.data());
+
+	std::filesystem::create_directories("shadercache");
+	std::ofstream out(m_cacheFile, std::ios::binary);
+	if (!out.is_open())
+	{
+		std::cout << "Failed to write shader cache: " << m_cacheFile << "\n";
+		return;
+	}
+
+	uint32_t binaryLength = (uint32_t)length;
+	out.write((const char*)&format, sizeof(GLenum));
+	out.write((const char*)&binaryLength, sizeof(binaryLength));
+	out.write(binary.data(), binary.size());
 }
 
 void Shader::Activate()
@@ -79,7 +304,7 @@ void Shader::compileErrors(unsigned int shader, const char* type)
 		if (hasCompiled == GL_FALSE)
 		{
 			glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-			std::cout << "SHADER_COMPILATION_ERROR for: " << type << "\n\n";
+			std::cout << "SHADER_COMPILATION_ERROR for: " << type << "\n" << infoLog << std::endl;
 		}
 	}
 	else
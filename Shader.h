@@ -10,6 +10,10 @@
 #include <string>
 #include <iomanip>
 #include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdint>
+#include "Trace.h"
 
 std::string get_file_contents(const char* filename);
 
@@ -20,12 +24,39 @@ public:
 	Shader();
 	Shader(const char* vertexFile, const char* fragmentFile);
 
-	void LoadFromFile(const char* vertexFile, const char* fragmentFile);
+	// The defines are added to the top of both shaders, one "#define NAME" per line. Both shaders may use #include "file", relative to the including file
+	void LoadFromFile(const char* vertexFile, const char* fragmentFile, const std::string& defines = "");
+	void LoadComputeFromFile(const char* computeFile);
+	// Starts compiling, with parallel shader compilation this returns before the driver is done. Loads the program from the binary cache when it is in there
+	void BeginLoadFromFile(const char* vertexFile, const char* fragmentFile, const std::string& defines = "");
+	// True once the program is linked, only blocks when the driver has no parallel shader compilation
+	bool IsReady();
+	// Waits for the program, reports the errors and stores it in the binary cache
+	void FinishLoad();
 	void Activate();
 	void Delete();
 
 private:
+	// The shaders that are compiling between BeginLoadFromFile and FinishLoad
+	GLuint m_vertexShader = 0;
+	GLuint m_fragmentShader = 0;
+	// Where the program binary is cached, named after the hash of the source and the driver
+	std::string m_cacheFile;
+
 	void compileErrors(unsigned int shader, const char* type);
+	// Puts the defines after the version line, and resets the line numbers so the errors still point at the right line
+	static std::string AddDefines(const std::string& code, const std::string& defines);
+	// Reads a shader and pastes in the files it includes, every file is only included once.
+	// Each file gets its own source string number in the line directives, so an error at 1(12) is on line 12 of the first included file
+	static std::string LoadSource(const std::string& file, std::vector<std::string>& included);
+
+	// Lets the driver compile on its own threads when it supports it, only does anything the first time
+	static bool EnableParallelCompile();
+	// The cache file for the source, the binary only works on the driver it came from so that is part of the hash
+	static std::string GetCacheFile(const std::string& source);
+	// Creates the program from the cached binary, returns false when it is not cached or the driver no longer accepts it
+	bool LoadFromCache();
+	void SaveToCache();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "Socket.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef _WIN32
+static const intptr_t INVALID_HANDLE = (intptr_t)INVALID_SOCKET;
+static void CloseSocketHandle(intptr_t handle) { closesocket((SOCKET)handle); }
+#else
+static const intptr_t INVALID_HANDLE = -1;
+static void CloseSocketHandle(intptr_t handle) { close((int)handle); }
+// Writing to a connection the other side closed should fail instead of ending the process
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#endif
+
+Socket::Socket(intptr_t handle) :
+	m_handle(handle)
+{}
+
+Socket::~Socket()
+{
+	Close();
+}
+
+Socket::Socket(Socket&& other) noexcept :
+	m_handle(other.m_handle)
+{
+	other.m_handle = INVALID_HANDLE;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_handle = other.m_handle;
+		other.m_handle = INVALID_HANDLE;
+	}
+	return *this;
+}
+
+bool Socket::Startup()
+{
+#ifdef _WIN32
+	static bool started = false;
+	if (!started)
+	{
+		WSADATA data;
+		started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}
+	return started;
+#else
+	return true;
+#endif
+}
+
+bool Socket::Listen(int port, bool loopbackOnly)
+{
+	Close();
+	if (!Startup()) return false;
+
+	m_handle = (intptr_t)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (m_handle == INVALID_HANDLE) return false;
+
+	// A restarted worker can take the port again right away
+	int reuse = 1;
+	setsockopt(m_handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+	address.sin_port = htons((unsigned short)port);
+	if (bind(m_handle, (const sockaddr*)&address, sizeof(address)) != 0 || listen(m_handle, 4) != 0)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+Socket Socket::Accept()
+{
+	intptr_t handle = (intptr_t)accept(m_handle, NULL, NULL);
+	if (handle == INVALID_HANDLE) return Socket();
+
+	Socket connection(handle);
+	// The messages are large and sent in one go, so there is nothing to gain from waiting for more data
+	int noDelay = 1;
+	setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+	return connection;
+}
+
+bool Socket::Connect(const std::string& address)
+{
+	size_t separator = address.find_last_of(':');
+	if (separator == std::string::npos) return false;
+	return Connect(address.substr(0, separator), std::atoi(address.substr(separator + 1).c_str()));
+}
+
+bool Socket::Connect(const std::string& host, int port)
+{
+	Close();
+	if (!Startup()) return false;
+
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	addrinfo* addresses = nullptr;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) return false;
+
+	// Take the first address that accepts the connection
+	for (addrinfo* address = addresses; address; address = address->ai_next)
+	{
+		m_handle = (intptr_t)socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if (m_handle == INVALID_HANDLE) continue;
+
+		if (connect(m_handle, address->ai_addr, (int)address->ai_addrlen) == 0) break;
+		Close();
+	}
+	freeaddrinfo(addresses);
+
+	if (m_handle == INVALID_HANDLE) return false;
+
+	int noDelay = 1;
+	setsockopt(m_handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+	return true;
+}
+
+void Socket::SetTimeout(double seconds)
+{
+#ifdef _WIN32
+	DWORD timeout = (DWORD)(seconds * 1000.0);
+#else
+	timeval timeout;
+	timeout.tv_sec = (time_t)seconds;
+	timeout.tv_usec = (suseconds_t)((seconds - (double)timeout.tv_sec) * 1000000.0);
+#endif
+	setsockopt(m_handle, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+	setsockopt(m_handle, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+bool Socket::SendAll(const void* data, size_t size)
+{
+	const char* bytes = (const char*)data;
+	while (size > 0)
+	{
+		// Both platforms take an int size, so send very large buffers in parts
+		int part = (int)std::min<size_t>(size, 1 << 30);
+#ifdef _WIN32
+		int sent = send((SOCKET)m_handle, bytes, part, 0);
+#else
+		int sent = (int)send((int)m_handle, bytes, part, SEND_FLAGS);
+#endif
+		if (sent <= 0) return false;
+
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+bool Socket::ReceiveAll(void* data, size_t size)
+{
+	char* bytes = (char*)data;
+	while (size > 0)
+	{
+		int part = (int)std::min<size_t>(size, 1 << 30);
+#ifdef _WIN32
+		int received = recv((SOCKET)m_handle, bytes, part, 0);
+#else
+		int received = (int)recv((int)m_handle, bytes, part, 0);
+#endif
+		// 0 means the other side closed the connection
+		if (received <= 0) return false;
+
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+int Socket::Receive(void* data, size_t size)
+{
+	int part = (int)std::min<size_t>(size, 1 << 30);
+#ifdef _WIN32
+	int received = recv((SOCKET)m_handle, (char*)data, part, 0);
+#else
+	int received = (int)recv((int)m_handle, (char*)data, part, 0);
+#endif
+	return received < 0 ? -1 : received;
+}
+
+bool Socket::IsOpen() const
+{
+	return m_handle != INVALID_HANDLE;
+}
+
+void Socket::Close()
+{
+	if (m_handle == INVALID_HANDLE) return;
+
+	CloseSocketHandle(m_handle);
+	m_handle = INVALID_HANDLE;
+}
\ No newline at end of file
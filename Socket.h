@@ -0,0 +1,47 @@
+#pragma once
+#ifndef SOCKET_CLASS_H
+#define SOCKET_CLASS_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// A blocking TCP connection, or a socket listening for them
+class Socket
+{
+	// A SOCKET on Windows and a file descriptor everywhere else, both fit in here
+	intptr_t m_handle = -1;
+
+	explicit Socket(intptr_t handle);
+	// Windows needs the socket library started before the first socket
+	static bool Startup();
+
+public:
+	Socket() = default;
+	~Socket();
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+	Socket(Socket&& other) noexcept;
+	Socket& operator=(Socket&& other) noexcept;
+
+	// Listens for connections on the port of every interface, or only for connections from this machine
+	bool Listen(int port, bool loopbackOnly = false);
+	// Waits for the next connection, the returned socket is closed when that failed
+	Socket Accept();
+	// Connects to "host:port", or to the host and port
+	bool Connect(const std::string& address);
+	bool Connect(const std::string& host, int port);
+	// Sending and receiving fail after this many seconds without progress, 0 waits forever
+	void SetTimeout(double seconds);
+
+	// Only return once everything has been sent or received, false when the connection broke or timed out
+	bool SendAll(const void* data, size_t size);
+	bool ReceiveAll(void* data, size_t size);
+	// Whatever has arrived, up to the size. Returns the amount of bytes, 0 when the other side closed the connection and -1 on an error or timeout
+	int Receive(void* data, size_t size);
+
+	bool IsOpen() const;
+	void Close();
+};
+
+#endif
\ No newline at end of file
@@ -39,6 +39,11 @@ void Texture::Unbind() const
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void Texture::BindImage(GLuint unit, GLenum access) const
+{
+	glBindImageTexture(unit, ID, 0, GL_FALSE, 0, access, GL_RGBA32F);
+}
+
 void Texture::Resize(int w, int h)
 {
 	m_width = w;
@@ -47,31 +52,78 @@ void Texture::Resize(int w, int h)
 	// Set this texture current
 	Bind();
 	// Resize the texture
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, m_width, m_height, 0, GL_RGB, GL_FLOAT, NULL);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, m_width, m_height, 0, GL_RGBA, GL_FLOAT, NULL);
 	// Unbind the texture to not accidentally make changes to it
 	Unbind();
 }
 
-void Texture::LoadFromFile(const char* file)
+bool ImageData::LoadFromFile(const char* file)
 {
-	int bpp = 0;
-	unsigned char* data = stbi_load(file, &m_width, &m_height, &bpp, 3);
-	if (!data)
+	TRACE_SCOPE("ImageData::LoadFromFile", file);
+
+	// Keep the data in the format of the file, the driver converts it straight into the internal format
+	isHDR = stbi_is_hdr(file);
+	void* data = nullptr;
+	if (isHDR)
+	{
+		data = stbi_loadf(file, &width, &height, nullptr, 3);
+	}
+	else
+	{
+		data = stbi_load(file, &width, &height, nullptr, 3);
+	}
+
+	if (!data) return false;
+
+	size_t size = (size_t)width * height * 3 * (isHDR ? sizeof(float) : 1);
+	pixels.assign((unsigned char*)data, (unsigned char*)data + size);
+	stbi_image_free(data);
+	return true;
+}
+
+void Texture::LoadFromFile(const char* file, GLenum internalFormat)
+{
+	TRACE_SCOPE("Texture::LoadFromFile", file);
+
+	ImageData image;
+	if (!image.LoadFromFile(file))
 	{
 		throw std::string("Failed to load image");
 		return;
 	}
 
-	// Convert the image to a normalized array of floats
-	std::vector<float> dataNormalized(m_width * m_height * 3, 0.0f);
-	for (int i = 0; i < m_width * m_height * 3; i++)
+	Upload(image, internalFormat);
+}
+
+void Texture::Upload(const ImageData& image, GLenum internalFormat)
+{
+	m_width = image.width;
+	m_height = image.height;
+
+	if (internalFormat == GL_NONE)
 	{
-		dataNormalized[i] = (float)data[i] / 255.0f;
+		// Shared exponent keeps the HDR range in 4 bytes per pixel. The 8 bit images are sampled as they are stored, like they always were
+		internalFormat = image.isHDR ? GL_RGB9_E5 : GL_RGB8;
 	}
 
-	stbi_image_free(data);
+	// Immutable storage can not be resized, so start over with a new texture
+	glDeleteTextures(1, &ID);
+	glGenTextures(1, &ID);
+	Bind();
 
-	SetTextureData(m_width, m_height, dataNormalized.data());
+	// The shaders only ever sample the full resolution, so there are no mipmaps
+	glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, m_width, m_height);
+
+	// The rows of an RGB8 image are not always 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGB, image.isHDR ? GL_FLOAT : GL_UNSIGNED_BYTE, image.pixels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Unbind the texture to not accidentally make changes to it
+	Unbind();
 }
 
 void Texture::GetTextureData(int& w, int& h, std::vector<float>& data) const
@@ -96,7 +148,7 @@ void Texture::SetTextureData(int w, int h, float* data)
 	// Set this texture current
 	Bind();
 	// Upload the texture data
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, m_width, m_height, 0, GL_RGB, GL_FLOAT, data);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, m_width, m_height, 0, GL_RGB, GL_FLOAT, data);
 	// Unbind the texture to not accidentally make changes to it
 	Unbind();
 }
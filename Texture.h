@@ -8,8 +8,20 @@
 #include <vector>
 #include <stb/stb_image.h>
 #include <stb/stb_image_write.h>
+#include "Trace.h"
 
-// A simple 32bit float RGB texture format
+// The pixels of an image file, decoded on any thread so they can be uploaded later
+struct ImageData
+{
+	int width = 0, height = 0;
+	// 32 bit float RGB for Radiance .hdr images, 8 bit RGB otherwise
+	bool isHDR = false;
+	std::vector<unsigned char> pixels;
+
+	bool LoadFromFile(const char* file);
+};
+
+// A simple texture, 32bit float RGBA for render targets or a compact mipmapped format for images loaded from file
 class Texture
 {
 private:
@@ -25,9 +37,14 @@ public:
 	void Delete();
 	void Bind() const;
 	void Unbind() const;
+	// Bind level 0 to an image unit for imageLoad and imageStore
+	void BindImage(GLuint unit, GLenum access) const;
 
 	void Resize(int width, int height);
-	void LoadFromFile(const char* file);
+	// Loads an 8 bit image as RGB8, or a Radiance .hdr image as RGB9_E5, unless another internal format is given
+	void LoadFromFile(const char* file, GLenum internalFormat = GL_NONE);
+	// Uploads an image that was already decoded, with the same formats as LoadFromFile
+	void Upload(const ImageData& image, GLenum internalFormat = GL_NONE);
 
 	void GetTextureData(int& width, int& height, std::vector<float>& data) const;
 	void SetTextureData(int width, int height, float* data);
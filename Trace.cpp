@@ -0,0 +1,186 @@
+#include "Trace.h"
+#include "Json.h"
+
+Tracer::Tracer() :
+	m_start(std::chrono::steady_clock::now())
+{
+	m_events.resize(CAPACITY);
+}
+
+Tracer& Tracer::Get()
+{
+	static Tracer tracer;
+	return tracer;
+}
+
+uint64_t Tracer::Now() const
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+uint32_t Tracer::GetThreadIndex()
+{
+	static std::atomic<uint32_t> nextThreadIndex = 1;
+	thread_local uint32_t threadIndex = nextThreadIndex++;
+	return threadIndex;
+}
+
+void Tracer::Record(TraceEvent&& event)
+{
+	if (!enabled) return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_events[m_nEvents % CAPACITY] = std::move(event);
+	m_nEvents++;
+}
+
+TraceScope::~TraceScope()
+{
+	Tracer& tracer = Tracer::Get();
+	if (!tracer.enabled) return;
+
+	TraceEvent event;
+	event.name = m_name;
+	event.detail = std::move(m_detail);
+	event.start = m_start;
+	event.duration = tracer.Now() - m_start;
+	event.thread = Tracer::GetThreadIndex();
+	tracer.Record(std::move(event));
+}
+
+void Tracer::SyncGpuClock()
+{
+	// Both clocks are read at practically the same moment
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	m_gpuOffset = (int64_t)Now() - gpuTime / 1000;
+}
+
+void Tracer::EnableGpu()
+{
+	m_gpuEnabled = true;
+	SyncGpuClock();
+}
+
+void Tracer::DisableGpu()
+{
+	m_gpuEnabled = false;
+
+	for (const PendingGpuSpan& span : m_pendingGpuSpans)
+	{
+		m_freeQueries.push_back(span.begin);
+		m_freeQueries.push_back(span.end);
+	}
+	m_pendingGpuSpans.clear();
+
+	glDeleteQueries((GLsizei)m_freeQueries.size(), m_freeQueries.data());
+	m_freeQueries.clear();
+}
+
+bool Tracer::IsGpuEnabled() const
+{
+	return m_gpuEnabled;
+}
+
+GLuint Tracer::BeginGpuSpan()
+{
+	if (!m_gpuEnabled || !enabled) return 0;
+
+	GLuint query;
+	if (m_freeQueries.empty())
+	{
+		glGenQueries(1, &query);
+	}
+	else
+	{
+		query = m_freeQueries.back();
+		m_freeQueries.pop_back();
+	}
+
+	glQueryCounter(query, GL_TIMESTAMP);
+	return query;
+}
+
+void Tracer::EndGpuSpan(const char* name, GLuint beginQuery)
+{
+	if (beginQuery == 0) return;
+
+	GLuint query;
+	if (m_freeQueries.empty())
+	{
+		glGenQueries(1, &query);
+	}
+	else
+	{
+		query = m_freeQueries.back();
+		m_freeQueries.pop_back();
+	}
+
+	glQueryCounter(query, GL_TIMESTAMP);
+	m_pendingGpuSpans.push_back({ name, beginQuery, query });
+}
+
+void Tracer::Collect()
+{
+	if (!m_gpuEnabled) return;
+
+	// The spans finish in order, so stop at the first one that is not done yet
+	while (!m_pendingGpuSpans.empty())
+	{
+		const PendingGpuSpan& span = m_pendingGpuSpans.front();
+
+		GLint available = 0;
+		glGetQueryObjectiv(span.end, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) break;
+
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(span.begin, GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(span.end, GL_QUERY_RESULT, &end);
+
+		TraceEvent event;
+		event.name = span.name;
+		event.start = (uint64_t)std::max<int64_t>((int64_t)(begin / 1000) + m_gpuOffset, 0);
+		event.duration = (end - begin) / 1000;
+		event.thread = GPU_THREAD;
+		Record(std::move(event));
+
+		m_freeQueries.push_back(span.begin);
+		m_freeQueries.push_back(span.end);
+		m_pendingGpuSpans.pop_front();
+	}
+
+	// The clocks drift apart slowly, so keep them in line
+	SyncGpuClock();
+}
+
+bool Tracer::WriteJSON(const std::string& file)
+{
+	// Copy the events, so recording can go on while the file is written
+	std::vector<TraceEvent> events;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		uint64_t first = m_nEvents > CAPACITY ? m_nEvents - CAPACITY : 0;
+		for (uint64_t i = first; i < m_nEvents; i++)
+		{
+			events.push_back(m_events[i % CAPACITY]);
+		}
+	}
+
+	std::ofstream out(file, std::ios::binary);
+	if (!out.is_open()) return false;
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_THREAD << ",\"name\":\"thread_name\",\"args\":{\"name\":\"GPU\"}}";
+	for (const TraceEvent& event : events)
+	{
+		out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << ",\"name\":" << JsonValue::Quote(event.name);
+		if (!event.detail.empty())
+		{
+			out << ",\"args\":{\"detail\":" << JsonValue::Quote(event.detail) << "}";
+		}
+		out << "}";
+	}
+	out << "\n]}\n";
+
+	return out.good();
+}
\ No newline at end of file
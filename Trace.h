@@ -0,0 +1,112 @@
+#pragma once
+#ifndef TRACE_CLASS_H
+#define TRACE_CLASS_H
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A single span on the timeline, in microseconds since the tracer started
+struct TraceEvent
+{
+	// Always a string literal, so only the pointer is kept
+	const char* name = nullptr;
+	// An optional detail like a file name, shown as an argument of the span
+	std::string detail;
+	uint64_t start = 0;
+	uint64_t duration = 0;
+	// The thread the span ran on, GPU spans use their own thread
+	uint32_t thread = 0;
+};
+
+// Records spans into a ring buffer and writes them as a chrome://tracing / Perfetto JSON file on demand
+class Tracer
+{
+	// The oldest events are overwritten once this many have been recorded
+	static const int CAPACITY = 65536;
+
+	std::mutex m_mutex;
+	std::vector<TraceEvent> m_events;
+	uint64_t m_nEvents = 0;
+	std::chrono::steady_clock::time_point m_start;
+
+	// GPU spans wait here until their timestamps are available
+	struct PendingGpuSpan
+	{
+		const char* name;
+		GLuint begin, end;
+	};
+	bool m_gpuEnabled = false;
+	std::deque<PendingGpuSpan> m_pendingGpuSpans;
+	std::vector<GLuint> m_freeQueries;
+	// GPU timestamps plus this offset are on the same timeline as the CPU spans
+	int64_t m_gpuOffset = 0;
+
+	Tracer();
+	void SyncGpuClock();
+
+public:
+	static const uint32_t GPU_THREAD = 0xffff;
+
+	// Nothing is recorded while this is off
+	std::atomic<bool> enabled = true;
+
+	static Tracer& Get();
+	// The microseconds since the tracer started
+	uint64_t Now() const;
+	// A small number for the current thread, in the order the threads first recorded something
+	static uint32_t GetThreadIndex();
+
+	void Record(TraceEvent&& event);
+
+	// GPU spans need a current OpenGL context, and have to be collected on the thread that owns it
+	void EnableGpu();
+	void DisableGpu();
+	bool IsGpuEnabled() const;
+	GLuint BeginGpuSpan();
+	void EndGpuSpan(const char* name, GLuint beginQuery);
+	// Turns the GPU spans that have finished into events, never waits on the GPU
+	void Collect();
+
+	// Writes every event in the ring buffer, returns false if the file could not be written
+	bool WriteJSON(const std::string& file);
+};
+
+// Records the CPU time until the end of the scope
+class TraceScope
+{
+	const char* m_name;
+	std::string m_detail;
+	uint64_t m_start;
+
+public:
+	TraceScope(const char* name) : m_name(name), m_start(Tracer::Get().Now()) {}
+	TraceScope(const char* name, const std::string& detail) : m_name(name), m_detail(detail), m_start(Tracer::Get().Now()) {}
+	~TraceScope();
+};
+
+// Records the GPU time of the commands issued until the end of the scope, when GPU tracing is enabled
+class GpuTraceScope
+{
+	const char* m_name;
+	GLuint m_beginQuery;
+
+public:
+	GpuTraceScope(const char* name) : m_name(name), m_beginQuery(Tracer::Get().BeginGpuSpan()) {}
+	~GpuTraceScope() { Tracer::Get().EndGpuSpan(m_name, m_beginQuery); }
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// Traces the rest of the scope, the name has to be a string literal
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
+#define TRACE_GPU_SCOPE(name) GpuTraceScope TRACE_CONCAT(gpuTraceScope, __LINE__)(name)
+
+#endif
\ No newline at end of file
@@ -1,10 +0,0 @@
-#version 460 core
-
-layout (location = 0) in vec2 aPos;
-out vec2 texCoords;
-
-void main()
-{
-    gl_Position = vec4(aPos.x, aPos.y, 0.0, 1.0); 
-    texCoords = aPos / 2.0f + vec2(0.5f);
-}  
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 450 core
+precision highp float;
+
+// Shows the accumulation image as it is, for the pixels outside of a crop region that the raytrace shader skips
+
+layout(rgba32f, binding = 0) uniform readonly image2D accumulation;
+
+out vec4 FragColor;
+
+void main()
+{
+	vec4 sum = imageLoad(accumulation, ivec2(gl_FragCoord.xy));
+	FragColor = vec4(clamp(sum.rgb / max(sum.a, 1.0f), 0.0f, 1.0f), 1.0f);
+}
\ No newline at end of file
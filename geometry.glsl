@@ -0,0 +1,47 @@
+// The triangle and bounding box storage, shared by the raytrace and refit shaders
+
+// Triangle storage formats
+const int STORAGE_INDEXED = 0;
+const int STORAGE_QUANTIZED = 1;
+const int STORAGE_PRECOMPUTED = 2;
+
+// The edges and unnormalized normal of a triangle, the normal is stored in the w components
+struct PrecomputedTriangle
+{
+	vec4 a;
+	vec4 edgeAB;
+	vec4 edgeAC;
+};
+
+struct BoundingBox
+{
+	vec3 min;
+	float padding;
+	vec3 max;
+	float padding2;
+
+	int triangleIndex;
+	int boundingBoxAIndex;
+	int boundingBoxBIndex;
+	float subtreeSurfaceArea;
+};
+
+layout(std430, binding = 2) buffer indexBuffer {
+    uint indices[];
+};
+layout(std430, binding = 3) buffer boundingBoxBuffer {
+    BoundingBox boundingBoxes[];
+};
+layout(std430, binding = 5) buffer vertexBuffer {
+    uint vertexData[];
+};
+layout(std430, binding = 6) buffer precomputedTriangleBuffer {
+    PrecomputedTriangle precomputedTriangles[];
+};
+
+// A specialized variant has the storage format baked in, so only its vertex fetch is compiled
+#ifdef TRIANGLE_STORAGE
+const int triangleStorage = TRIANGLE_STORAGE;
+#else
+uniform int triangleStorage;
+#endif
\ No newline at end of file
@@ -0,0 +1,21 @@
+#version 450 core
+precision highp float;
+
+// Shown while the raytrace shader is still compiling, only the sky without any objects
+
+#include "sky.glsl"
+
+uniform mat4 cameraRotation;
+uniform float aspectRatio;
+uniform float perspectiveSlope;
+
+in vec2 coordinate;
+out vec4 FragColor;
+
+void main()
+{
+	vec3 rayNormal = normalize(vec3(coordinate.x * perspectiveSlope, coordinate.y * perspectiveSlope * aspectRatio, 1.0f));
+	rayNormal = (cameraRotation * vec4(rayNormal, 0.0f)).xyz;
+
+	FragColor = vec4(clamp(SkyColor(rayNormal), 0.0f, 1.0f), 1.0f);
+}
\ No newline at end of file
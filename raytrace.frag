@@ -1,8 +1,10 @@
-#version 460 core
+#version 450 core
 precision highp float;
 
 const float infinity = 0x7F800000;
 
+#include "geometry.glsl"
+
 struct Material
 {
 	vec3 color;
@@ -30,20 +32,7 @@ struct Sphere
 
 struct Triangle
 {
-	vec4 p[3];
-};
-
-struct BoundingBox
-{
-	vec3 min;
-	float padding;
-	vec3 max;
-	float padding2;
-
-	int triangleIndex;
-	int boundingBoxAIndex;
-	int boundingBoxBIndex;
-	float padding3;
+	vec3 p[3];
 };
 
 struct Mesh
@@ -57,6 +46,11 @@ struct Mesh
 	int boundingBoxIndex;
 	int nBoundingBoxes;
 
+	vec3 quantizationMin;
+	int vertexIndex;
+	vec3 quantizationScale;
+	int nVertices;
+
 	Material material;
 };
 
@@ -102,42 +96,101 @@ HitInfo EmptyHitInfo()
 
 
 
-// Scene uniforms
+// Scene uniforms, a specialized variant without spheres or meshes has their counts baked in as zero so their code is dropped
+#ifdef NO_SPHERES
+const uint nSpheres = 0u;
+#else
 uniform uint nSpheres;
+#endif
 layout(std430, binding = 0) buffer sphereBuffer {
     Sphere spheres[];
 };
+#ifdef NO_MESHES
+const uint nMeshes = 0u;
+const uint nTriangles = 0u;
+#else
 uniform uint nMeshes;
+uniform uint nTriangles;
+#endif
 layout(std430, binding = 1) buffer meshBuffer {
     Mesh meshes[];
 };
-uniform uint nTriangles;
-layout(std430, binding = 2) buffer triangleBuffer {
-    Triangle triangles[];
-};
 uniform uint nBoundingBoxes;
-layout(std430, binding = 3) buffer boundingBoxBuffer {
-    BoundingBox boundingBoxes[];
-};
 
 uniform mat4 cameraRotation;
 uniform vec3 cameraPosition;
 
-uniform sampler2D skybox;
+#include "sky.glsl"
 
 // Runtime dependent uniforms
 uniform uint frame;
+// Shifts the frame the random sequence of every frame belongs to, so renders with a different offset use independent samples
+uniform uint sampleOffset;
+// Renders with a different stream never share a random sequence, whatever their frames are
+uniform uint sampleStream;
+// The running sum in rgb and the sample count in alpha, only used in render mode
+layout(rgba32f, binding = 0) uniform image2D accumulation;
+uniform bool accumulate;
 uniform float aspectRatio;
 
-// Raytracing settings
+// Raytracing settings, the specialized variants have some of them baked in as constants so the loops can be unrolled
+#ifdef MAX_BOUNCES
+const int maxBounces = MAX_BOUNCES;
+#else
 uniform int maxBounces;
+#endif
+#ifdef SAMPLES_PER_PIXEL
+const int samplesPerPixel = SAMPLES_PER_PIXEL;
+#else
 uniform int samplesPerPixel;
+#endif
 uniform float perspectiveSlope;
 uniform float focalDistance;
+#ifndef NO_FOCAL_BLUR
 uniform float focalBlur;
+#endif
+#ifndef NO_BLUR
 uniform float blur;
+#endif
+
+#ifdef INSTRUMENTATION
+// Totals of every pixel since the renderer last read them
+// Every total is a low and a high half, the box tests of one frame at a high resolution are already too many for 32 bits
+layout(std430, binding = 7) buffer statisticsBuffer {
+	uint totals[10];
+	uint maxStackDepth;
+};
+
+const int TOTAL_PATHS = 0;
+const int TOTAL_RAYS = 1;
+const int TOTAL_BOX_TESTS = 2;
+const int TOTAL_TRIANGLE_TESTS = 3;
+const int TOTAL_BOUNCES = 4;
+
+void AddToTotal(int total, uint value)
+{
+	// Only the add that wraps the low half around carries into the high half
+	uint low = atomicAdd(totals[total * 2], value);
+	if (low > 0xFFFFFFFFu - value) atomicAdd(totals[total * 2 + 1], 1u);
+}
+
+// What to show instead of the shaded image, and the count that is shown as the hottest color
+uniform int debugView;
+uniform float heatmapScale;
 
+const int DEBUG_VIEW_SHADED = 0;
+const int DEBUG_VIEW_BOX_TESTS = 1;
+const int DEBUG_VIEW_TRIANGLE_TESTS = 2;
+const int DEBUG_VIEW_STACK_DEPTH = 3;
+const int DEBUG_VIEW_BOUNCES = 4;
 
+// The counts of this pixel
+uint statRays = 0;
+uint statBoxTests = 0;
+uint statTriangleTests = 0;
+uint statBounces = 0;
+uint statStackDepth = 0;
+#endif
 
 
 
@@ -149,6 +202,16 @@ uniform float blur;
 
 
 
+
+
+// The PCG hash, a permutation of the 32 bit integers where every input bit changes every output bit
+uint Hash(uint value)
+{
+	uint state = value * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28) + 4)) ^ state) * 277803737u;
+	return (word >> 22) ^ word;
+}
+
 float Random(inout uint seed)
 {
 	seed = seed * 747796405u + 2891336453u;
@@ -326,27 +389,76 @@ HitInfo HitSphere(Ray ray, Sphere sphere)
 	return HitInfo(1, distance, point, normal, flippedNormal, sphere.material);
 }
 
-HitInfo HitTriangle(Ray ray, Triangle triangle)
+vec3 GetVertex(Mesh mesh, uint index)
 {
-	vec3 edgeAB = triangle.p[1].xyz - triangle.p[0].xyz;
-	vec3 edgeAC = triangle.p[2].xyz - triangle.p[0].xyz;
-	vec3 normal = cross(edgeAB, edgeAC);
+	if (triangleStorage == STORAGE_QUANTIZED)
+	{
+		// 16 bits per axis, relative to the bounds of the geometry
+		uint offset = (mesh.vertexIndex + index) * 2;
+		uint xy = vertexData[offset];
+		uint z = vertexData[offset + 1];
+
+		return mesh.quantizationMin + vec3(xy & 0xFFFFu, xy >> 16, z & 0xFFFFu) * mesh.quantizationScale;
+	}
+
+	uint offset = (mesh.vertexIndex + index) * 3;
+	return uintBitsToFloat(uvec3(vertexData[offset], vertexData[offset + 1], vertexData[offset + 2]));
+}
+
+Triangle GetTriangle(Mesh mesh, int triangleIndex)
+{
+	uint offset = (mesh.triangleIndex + triangleIndex) * 3;
+
+	Triangle triangle;
+	triangle.p[0] = GetVertex(mesh, indices[offset]);
+	triangle.p[1] = GetVertex(mesh, indices[offset + 1]);
+	triangle.p[2] = GetVertex(mesh, indices[offset + 2]);
+	return triangle;
+}
+
+void GetTriangleEdges(Mesh mesh, int triangleIndex, out vec3 a, out vec3 edgeAB, out vec3 edgeAC, out vec3 normal)
+{
+	if (triangleStorage == STORAGE_PRECOMPUTED)
+	{
+		PrecomputedTriangle triangle = precomputedTriangles[mesh.triangleIndex + triangleIndex];
+		a = triangle.a.xyz;
+		edgeAB = triangle.edgeAB.xyz;
+		edgeAC = triangle.edgeAC.xyz;
+		normal = vec3(triangle.a.w, triangle.edgeAB.w, triangle.edgeAC.w);
+		return;
+	}
+
+	Triangle triangle = GetTriangle(mesh, triangleIndex);
+	a = triangle.p[0];
+	edgeAB = triangle.p[1] - triangle.p[0];
+	edgeAC = triangle.p[2] - triangle.p[0];
+	normal = cross(edgeAB, edgeAC);
+}
+
+// Only calculates the distance to the triangle, or infinity if the ray misses it. The rest of the hit info is only needed for the closest hit
+float IntersectTriangle(Ray ray, Mesh mesh, int triangleIndex)
+{
+#ifdef INSTRUMENTATION
+	statTriangleTests++;
+#endif
+	vec3 a, edgeAB, edgeAC, normal;
+	GetTriangleEdges(mesh, triangleIndex, a, edgeAB, edgeAC, normal);
 
 	float determinant = -dot(ray.normal, normal);
 	
 	if (determinant == 0.0f || (determinant < 0.0f && ray.surfaceNormalDot > 0.0f) || (determinant > 0.0f && ray.surfaceNormalDot < 0.0f))
 	{
-		return EmptyHitInfo();
+		return infinity;
 	}
 
-	vec3 ao = ray.origin - triangle.p[0].xyz;
+	vec3 ao = ray.origin - a;
 
 	float invDet = 1.0f / determinant;
 
 	float distance = dot(ao, normal) * invDet;
 	if (distance <= 0.0f)
 	{
-		return EmptyHitInfo();
+		return infinity;
 	}
 
 	vec3 dao = cross(ao, ray.normal);
@@ -354,19 +466,33 @@ HitInfo HitTriangle(Ray ray, Triangle triangle)
 	float u = dot(edgeAC, dao) * invDet;
 	float v = -dot(edgeAB, dao) * invDet;
 
-	if (u < 0 || v < 0 || 1.0f - u - v < 0) return EmptyHitInfo();
+	if (u < 0 || v < 0 || 1.0f - u - v < 0) return infinity;
+
+	return distance;
+}
 
+HitInfo TriangleHitInfo(Ray ray, Ray transformedRay, Mesh mesh, int triangleIndex, float distance)
+{
+	vec3 a, edgeAB, edgeAC, normal;
+	GetTriangleEdges(mesh, triangleIndex, a, edgeAB, edgeAC, normal);
+
+	float determinant = -dot(transformedRay.normal, normal);
+
+	// The transformed ray has the same distances as the world space ray
 	vec3 point = ray.origin + ray.normal * distance;
 
 	normal = normalize(normal);
 	vec3 flippedNormal = normal;
 	if (determinant < 0.0f) flippedNormal = -flippedNormal;
 
-	return HitInfo(1, distance, point, normal, flippedNormal, EmptyMaterial());
+	return HitInfo(1, distance, point, normal, flippedNormal, mesh.material);
 }
 
 float HitBoundingBox(Ray ray, BoundingBox boundingBox)
 {
+#ifdef INSTRUMENTATION
+	statBoxTests++;
+#endif
 	vec3 invDirection = vec3(1.0f, 1.0f, 1.0f) / ray.normal;
 	vec3 tMin = (boundingBox.min - ray.origin) * invDirection;
 	vec3 tMax = (boundingBox.max - ray.origin) * invDirection;
@@ -416,6 +542,11 @@ void CheckTriangleCollitions(Ray ray, inout HitInfo closestHit)
 {
 	if (nTriangles == 0) return;
 
+	// The closest triangle so far
+	int closestMeshIndex = -1;
+	int closestTriangleIndex = -1;
+	Ray closestTransformedRay;
+
 	for (int meshIndex = 0; meshIndex < nMeshes; meshIndex++)
 	{
 		Mesh mesh = meshes[meshIndex];
@@ -468,15 +599,16 @@ void CheckTriangleCollitions(Ray ray, inout HitInfo closestHit)
 			{
 				if (currentBox.triangleIndex != -1)
 				{
-					Triangle triangle = triangles[mesh.triangleIndex + currentBox.triangleIndex];
-					HitInfo hit = HitTriangle(transformedRay, triangle);
-					hit.material = mesh.material;
-
-					hit.point = (mesh.localToWorldMatrix * vec4(hit.point, 1.0f)).xyz;
+					float distance = IntersectTriangle(transformedRay, mesh, currentBox.triangleIndex);
 
-					if ((hit.didHit == 1 && closestHit.distance >= hit.distance) || closestHit.didHit == 0)
+					if (distance != infinity && (closestHit.didHit == 0 || closestHit.distance >= distance))
 					{
-						closestHit = hit;
+						// Only remember which triangle was hit, the full hit info is calculated once the closest one is known
+						closestHit.didHit = 1;
+						closestHit.distance = distance;
+						closestMeshIndex = meshIndex;
+						closestTriangleIndex = currentBox.triangleIndex;
+						closestTransformedRay = transformedRay;
 					}
 				}
 
@@ -502,6 +634,9 @@ void CheckTriangleCollitions(Ray ray, inout HitInfo closestHit)
 					boxesToCheck[nBoxesToCheck] = boxIndexB;
 					closestIntersection[nBoxesToCheck] = distanceB;
 					nBoxesToCheck = nBoxesToCheck + 1;
+#ifdef INSTRUMENTATION
+					statStackDepth = max(statStackDepth, uint(nBoxesToCheck));
+#endif
 
 					// Set box A as the current box and recursivley check it
 					currentBoxIndex = boxIndexA;
@@ -512,6 +647,9 @@ void CheckTriangleCollitions(Ray ray, inout HitInfo closestHit)
 					boxesToCheck[nBoxesToCheck] = boxIndexA;
 					closestIntersection[nBoxesToCheck] = distanceA;
 					nBoxesToCheck = nBoxesToCheck + 1;
+#ifdef INSTRUMENTATION
+					statStackDepth = max(statStackDepth, uint(nBoxesToCheck));
+#endif
 
 					// Set box B as the current box and recursivley check it
 					currentBoxIndex = boxIndexB;
@@ -531,10 +669,18 @@ void CheckTriangleCollitions(Ray ray, inout HitInfo closestHit)
 			}
 		}
 	}
+
+	if (closestMeshIndex != -1)
+	{
+		closestHit = TriangleHitInfo(ray, closestTransformedRay, meshes[closestMeshIndex], closestTriangleIndex, closestHit.distance);
+	}
 }
 
 HitInfo RayCollition(Ray ray)
 {
+#ifdef INSTRUMENTATION
+	statRays++;
+#endif
 	HitInfo closestHit = EmptyHitInfo();
 
 	CheckSphereCollitions(ray, closestHit);
@@ -555,55 +701,18 @@ HitInfo RayCollition(Ray ray)
 
 
 
-vec2 calculatePitchYaw(vec3 direction)
+#ifdef INSTRUMENTATION
+// Blue for nothing, through green and yellow to red for the scale and above
+vec3 Heatmap(float t)
 {
-    // Normalize the input vector to ensure it has unit length
-    vec3 dir = normalize(direction);
-
-    // Calculate the pitch (rotation around the X-axis)
-    float pitch = degrees(asin(dir.y)); // asin returns radians, convert to degrees
-
-    // Calculate the yaw (rotation around the Y-axis) using atan and manual quadrant adjustment
-    float yaw = 0.0f;
-    if (dir.x > 0) 
-	{
-        yaw = degrees(atan(dir.z / dir.x));
-    }
-	else if (dir.x < 0) 
-	{
-        yaw = degrees(atan(dir.z / dir.x)) + 180.0f;
-    } 
-	else 
-	{
-        yaw = (dir.z >= 0) ? 90.0f : -90.0f;
-    }
-
-    return vec2(pitch, yaw);
-}
-
-vec3 SkyColor(vec3 normal)
-{
-	//return vec3(0.0f, 0.01f, 0.06f);
-
-	vec2 angles = calculatePitchYaw(normal);
-
-	return texture(skybox, vec2(angles.y / 360.0f, 1.0f - (angles.x + 90.0f) / 180.0f)).xyz;
-
-	//return vec3(normal.y / 10.0f + 0.2f, normal.y / 5.0f + 0.2f, normal.y / 3.0f + 0.5f) * 2.0f + 
-	//vec3(max(dot(normal, normalize(vec3(0.1f, 1.0f, 0.4f))) - 0.99f, 0.0f) * 100.0f) * 10.0f;
+	t = clamp(t, 0.0f, 1.0f);
+	vec3 color = vec3(0.0f, 0.0f, 1.0f);
+	color = mix(color, vec3(0.0f, 1.0f, 0.0f), smoothstep(0.0f, 0.33f, t));
+	color = mix(color, vec3(1.0f, 1.0f, 0.0f), smoothstep(0.33f, 0.66f, t));
+	color = mix(color, vec3(1.0f, 0.0f, 0.0f), smoothstep(0.66f, 1.0f, t));
+	return color;
 }
-
-
-
-
-
-
-
-
-
-
-
-
+#endif
 
 vec3 Trace(Ray ray, inout uint seed)
 {
@@ -633,6 +742,9 @@ vec3 Trace(Ray ray, inout uint seed)
 
 		if (hitInfo.didHit == 1)
 		{
+#ifdef INSTRUMENTATION
+			statBounces++;
+#endif
 			// Check if the ray is inside of an object and adjust the current IOR accordingly
 			float nextRefractiveIndex = 0.0f;
 			if (surfaceNormalDot > 0.0f)
@@ -698,15 +810,24 @@ out vec4 FragColor;
 
 void main()
 {
-	uint seed = uint((coordinate.x + 1.0f) * 728816.0f + (coordinate.y + 1.0f) * 1927962376.0f);
-	seed = seed + seed * frame * 8701;
+	// Every pixel, frame and stream is hashed in on its own, so no two of them add up to the same seed
+	uvec2 seedPixel = uvec2(gl_FragCoord.xy);
+	uint seed = Hash(seedPixel.x + Hash(seedPixel.y + Hash(frame + sampleOffset + Hash(sampleStream))));
 
 	vec3 averageColor = vec3(0.0f);
 
 	for (int s = 0; s < samplesPerPixel; s++)
 	{
+#ifdef NO_BLUR
+		vec2 randomBlurPoint = vec2(0.0f);
+#else
 		vec2 randomBlurPoint = RandomPointInCircle(seed) * blur;
+#endif
+#ifdef NO_FOCAL_BLUR
+		vec2 randomFocalBlurPoint = vec2(0.0f);
+#else
 		vec2 randomFocalBlurPoint = RandomPointInCircle(seed) * focalBlur;
+#endif
 
     	vec3 gridPoint = vec3(coordinate.x * focalDistance * perspectiveSlope, coordinate.y * focalDistance * perspectiveSlope * aspectRatio, focalDistance);
     	// Add random jitter to get a uniform blur, also usefull for anti-aliasing
@@ -727,5 +848,40 @@ void main()
 		averageColor += Trace(ray, seed);
 	}
 
-    FragColor = vec4(averageColor / float(samplesPerPixel), 1.0f);
+	vec3 color = averageColor / float(samplesPerPixel);
+
+#ifdef INSTRUMENTATION
+	// One atomic per counter per pixel instead of one per test
+	AddToTotal(TOTAL_PATHS, uint(samplesPerPixel));
+	AddToTotal(TOTAL_RAYS, statRays);
+	AddToTotal(TOTAL_BOX_TESTS, statBoxTests);
+	AddToTotal(TOTAL_TRIANGLE_TESTS, statTriangleTests);
+	AddToTotal(TOTAL_BOUNCES, statBounces);
+	atomicMax(maxStackDepth, statStackDepth);
+
+	if (debugView != DEBUG_VIEW_SHADED)
+	{
+		float count = 0.0f;
+		if (debugView == DEBUG_VIEW_BOX_TESTS) count = float(statBoxTests) / float(statRays);
+		else if (debugView == DEBUG_VIEW_TRIANGLE_TESTS) count = float(statTriangleTests) / float(statRays);
+		else if (debugView == DEBUG_VIEW_STACK_DEPTH) count = float(statStackDepth);
+		else if (debugView == DEBUG_VIEW_BOUNCES) count = float(statBounces) / float(samplesPerPixel);
+
+		color = Heatmap(count / heatmapScale);
+	}
+#endif
+
+	if (!accumulate)
+	{
+		FragColor = vec4(color, 1.0f);
+		return;
+	}
+
+	// Every pixel only reads and writes its own texel, so no other invocation touches it
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	vec4 sum = frame == 0 ? vec4(0.0f) : imageLoad(accumulation, pixel);
+	sum += vec4(color, 1.0f);
+	imageStore(accumulation, pixel, sum);
+
+	FragColor = vec4(clamp(sum.rgb / sum.a, 0.0f, 1.0f), 1.0f);
 }
\ No newline at end of file
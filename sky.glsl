@@ -0,0 +1,42 @@
+// The skybox lookup, shared by the raytrace and preview shaders
+
+uniform sampler2D skybox;
+
+vec2 calculatePitchYaw(vec3 direction)
+{
+    // Normalize the input vector to ensure it has unit length
+    vec3 dir = normalize(direction);
+
+    // Calculate the pitch (rotation around the X-axis)
+    float pitch = degrees(asin(dir.y)); // asin returns radians, convert to degrees
+
+    // Calculate the yaw (rotation around the Y-axis) using atan and manual quadrant adjustment
+    float yaw = 0.0f;
+    if (dir.x > 0) 
+	{
+        yaw = degrees(atan(dir.z / dir.x));
+    }
+	else if (dir.x < 0) 
+	{
+        yaw = degrees(atan(dir.z / dir.x)) + 180.0f;
+    } 
+	else 
+	{
+        yaw = (dir.z >= 0) ? 90.0f : -90.0f;
+    }
+
+    return vec2(pitch, yaw);
+}
+
+vec3 SkyColor(vec3 normal)
+{
+	//return vec3(0.0f, 0.01f, 0.06f);
+
+	vec2 angles = calculatePitchYaw(normal);
+
+	// Always sample the full resolution, the random bounce directions make the automatic mip selection blur the sky
+	return textureLod(skybox, vec2(angles.y / 360.0f, 1.0f - (angles.x + 90.0f) / 180.0f), 0.0f).xyz;
+
+	//return vec3(normal.y / 10.0f + 0.2f, normal.y / 5.0f + 0.2f, normal.y / 3.0f + 0.5f) * 2.0f + 
+	//vec3(max(dot(normal, normalize(vec3(0.1f, 1.0f, 0.4f))) - 0.99f, 0.0f) * 100.0f) * 10.0f;
+}
\ No newline at end of file
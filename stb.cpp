@@ -1,4 +1,8 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 #define STB_IMAGE_WRITE_IMPLEMENTATION
+// The vendored stb_image_write uses the two argument sprintf_s of MSVC, which other compilers do not have
+#if !defined(_MSC_VER) && !defined(__STDC_LIB_EXT1__)
+#define sprintf_s(buffer, ...) sprintf(buffer, __VA_ARGS__)
+#endif
 #include <stb/stb_image_write.h>
\ No newline at end of file